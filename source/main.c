@@ -2,10 +2,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "util/heap.h"
 #include "util/log.h"
 #include "tools/cur_frame.h"
 #include "tools/controller.h"
 #include "transport/streamable_http.h"
+#include "transport/udp_input.h"
 
 // Include the main libnx system header, for Switch development
 #include <switch.h>
@@ -23,6 +25,8 @@
 
 // Size of the inner heap (adjust as necessary).
 // #define HEAP_SIZE 0xA7000
+// 截图缓冲区（512KB）与请求缓冲区池（144KB）已改为静态分配，但 resources/read 与带 progressToken 的 SSE
+// 仍在堆上构建整张图的 base64（约 1.2MB，见 CAPTURE_HEAP_BUDGET），所有截图路径流式写出之前堆保持 2MB
 #define HEAP_SIZE 0x200000 // 2MB heap size
 
 #ifdef __cplusplus
@@ -79,9 +83,15 @@ void __appInit(void)
         .tcp_tx_buf_max_size = 0x25000,
         .tcp_rx_buf_max_size = 0x25000,
 
+#if UDP_INPUT_ENABLED
+        // UDP 只用于接收手柄输入小包
+        .udp_tx_buf_size = 0x400,
+        .udp_rx_buf_size = 0x2000,
+#else
         //We don't use UDP, set all UDP buffers to 0
         .udp_tx_buf_size = 0,
         .udp_rx_buf_size = 0,
+#endif
 
         .sb_efficiency = 1,
     };
@@ -124,6 +134,10 @@ int main(int argc, char* argv[])
 {
     R_ASSERT(streamable_http_init());
     log_info("streamable_http_init called");
+    if (R_FAILED(udp_input_init())) {
+        log_warning("UDP input disabled");
+    }
+    heap_log_summary("startup");
     loop();
     return 0;
 }
@@ -56,8 +56,18 @@
 #pragma GCC visibility pop
 #endif
 
+/* local fork, see the note at the top of cJSON.h */
 #include "cJSON.h"
 
+/* string scanning compares 16 bytes at a time with NEON on AArch64, 8 bytes at a time in a 64 bit
+ * integer on other little endian targets, and falls back to a plain loop otherwise */
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CJSON_SCAN_NEON 1
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define CJSON_SCAN_SWAR 1
+#endif
+
 /* define our own boolean type */
 #ifdef true
 #undef true
@@ -237,6 +247,15 @@ CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
     }
 }
 
+CJSON_PUBLIC(void) cJSON_InitHooksWithRealloc(cJSON_Hooks* hooks, void *(CJSON_CDECL *realloc_fn)(void *ptr, size_t sz))
+{
+    cJSON_InitHooks(hooks);
+    if ((hooks != NULL) && (realloc_fn != NULL))
+    {
+        global_hooks.reallocate = realloc_fn;
+    }
+}
+
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 {
@@ -587,6 +606,218 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
+/* write the decimal digits of value so that they end right before end, returns the first digit */
+static unsigned char *print_digits(unsigned long long value, unsigned char *end)
+{
+    do
+    {
+        *--end = (unsigned char)('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    return end;
+}
+
+/* integral values below 1e15 are printed with all of their digits by "%1.15g" too */
+static int print_integer(double d, unsigned char *buffer)
+{
+    unsigned char digits[20];
+    unsigned char *end = digits + sizeof(digits);
+    unsigned char *start = print_digits((unsigned long long)fabs(d), end);
+    int length = 0;
+
+    if (d < 0)
+    {
+        buffer[length++] = '-';
+    }
+    memcpy(buffer + length, start, (size_t)(end - start));
+    length += (int)(end - start);
+    buffer[length] = '\0';
+
+    return length;
+}
+
+/* exact powers of ten as doubles */
+static const double double_powers_of_10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const unsigned long long integer_powers_of_10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/* Lay out precision significant digits the way "%1.<precision>g" does, with exponent10 being the decimal
+ * exponent of the first digit and trailing zeros removed. The result is at most 25 characters long. */
+static int print_g_digits(unsigned long long digits, int precision, int exponent10, cJSON_bool negative, unsigned char *buffer)
+{
+    unsigned char text[20];
+    unsigned char *end = text + sizeof(text);
+    unsigned char *start = NULL;
+    int count = 0;
+    int length = 0;
+    int i = 0;
+
+    while ((digits % 10 == 0) && (digits >= 10))
+    {
+        digits /= 10;
+    }
+    start = print_digits(digits, end);
+    count = (int)(end - start);
+
+    if (negative)
+    {
+        buffer[length++] = '-';
+    }
+    if ((exponent10 < -4) || (exponent10 >= precision))
+    {
+        int magnitude = exponent10 < 0 ? -exponent10 : exponent10;
+        buffer[length++] = start[0];
+        if (count > 1)
+        {
+            buffer[length++] = '.';
+            memcpy(buffer + length, start + 1, (size_t)(count - 1));
+            length += count - 1;
+        }
+        buffer[length++] = 'e';
+        buffer[length++] = exponent10 < 0 ? '-' : '+';
+        if (magnitude >= 100)
+        {
+            buffer[length++] = (unsigned char)('0' + magnitude / 100);
+        }
+        buffer[length++] = (unsigned char)('0' + (magnitude / 10) % 10);
+        buffer[length++] = (unsigned char)('0' + magnitude % 10);
+    }
+    else if (exponent10 >= 0)
+    {
+        for (i = 0; i <= exponent10; i++)
+        {
+            buffer[length++] = i < count ? start[i] : '0';
+        }
+        if (count > exponent10 + 1)
+        {
+            buffer[length++] = '.';
+            memcpy(buffer + length, start + exponent10 + 1, (size_t)(count - exponent10 - 1));
+            length += count - exponent10 - 1;
+        }
+    }
+    else
+    {
+        buffer[length++] = '0';
+        buffer[length++] = '.';
+        for (i = -1; i > exponent10; i--)
+        {
+            buffer[length++] = '0';
+        }
+        memcpy(buffer + length, start, (size_t)count);
+        length += count;
+    }
+    buffer[length] = '\0';
+
+    return length;
+}
+
+#if defined(__SIZEOF_INT128__)
+#define CJSON_FAST_DECIMAL 1
+typedef unsigned __int128 cjson_uint128;
+
+/* Correctly rounded (ties to even, like printf) significant digits of mantissa * 2^-shift.
+ * exponent10 is an estimate of the decimal exponent on input, and exact on output. */
+static unsigned long long round_digits(unsigned long long mantissa, int shift, int precision, int *exponent10)
+{
+    for (;;)
+    {
+        int scale = precision - 1 - *exponent10;
+        cjson_uint128 scaled = 0;
+        cjson_uint128 remainder = 0;
+        cjson_uint128 half = (cjson_uint128)1 << (shift - 1);
+        unsigned long long digits = 0;
+
+        if (scale <= 19)
+        {
+            scaled = (cjson_uint128)mantissa * integer_powers_of_10[scale];
+        }
+        else
+        {
+            scaled = (cjson_uint128)mantissa * integer_powers_of_10[19] * integer_powers_of_10[scale - 19];
+        }
+        digits = (unsigned long long)(scaled >> shift);
+        remainder = scaled & (((cjson_uint128)1 << shift) - 1);
+
+        if (digits >= integer_powers_of_10[precision])
+        {
+            (*exponent10)++;
+            continue;
+        }
+        if (digits < integer_powers_of_10[precision - 1])
+        {
+            (*exponent10)--;
+            continue;
+        }
+        if ((remainder > half) || ((remainder == half) && (digits & 1)))
+        {
+            digits++;
+            if (digits == integer_powers_of_10[precision])
+            {
+                digits /= 10;
+                (*exponent10)++;
+            }
+        }
+        return digits;
+    }
+}
+
+/* Same output as the "%1.15g" / "%1.17g" fallback below for 1e-5 <= |d| < 1e15, computed with
+ * integer arithmetic instead of a printf/scanf round trip. Returns 0 for values outside that range. */
+static int print_decimal(double d, unsigned char *buffer)
+{
+    double magnitude = fabs(d);
+    int binary_exponent = 0;
+    unsigned long long mantissa = 0;
+    int shift = 0;
+    int estimate = 0;
+    int exponent10 = 0;
+    unsigned long long digits = 0;
+    double test = 0.0;
+
+    if (!((magnitude >= 1e-5) && (magnitude < 1e15)))
+    {
+        return 0;
+    }
+
+    /* magnitude == mantissa * 2^-shift exactly, and shift > 0 in this range */
+    mantissa = (unsigned long long)ldexp(frexp(magnitude, &binary_exponent), 53);
+    shift = 53 - binary_exponent;
+    estimate = (int)floor(log10(magnitude));
+    if (estimate > 14)
+    {
+        /* log10 may round up just below 1e15 */
+        estimate = 14;
+    }
+
+    /* the 15 digit form is used whenever it converts back to (nearly) the same value */
+    exponent10 = estimate;
+    digits = round_digits(mantissa, shift, 15, &exponent10);
+    if (exponent10 > 14)
+    {
+        return 0;
+    }
+    /* both operands are exact, so this is the correctly rounded value sscanf would return */
+    test = (double)digits / double_powers_of_10[14 - exponent10];
+    if (compare_double(test, magnitude))
+    {
+        return print_g_digits(digits, 15, exponent10, d < 0, buffer);
+    }
+
+    exponent10 = estimate;
+    digits = round_digits(mantissa, shift, 17, &exponent10);
+    return print_g_digits(digits, 17, exponent10, d < 0, buffer);
+}
+#endif
+
 /* Render the number nicely from the given item into a string. */
 static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
 {
@@ -608,10 +839,16 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     {
         length = sprintf((char*)number_buffer, "null");
     }
-    else if(d == (double)item->valueint)
+    else if ((d == floor(d)) && (fabs(d) < 1e15))
     {
-        length = sprintf((char*)number_buffer, "%d", item->valueint);
+        length = print_integer(d, number_buffer);
     }
+#ifdef CJSON_FAST_DECIMAL
+    else if ((length = print_decimal(d, number_buffer)) > 0)
+    {
+        /* already printed */
+    }
+#endif
     else
     {
         /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
@@ -657,6 +894,71 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     return true;
 }
 
+/* Length of the leading run of input that contains no '\"' and no '\\' (and, with stop_at_control,
+ * no control characters), i.e. bytes that can be copied verbatim when parsing or printing strings.
+ * Only the first length bytes are read. */
+static size_t string_run_length(const unsigned char *input, size_t length, cJSON_bool stop_at_control)
+{
+    size_t offset = 0;
+#if defined(CJSON_SCAN_NEON)
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(' ');
+
+    for (; (offset + 16) <= length; offset += 16)
+    {
+        uint8x16_t chunk = vld1q_u8(input + offset);
+        uint8x16_t matches = vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash));
+        if (stop_at_control)
+        {
+            matches = vorrq_u8(matches, vcltq_u8(chunk, space));
+        }
+        if (vmaxvq_u8(matches) != 0)
+        {
+            /* narrow the 0x00/0xff bytes to one nibble each and locate the first set one */
+            uint64_t nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+            return offset + (size_t)(__builtin_ctzll(nibbles) >> 2);
+        }
+    }
+#elif defined(CJSON_SCAN_SWAR)
+    const unsigned long long ones = 0x0101010101010101ULL;
+    const unsigned long long highs = 0x8080808080808080ULL;
+
+    for (; (offset + 8) <= length; offset += 8)
+    {
+        unsigned long long chunk = 0;
+        unsigned long long quotes = 0;
+        unsigned long long backslashes = 0;
+        unsigned long long matches = 0;
+        memcpy(&chunk, input + offset, sizeof(chunk));
+        /* high bit of every byte equal to the character; bytes above a match may be flagged too,
+         * but the lowest flagged byte is always exact */
+        quotes = chunk ^ (ones * '\"');
+        backslashes = chunk ^ (ones * '\\');
+        matches = ((quotes - ones) & ~quotes) | ((backslashes - ones) & ~backslashes);
+        if (stop_at_control)
+        {
+            matches |= (chunk - ones * ' ') & ~chunk;
+        }
+        matches &= highs;
+        if (matches != 0)
+        {
+            return offset + (size_t)(__builtin_ctzll(matches) >> 3);
+        }
+    }
+#endif
+
+    for (; offset < length; offset++)
+    {
+        if ((input[offset] == '\"') || (input[offset] == '\\') || (stop_at_control && (input[offset] < 32)))
+        {
+            break;
+        }
+    }
+
+    return offset;
+}
+
 /* parse 4 digit hexadecimal number */
 static unsigned parse_hex4(const unsigned char * const input)
 {
@@ -833,20 +1135,23 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
         /* calculate approximate size of the output (overestimate) */
         size_t allocation_length = 0;
         size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        while ((size_t)(input_end - input_buffer->content) < input_buffer->length)
         {
+            /* skip to the next quote or backslash */
+            input_end += string_run_length(input_end, input_buffer->length - (size_t)(input_end - input_buffer->content), false);
+            if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end == '\"'))
+            {
+                break;
+            }
+
             /* is escape sequence */
-            if (input_end[0] == '\\')
+            if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
             {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
             }
-            input_end++;
+            skipped_bytes++;
+            input_end += 2;
         }
         if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
         {
@@ -868,7 +1173,16 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     {
         if (*input_pointer != '\\')
         {
-            *output_pointer++ = *input_pointer++;
+            /* copy everything up to the next escape sequence at once */
+            size_t run_length = string_run_length(input_pointer, (size_t)(input_end - input_pointer), false);
+            if (run_length == 0)
+            {
+                /* a quote left behind by a malformed \u sequence is copied like any other character */
+                run_length = 1;
+            }
+            memcpy(output_pointer, input_pointer, run_length);
+            output_pointer += run_length;
+            input_pointer += run_length;
         }
         /* escape sequence */
         else
@@ -949,8 +1263,10 @@ fail:
 static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
 {
     const unsigned char *input_pointer = NULL;
+    const unsigned char *input_end = NULL;
     unsigned char *output = NULL;
     unsigned char *output_pointer = NULL;
+    size_t input_length = 0;
     size_t output_length = 0;
     /* numbers of additional characters needed for escaping */
     size_t escape_characters = 0;
@@ -973,8 +1289,12 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
         return true;
     }
 
-    /* set "flag" to 1 if something needs to be escaped */
-    for (input_pointer = input; *input_pointer; input_pointer++)
+    input_length = strlen((const char*)input);
+    input_end = input + input_length;
+
+    /* count the additional characters needed for escaping, skipping runs that need none */
+    input_pointer = input + string_run_length(input, input_length, true);
+    while (input_pointer < input_end)
     {
         switch (*input_pointer)
         {
@@ -989,15 +1309,14 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
                 escape_characters++;
                 break;
             default:
-                if (*input_pointer < 32)
-                {
-                    /* UTF-16 escape sequence uXXXX */
-                    escape_characters += 5;
-                }
+                /* UTF-16 escape sequence uXXXX */
+                escape_characters += 5;
                 break;
         }
+        input_pointer++;
+        input_pointer += string_run_length(input_pointer, (size_t)(input_end - input_pointer), true);
     }
-    output_length = (size_t)(input_pointer - input) + escape_characters;
+    output_length = input_length + escape_characters;
 
     output = ensure(output_buffer, output_length + sizeof("\"\""));
     if (output == NULL)
@@ -1019,47 +1338,52 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     output[0] = '\"';
     output_pointer = output + 1;
     /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+    input_pointer = input;
+    while (input_pointer < input_end)
     {
-        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        /* normal characters, copy the whole run */
+        size_t run_length = string_run_length(input_pointer, (size_t)(input_end - input_pointer), true);
+        memcpy(output_pointer, input_pointer, run_length);
+        input_pointer += run_length;
+        output_pointer += run_length;
+        if (input_pointer == input_end)
         {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
+            break;
         }
-        else
+
+        /* character needs to be escaped */
+        *output_pointer++ = '\\';
+        switch (*input_pointer)
         {
-            /* character needs to be escaped */
-            *output_pointer++ = '\\';
-            switch (*input_pointer)
-            {
-                case '\\':
-                    *output_pointer = '\\';
-                    break;
-                case '\"':
-                    *output_pointer = '\"';
-                    break;
-                case '\b':
-                    *output_pointer = 'b';
-                    break;
-                case '\f':
-                    *output_pointer = 'f';
-                    break;
-                case '\n':
-                    *output_pointer = 'n';
-                    break;
-                case '\r':
-                    *output_pointer = 'r';
-                    break;
-                case '\t':
-                    *output_pointer = 't';
-                    break;
-                default:
-                    /* escape and print as unicode codepoint */
-                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
-                    output_pointer += 4;
-                    break;
-            }
+            case '\\':
+                *output_pointer = '\\';
+                break;
+            case '\"':
+                *output_pointer = '\"';
+                break;
+            case '\b':
+                *output_pointer = 'b';
+                break;
+            case '\f':
+                *output_pointer = 'f';
+                break;
+            case '\n':
+                *output_pointer = 'n';
+                break;
+            case '\r':
+                *output_pointer = 'r';
+                break;
+            case '\t':
+                *output_pointer = 't';
+                break;
+            default:
+                /* escape and print as unicode codepoint */
+                sprintf((char*)output_pointer, "u%04x", *input_pointer);
+                output_pointer += 4;
+                break;
         }
+        input_pointer++;
+        output_pointer++;
     }
     output[output_length + 1] = '\"';
     output[output_length + 2] = '\0';
@@ -1231,7 +1555,7 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
 
-static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks, size_t * const length)
 {
     static const size_t default_buffer_size = 256;
     printbuffer buffer[1];
@@ -1280,6 +1604,11 @@ static unsigned char *print(const cJSON * const item, cJSON_bool format, const i
         buffer->buffer = NULL;
     }
 
+    if (length != NULL)
+    {
+        *length = buffer->offset;
+    }
+
     return printed;
 
 fail:
@@ -1301,12 +1630,17 @@ fail:
 /* Render a cJSON item/entity/structure to text. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item)
 {
-    return (char*)print(item, true, &global_hooks);
+    return (char*)print(item, true, &global_hooks, NULL);
 }
 
 CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
 {
-    return (char*)print(item, false, &global_hooks);
+    return (char*)print(item, false, &global_hooks, NULL);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintUnformattedWithLength(const cJSON *item, size_t *length)
+{
+    return (char*)print(item, false, &global_hooks, length);
 }
 
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
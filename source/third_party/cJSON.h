@@ -20,6 +20,17 @@
   THE SOFTWARE.
 */
 
+/*
+  This is a local fork of cJSON 1.7.18 used by mcp-server. The public types are
+  unchanged from upstream; the differences are:
+  - cJSON_InitHooksWithRealloc: lets custom allocators (util/arena.c) supply a realloc
+  - cJSON_PrintUnformattedWithLength: returns the printed length along with the text
+  - print_number formats integral values and most doubles without sprintf/sscanf,
+    with byte-identical output
+  - parse_string and print_string_ptr scan 16 bytes (NEON) or 8 bytes (SWAR) at a time
+  Keep these in mind when updating to a newer upstream release.
+*/
+
 #ifndef cJSON__h
 #define cJSON__h
 
@@ -148,6 +159,8 @@ CJSON_PUBLIC(const char*) cJSON_Version(void);
 
 /* Supply malloc, realloc and free functions to cJSON */
 CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks);
+/* Same as cJSON_InitHooks, but print buffers grow with realloc_fn, which must match the supplied malloc/free. Local addition, see the note at the top of this file. */
+CJSON_PUBLIC(void) cJSON_InitHooksWithRealloc(cJSON_Hooks* hooks, void *(CJSON_CDECL *realloc_fn)(void *ptr, size_t sz));
 
 /* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse (with cJSON_Delete) and cJSON_Print (with stdlib free, cJSON_Hooks.free_fn, or cJSON_free as appropriate). The exception is cJSON_PrintPreallocated, where the caller has full responsibility of the buffer. */
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. */
@@ -162,6 +175,8 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
 CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item);
+/* Same as cJSON_PrintUnformatted, but also reports the length of the rendered text (excluding the terminating NUL). */
+CJSON_PUBLIC(char *) cJSON_PrintUnformattedWithLength(const cJSON *item, size_t *length);
 /* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation. fmt=0 gives unformatted, =1 gives formatted */
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt);
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
@@ -5,6 +5,7 @@
 #include <switch/services/hid.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <switch.h>
 #include <switch/services/hid.h> // 包含键盘按键定义
@@ -29,8 +30,25 @@ static u8 *workmem = NULL;
 static size_t workmem_size = 0x1000;
 
 static Mutex hdlStateMutex;
+static Mutex initMutex; // HTTP worker、WebSocket 与 UDP 线程都可能首先触发初始化
 
 void update_hdls_state(const HiddbgHdlsState *args, bool is_long_press);
+Result controllerInitialize();
+
+// 懒初始化：已初始化时只有一次原子读，首次调用在锁内完成，并发的首批调用不会重复挂载 HDLS 与启动线程
+static bool controller_ensure_initialized()
+{
+    if (__atomic_load_n(&initialized, __ATOMIC_ACQUIRE)) return true;
+    mutexLock(&initMutex);
+    Result rc = initialized ? 0 : controllerInitialize();
+    mutexUnlock(&initMutex);
+    if (R_FAILED(rc))
+    {
+        log_error("initializing controller failed");
+        return false;
+    }
+    return true;
+}
 
 int list_controller(cJSON *tools)
 {
@@ -106,12 +124,116 @@ int list_controller(cJSON *tools)
     cJSON_AddItemToArray(tools, tool);
     return 1;
 }
-Result controllerInitialize();
-int call_controller(cJSON *content, const cJSON *arguments)
+
+const ToolDescriptor controller_tool = {
+    .name = "controller",
+    .list = list_controller,
+    .call = call_controller,
+    .call_doc = call_controller_doc,
+    .flags = TOOL_FLAG_NEEDS_ARGS | TOOL_FLAG_INPUT,
+};
+
+// inputSchema 中 buttons 的取值
+static const struct {
+    const char *name;
+    u64 mask;
+} controller_buttons[] = {
+    { "A", HidNpadButton_A },
+    { "B", HidNpadButton_B },
+    { "X", HidNpadButton_X },
+    { "Y", HidNpadButton_Y },
+    { "LSTICK", HidNpadButton_StickL },
+    { "RSTICK", HidNpadButton_StickR },
+    { "L", HidNpadButton_L },
+    { "R", HidNpadButton_R },
+    { "ZL", HidNpadButton_ZL },
+    { "ZR", HidNpadButton_ZR },
+    { "PLUS", HidNpadButton_Plus },
+    { "MINUS", HidNpadButton_Minus },
+    { "LEFT", HidNpadButton_Left },
+    { "UP", HidNpadButton_Up },
+    { "RIGHT", HidNpadButton_Right },
+    { "DOWN", HidNpadButton_Down },
+    { "HOME", HiddbgNpadButton_Home },
+    { "CAPTURE", HiddbgNpadButton_Capture },
+};
+
+// inputSchema 中的数值属性及其在 HiddbgHdlsState 中的位置
+typedef struct {
+    const char *key;
+    size_t offset;
+    bool is_float;
+} ControllerAxis;
+
+static const ControllerAxis controller_axes[] = {
+    { "analog_stick_lx", offsetof(HiddbgHdlsState, analog_stick_l.x), false },
+    { "analog_stick_ly", offsetof(HiddbgHdlsState, analog_stick_l.y), false },
+    { "analog_stick_rx", offsetof(HiddbgHdlsState, analog_stick_r.x), false },
+    { "analog_stick_ry", offsetof(HiddbgHdlsState, analog_stick_r.y), false },
+    { "six_axis_sensor_accelerationx", offsetof(HiddbgHdlsState, six_axis_sensor_acceleration.x), true },
+    { "six_axis_sensor_accelerationy", offsetof(HiddbgHdlsState, six_axis_sensor_acceleration.y), true },
+    { "six_axis_sensor_accelerationz", offsetof(HiddbgHdlsState, six_axis_sensor_acceleration.z), true },
+    { "six_axis_sensor_anglex", offsetof(HiddbgHdlsState, six_axis_sensor_angle.x), true },
+    { "six_axis_sensor_angley", offsetof(HiddbgHdlsState, six_axis_sensor_angle.y), true },
+    { "six_axis_sensor_anglez", offsetof(HiddbgHdlsState, six_axis_sensor_angle.z), true },
+};
+
+#define CONTROLLER_BUTTON_COUNT (sizeof(controller_buttons) / sizeof(controller_buttons[0]))
+#define CONTROLLER_AXIS_COUNT (sizeof(controller_axes) / sizeof(controller_axes[0]))
+
+static u64 button_mask(const char *name)
 {
-    if (!initialized && R_FAILED(controllerInitialize()))
+    for (size_t i = 0; i < CONTROLLER_BUTTON_COUNT; ++i)
+    {
+        if (strcmp(name, controller_buttons[i].name) == 0) return controller_buttons[i].mask;
+    }
+    return 0;
+}
+
+static void set_axis(HiddbgHdlsState *state, const ControllerAxis *axis, double value)
+{
+    u8 *field = (u8 *)state + axis->offset;
+    if (axis->is_float) {
+        float f = (float)value;
+        memcpy(field, &f, sizeof(f));
+    } else {
+        s32 v = (s32)value;
+        memcpy(field, &v, sizeof(v));
+    }
+}
+
+// 两种参数来源共用：更新手柄状态并生成 content
+static int finish_call(cJSON *content, const HiddbgHdlsState *args, int has_any, bool is_long_press)
+{
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "type", "text");
+    if (has_any)
+    {
+        update_hdls_state(args, is_long_press);
+        char buf[256];
+        snprintf(buf, sizeof(buf), "Simulated HdlsState: buttons=0x%lx, L=(%d,%d), R=(%d,%d), accel=(%.2f,%.2f,%.2f), angle=(%.2f,%.2f,%.2f)",
+                 args->buttons,
+                 args->analog_stick_l.x, args->analog_stick_l.y,
+                 args->analog_stick_r.x, args->analog_stick_r.y,
+                 args->six_axis_sensor_acceleration.x, args->six_axis_sensor_acceleration.y, args->six_axis_sensor_acceleration.z,
+                 args->six_axis_sensor_angle.x, args->six_axis_sensor_angle.y, args->six_axis_sensor_angle.z);
+
+        cJSON_AddStringToObject(item, "text", buf);
+        cJSON_AddItemToArray(content, item);
+        return 0;
+    }
+    else
+    {
+        cJSON_AddStringToObject(item, "text", "No valid HdlsState input fields");
+        cJSON_AddItemToArray(content, item);
+        return 1;
+    }
+}
+
+int call_controller(cJSON *content, const cJSON *arguments, ToolContext *ctx)
+{
+    if (!controller_ensure_initialized())
     {
-        log_error("initializing controller failed");
         return -1;
     }
 
@@ -123,109 +245,54 @@ int call_controller(cJSON *content, const cJSON *arguments)
     if (buttons && cJSON_IsArray(buttons)) {
         cJSON *button = NULL;
         cJSON_ArrayForEach(button, buttons) {
-            if (cJSON_IsString(button)) {
-                const char *button_name = button->valuestring;
-                if (strcmp(button_name, "A") == 0) args.buttons |= HidNpadButton_A;
-                else if (strcmp(button_name, "B") == 0) args.buttons |= HidNpadButton_B;
-                else if (strcmp(button_name, "X") == 0) args.buttons |= HidNpadButton_X;
-                else if (strcmp(button_name, "Y") == 0) args.buttons |= HidNpadButton_Y;
-                else if (strcmp(button_name, "LSTICK") == 0) args.buttons |= HidNpadButton_StickL;
-                else if (strcmp(button_name, "RSTICK") == 0) args.buttons |= HidNpadButton_StickR;
-                else if (strcmp(button_name, "L") == 0) args.buttons |= HidNpadButton_L;
-                else if (strcmp(button_name, "R") == 0) args.buttons |= HidNpadButton_R;
-                else if (strcmp(button_name, "ZL") == 0) args.buttons |= HidNpadButton_ZL;
-                else if (strcmp(button_name, "ZR") == 0) args.buttons |= HidNpadButton_ZR;
-                else if (strcmp(button_name, "PLUS") == 0) args.buttons |= HidNpadButton_Plus;
-                else if (strcmp(button_name, "MINUS") == 0) args.buttons |= HidNpadButton_Minus;
-                else if (strcmp(button_name, "LEFT") == 0) args.buttons |= HidNpadButton_Left;
-                else if (strcmp(button_name, "UP") == 0) args.buttons |= HidNpadButton_Up;
-                else if (strcmp(button_name, "RIGHT") == 0) args.buttons |= HidNpadButton_Right;
-                else if (strcmp(button_name, "DOWN") == 0) args.buttons |= HidNpadButton_Down;
-                else if (strcmp(button_name, "HOME") == 0) args.buttons |= HiddbgNpadButton_Home;
-                else if (strcmp(button_name, "CAPTURE") == 0) args.buttons |= HiddbgNpadButton_Capture;
-            }
+            if (cJSON_IsString(button)) args.buttons |= button_mask(button->valuestring);
         }
         has_any = 1;
     }
-    const cJSON *lx = cJSON_GetObjectItem(arguments, "analog_stick_lx");
-    if (lx && cJSON_IsNumber(lx)) {
-        args.analog_stick_l.x = (s32)lx->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *ly = cJSON_GetObjectItem(arguments, "analog_stick_ly");
-    if (ly && cJSON_IsNumber(ly)) {
-        args.analog_stick_l.y = (s32)ly->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *rx = cJSON_GetObjectItem(arguments, "analog_stick_rx");
-    if (rx && cJSON_IsNumber(rx)) {
-        args.analog_stick_r.x = (s32)rx->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *ry = cJSON_GetObjectItem(arguments, "analog_stick_ry");
-    if (ry && cJSON_IsNumber(ry)) {
-        args.analog_stick_r.y = (s32)ry->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *accx = cJSON_GetObjectItem(arguments, "six_axis_sensor_accelerationx");
-    if (accx && cJSON_IsNumber(accx)) {
-        args.six_axis_sensor_acceleration.x = (float)accx->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *accy = cJSON_GetObjectItem(arguments, "six_axis_sensor_accelerationy");
-    if (accy && cJSON_IsNumber(accy)) {
-        args.six_axis_sensor_acceleration.y = (float)accy->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *accz = cJSON_GetObjectItem(arguments, "six_axis_sensor_accelerationz");
-    if (accz && cJSON_IsNumber(accz)) {
-        args.six_axis_sensor_acceleration.z = (float)accz->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *angx = cJSON_GetObjectItem(arguments, "six_axis_sensor_anglex");
-    if (angx && cJSON_IsNumber(angx)) {
-        args.six_axis_sensor_angle.x = (float)angx->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *angy = cJSON_GetObjectItem(arguments, "six_axis_sensor_angley");
-    if (angy && cJSON_IsNumber(angy)) {
-        args.six_axis_sensor_angle.y = (float)angy->valuedouble;
-        has_any = 1;
-    }
-    const cJSON *angz = cJSON_GetObjectItem(arguments, "six_axis_sensor_anglez");
-    if (angz && cJSON_IsNumber(angz)) {
-        args.six_axis_sensor_angle.z = (float)angz->valuedouble;
-        has_any = 1;
+    for (size_t i = 0; i < CONTROLLER_AXIS_COUNT; ++i) {
+        const cJSON *value = cJSON_GetObjectItem(arguments, controller_axes[i].key);
+        if (value && cJSON_IsNumber(value)) {
+            set_axis(&args, &controller_axes[i], value->valuedouble);
+            has_any = 1;
+        }
     }
     bool is_long_press = false;
     const cJSON *long_press = cJSON_GetObjectItem(arguments, "long_press");
     if (long_press && cJSON_IsBool(long_press)) {
         is_long_press = (bool)long_press->valueint;
     }
+    return finish_call(content, &args, has_any, is_long_press);
+}
 
-    cJSON *item = cJSON_CreateObject();
-    cJSON_AddStringToObject(item, "type", "text");
-    if (has_any)
+int call_controller_doc(cJSON *content, const JsonDoc *doc, int arguments, ToolContext *ctx)
+{
+    if (!controller_ensure_initialized())
     {
-        update_hdls_state(&args, is_long_press);
-        char buf[256];
-        snprintf(buf, sizeof(buf), "Simulated HdlsState: buttons=0x%lx, L=(%d,%d), R=(%d,%d), accel=(%.2f,%.2f,%.2f), angle=(%.2f,%.2f,%.2f)",
-                 args.buttons,
-                 args.analog_stick_l.x, args.analog_stick_l.y,
-                 args.analog_stick_r.x, args.analog_stick_r.y,
-                 args.six_axis_sensor_acceleration.x, args.six_axis_sensor_acceleration.y, args.six_axis_sensor_acceleration.z,
-                 args.six_axis_sensor_angle.x, args.six_axis_sensor_angle.y, args.six_axis_sensor_angle.z);
+        return -1;
+    }
 
-        cJSON_AddStringToObject(item, "text", buf);
-        cJSON_AddItemToArray(content, item);
-        return 0;
+    HiddbgHdlsState args = {0};
+    int has_any = 0;
+
+    // 与 call_controller 相同，但直接在请求体上查找属性，不解码整棵树
+    int buttons = json_doc_get(doc, arguments, "buttons");
+    if (json_doc_type(doc, buttons) == JSON_DOC_ARRAY) {
+        char name[16]; // 比最长的按键名长即可，更长的字符串不会匹配
+        for (int button = json_doc_first(doc, buttons); button >= 0; button = json_doc_next(doc, button)) {
+            if (json_doc_string(doc, button, name, sizeof(name)) >= 0) args.buttons |= button_mask(name);
+        }
+        has_any = 1;
     }
-    else
-    {
-        cJSON_AddStringToObject(item, "text", "No valid HdlsState input fields");
-        cJSON_AddItemToArray(content, item);
-        return 1;
+    for (size_t i = 0; i < CONTROLLER_AXIS_COUNT; ++i) {
+        int value = json_doc_get(doc, arguments, controller_axes[i].key);
+        if (json_doc_type(doc, value) == JSON_DOC_NUMBER) {
+            set_axis(&args, &controller_axes[i], json_doc_number(doc, value));
+            has_any = 1;
+        }
     }
+    JsonDocType long_press = json_doc_type(doc, json_doc_get(doc, arguments, "long_press"));
+    bool is_long_press = long_press == JSON_DOC_TRUE;
+    return finish_call(content, &args, has_any, is_long_press);
 }
 
 void hdls_state_thread(void *arg)
@@ -321,7 +388,7 @@ Result controllerInitialize()
         threadClose(&hdlThread);
         return -4;
     }
-    initialized = 1;
+    __atomic_store_n(&initialized, 1, __ATOMIC_RELEASE);
     log_info("Controller initialized successfully");
     return 0;
 }
@@ -347,7 +414,40 @@ void controllerFinalize()
     {
         threadClose(&hdlThread);
     }
-    initialized = 0;
+    __atomic_store_n(&initialized, 0, __ATOMIC_RELEASE);
+}
+
+int controller_decode_packet(const u8 *data, size_t len, HiddbgHdlsState *state, bool *long_press)
+{
+    if (len != CONTROLLER_PACKET_SIZE || data[0] != CONTROLLER_PACKET_VERSION)
+    {
+        return -1;
+    }
+    // 目标平台与主机均为小端，按偏移逐字段拷贝，避免依赖结构体布局
+    *state = (HiddbgHdlsState){0};
+    *long_press = (data[1] & CONTROLLER_PACKET_FLAG_LONG_PRESS) != 0;
+    memcpy(&state->buttons, data + 4, 8);
+    memcpy(&state->analog_stick_l.x, data + 12, 4);
+    memcpy(&state->analog_stick_l.y, data + 16, 4);
+    memcpy(&state->analog_stick_r.x, data + 20, 4);
+    memcpy(&state->analog_stick_r.y, data + 24, 4);
+    memcpy(&state->six_axis_sensor_acceleration.x, data + 28, 4);
+    memcpy(&state->six_axis_sensor_acceleration.y, data + 32, 4);
+    memcpy(&state->six_axis_sensor_acceleration.z, data + 36, 4);
+    memcpy(&state->six_axis_sensor_angle.x, data + 40, 4);
+    memcpy(&state->six_axis_sensor_angle.y, data + 44, 4);
+    memcpy(&state->six_axis_sensor_angle.z, data + 48, 4);
+    return 0;
+}
+
+int controller_apply_state(const HiddbgHdlsState *state, bool is_long_press)
+{
+    if (!controller_ensure_initialized())
+    {
+        return -1;
+    }
+    update_hdls_state(state, is_long_press);
+    return 0;
 }
 
 void update_hdls_state(const HiddbgHdlsState *args, bool is_long_press)
@@ -8,6 +8,20 @@
 #include <switch/services/hiddbg.h>
 #include "../util/log.h"
 #include <switch/types.h>
+#include "tool_registry.h"
 void controllerFinalize();
 int list_controller(cJSON *tools);
-int call_controller(cJSON *content, const cJSON *arguments);
\ No newline at end of file
+int call_controller(cJSON *content, const cJSON *arguments, ToolContext *ctx);
+int call_controller_doc(cJSON *content, const JsonDoc *doc, int arguments, ToolContext *ctx);
+extern const ToolDescriptor controller_tool;
+
+// 紧凑的二进制手柄状态（小端，共 CONTROLLER_PACKET_SIZE 字节）：
+// u8 version(=1), u8 flags(bit0 长按), u16 保留, u64 buttons, s32 lx, ly, rx, ry,
+// f32 accel x, y, z, f32 angle x, y, z
+#define CONTROLLER_PACKET_VERSION 1
+#define CONTROLLER_PACKET_SIZE 52
+#define CONTROLLER_PACKET_FLAG_LONG_PRESS (1 << 0)
+// 解析失败（长度或版本不符）返回非 0
+int controller_decode_packet(const u8 *data, size_t len, HiddbgHdlsState *state, bool *long_press);
+// 跳过 JSON 直接更新手柄状态，供二进制输入通道使用
+int controller_apply_state(const HiddbgHdlsState *state, bool is_long_press);
\ No newline at end of file
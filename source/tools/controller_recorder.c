@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h> // for snprintf
+#include "../util/heap.h"
 #include "../util/log.h"
 
 typedef struct {
@@ -25,7 +26,7 @@ static void ensure_capacity(size_t want) {
     if (want <= g_capacity) return;
     size_t new_cap = g_capacity ? g_capacity : 256;
     while (new_cap < want) new_cap *= 2;
-    RecordedEvent *n = (RecordedEvent*)realloc(g_events, new_cap * sizeof(RecordedEvent));
+    RecordedEvent *n = (RecordedEvent*)heap_realloc(HEAP_TAG_RECORDER, g_events, new_cap * sizeof(RecordedEvent));
     if (!n) {
         log_error("[recorder] realloc failed, dropping events");
         return; // 不扩容，后续事件将被忽略
@@ -73,6 +74,13 @@ int list_controller_recorder(cJSON *tools) {
     return 0;
 }
 
+const ToolDescriptor controller_recorder_tool = {
+    .name = "controller_recorder",
+    .list = list_controller_recorder,
+    .call = call_controller_recorder,
+    .flags = TOOL_FLAG_NEEDS_ARGS | TOOL_FLAG_BLOCKING,
+};
+
 void recorder_on_update(const HiddbgHdlsState *state, bool long_press) { (void)state; (void)long_press; }
 
 static bool real_state_changed(const HiddbgHdlsState *a, const HiddbgHdlsState *b) {
@@ -162,7 +170,7 @@ static void start_recording(size_t prealloc) {
         return;
     }
     if (prealloc && prealloc > g_capacity) {
-        RecordedEvent *n = (RecordedEvent*)realloc(g_events, prealloc * sizeof(RecordedEvent));
+        RecordedEvent *n = (RecordedEvent*)heap_realloc(HEAP_TAG_RECORDER, g_events, prealloc * sizeof(RecordedEvent));
         if (n) { g_events = n; g_capacity = prealloc; }
     }
     g_count = 0;
@@ -204,50 +212,69 @@ static void clear_events() {
     log_info("[recorder] cleared");
 }
 
-static cJSON *events_to_json() {
+#define DUMP_PROGRESS_INTERVAL 256 // 每序列化多少条事件上报一次进度
+
+// 分批持锁序列化，进度在锁外上报：SSE 下上报会阻塞写 socket，不能卡住 60Hz 的采集线程。
+// 只导出开始时已有的事件；批次之间 g_events 可能被 realloc，每批重新读取
+static cJSON *events_to_json(ToolContext *ctx) {
     cJSON *arr = cJSON_CreateArray();
     mutexLock(&g_recorderMutex);
-    for (size_t i = 0; i < g_count; ++i) {
-        RecordedEvent *e = &g_events[i];
-        cJSON *obj = cJSON_CreateObject();
-        cJSON_AddNumberToObject(obj, "tick", (double)e->tick);
-    cJSON_AddNumberToObject(obj, "buttons", (double)e->state.buttons);
-        cJSON_AddNumberToObject(obj, "lx", e->state.analog_stick_l.x);
-        cJSON_AddNumberToObject(obj, "ly", e->state.analog_stick_l.y);
-        cJSON_AddNumberToObject(obj, "rx", e->state.analog_stick_r.x);
-        cJSON_AddNumberToObject(obj, "ry", e->state.analog_stick_r.y);
-    // from_real 字段已移除（固定真实输入）
-        cJSON_AddNumberToObject(obj, "accel_x", e->state.six_axis_sensor_acceleration.x);
-        cJSON_AddNumberToObject(obj, "accel_y", e->state.six_axis_sensor_acceleration.y);
-        cJSON_AddNumberToObject(obj, "accel_z", e->state.six_axis_sensor_acceleration.z);
-        cJSON_AddNumberToObject(obj, "angle_x", e->state.six_axis_sensor_angle.x);
-        cJSON_AddNumberToObject(obj, "angle_y", e->state.six_axis_sensor_angle.y);
-        cJSON_AddNumberToObject(obj, "angle_z", e->state.six_axis_sensor_angle.z);
-        cJSON_AddBoolToObject(obj, "long_press", e->long_press);
-        cJSON_AddItemToArray(arr, obj);
-    }
+    size_t total = g_count;
     mutexUnlock(&g_recorderMutex);
+    for (size_t i = 0; i < total;) {
+        tool_report_progress(ctx, (double)i, (double)total, "serializing events");
+        mutexLock(&g_recorderMutex);
+        if (total > g_count) total = g_count; // 期间被 clear
+        if (i >= total) {
+            mutexUnlock(&g_recorderMutex);
+            break;
+        }
+        size_t end = total - i > DUMP_PROGRESS_INTERVAL ? i + DUMP_PROGRESS_INTERVAL : total;
+        for (; i < end; ++i) {
+            RecordedEvent *e = &g_events[i];
+            cJSON *obj = cJSON_CreateObject();
+            cJSON_AddNumberToObject(obj, "tick", (double)e->tick);
+        cJSON_AddNumberToObject(obj, "buttons", (double)e->state.buttons);
+            cJSON_AddNumberToObject(obj, "lx", e->state.analog_stick_l.x);
+            cJSON_AddNumberToObject(obj, "ly", e->state.analog_stick_l.y);
+            cJSON_AddNumberToObject(obj, "rx", e->state.analog_stick_r.x);
+            cJSON_AddNumberToObject(obj, "ry", e->state.analog_stick_r.y);
+        // from_real 字段已移除（固定真实输入）
+            cJSON_AddNumberToObject(obj, "accel_x", e->state.six_axis_sensor_acceleration.x);
+            cJSON_AddNumberToObject(obj, "accel_y", e->state.six_axis_sensor_acceleration.y);
+            cJSON_AddNumberToObject(obj, "accel_z", e->state.six_axis_sensor_acceleration.z);
+            cJSON_AddNumberToObject(obj, "angle_x", e->state.six_axis_sensor_angle.x);
+            cJSON_AddNumberToObject(obj, "angle_y", e->state.six_axis_sensor_angle.y);
+            cJSON_AddNumberToObject(obj, "angle_z", e->state.six_axis_sensor_angle.z);
+            cJSON_AddBoolToObject(obj, "long_press", e->long_press);
+            cJSON_AddItemToArray(arr, obj);
+        }
+        mutexUnlock(&g_recorderMutex);
+    }
     return arr;
 }
 
 static bool save_events_to_file(char *out_path_buf, size_t out_size) {
-    if (g_count == 0) return false;
+    mutexLock(&g_recorderMutex);
+    size_t count = g_count;
     // 取第一条或最后一条 tick 作为文件名基准，这里用第一条
-    u64 base_tick = g_events[0].tick;
+    u64 base_tick = count ? g_events[0].tick : 0;
+    mutexUnlock(&g_recorderMutex);
+    if (count == 0) return false;
     char path[256];
     // Switch 上 / 实际映射 sd 根，确保目录存在（简单方式：mkdir 但这里假设 /switch/mcp-server 已被创建，若没创建尝试创建）
     // 使用 standard C I/O
     snprintf(path, sizeof(path), "/switch/mcp-server/input_%llu.json", (unsigned long long)base_tick);
-    cJSON *arr = events_to_json();
+    cJSON *arr = events_to_json(NULL);
     char *json_str = cJSON_PrintUnformatted(arr);
     cJSON_Delete(arr);
     if (!json_str) return false;
     FILE *f = fopen(path, "wb");
-    if (!f) { free(json_str); return false; }
+    if (!f) { cJSON_free(json_str); return false; }
     size_t len = strlen(json_str);
     bool ok = fwrite(json_str, 1, len, f) == len;
     fclose(f);
-    free(json_str);
+    cJSON_free(json_str);
     if (ok && out_path_buf && out_size) {
         strncpy(out_path_buf, path, out_size - 1);
         out_path_buf[out_size - 1] = '\0';
@@ -255,7 +282,7 @@ static bool save_events_to_file(char *out_path_buf, size_t out_size) {
     return ok;
 }
 
-int call_controller_recorder(cJSON *content, const cJSON *arguments) {
+int call_controller_recorder(cJSON *content, const cJSON *arguments, ToolContext *ctx) {
     const cJSON *action = cJSON_GetObjectItem(arguments, "action");
     if (!action || !cJSON_IsString(action)) {
         cJSON *item = cJSON_CreateObject();
@@ -280,12 +307,12 @@ int call_controller_recorder(cJSON *content, const cJSON *arguments) {
         cJSON *jsonItem = cJSON_CreateObject();
         cJSON_AddStringToObject(jsonItem, "type", "text");
         // 将事件数组序列化成字符串
-        cJSON *arr = events_to_json();
+        cJSON *arr = events_to_json(ctx);
         char *arr_str = cJSON_PrintUnformatted(arr);
         cJSON_Delete(arr);
         if (arr_str) {
             cJSON_AddStringToObject(jsonItem, "text", arr_str);
-            free(arr_str);
+            cJSON_free(arr_str);
         } else {
             cJSON_AddStringToObject(jsonItem, "text", "[]");
         }
@@ -294,9 +321,7 @@ int call_controller_recorder(cJSON *content, const cJSON *arguments) {
     } else if (strcmp(act, "save") == 0) {
         char saved_path[256] = {0};
         bool ok = false;
-        mutexLock(&g_recorderMutex); // 保护 g_events 在序列化期间不变化
-        ok = save_events_to_file(saved_path, sizeof(saved_path));
-        mutexUnlock(&g_recorderMutex);
+        ok = save_events_to_file(saved_path, sizeof(saved_path)); // events_to_json 自己分批加锁
         cJSON *item2 = cJSON_CreateObject();
         cJSON_AddStringToObject(item2, "type", "text");
         if (ok) {
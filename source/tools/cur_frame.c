@@ -4,16 +4,21 @@
 #include <switch.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <switch/types.h> // for u8, u32
 #include "../third_party/stb_base64.h"  // 需项目有 base64.h/base64.c
+#include "../util/heap.h"
 #include "../util/log.h"
+#include "../util/pool.h"
+#include "cur_frame.h"
 
 #define CUR_FRAME_WIDTH 1280
 #define CUR_FRAME_HEIGHT 720
-#define JPEG_BUF_SIZE 0x80000 // 官方推荐大小
+#define CAPTURE_LEASE_WAIT_NS 1000000000ULL // 客户端请求等待截图缓冲区的上限，1s
 static Service capssc;
-
-int capture_jpeg_screenshot(char** out_b64);
+// 唯一的截图缓冲区，静态分配且页对齐：截图不再依赖堆，借出期间其他截图等待或失败
+static u8 jpeg_buffer[JPEG_BUF_SIZE] __attribute__((aligned(0x1000)));
+static BufferLease jpeg_lease = BUFFER_LEASE_INIT(jpeg_buffer);
 
 int list_cur_frame(cJSON *tools) {
     // cur_frame 工具
@@ -35,21 +40,77 @@ int list_cur_frame(cJSON *tools) {
     return 0;
 }
 
-int call_cur_frame(cJSON *contents) {
-    char *b64 = NULL;
-    int rc = capture_jpeg_screenshot(&b64);
+int call_cur_frame(cJSON *contents, const cJSON *arguments, ToolContext *ctx) {
+    cJSON *data = NULL;
+    tool_report_progress(ctx, 0, 2, "capturing");
+    int rc = capture_jpeg_screenshot(&data);
+    tool_report_progress(ctx, 1, 2, "captured");
     log_info("[cur_frame] capture_jpeg_screenshot %s.", rc == 0 ? "succeeded" : "failed");
 
     cJSON *item = cJSON_CreateObject();
     cJSON_AddStringToObject(item, "type", "image");
     cJSON_AddStringToObject(item, "mimeType", "image/png");
-    cJSON_AddStringToObject(item, "data", b64);
-    if (b64) free(b64);
+    if (data) cJSON_AddItemToObject(item, "data", data);
     cJSON_AddItemToArray(contents, item);
     log_info("[cur_frame] Success, image added to contents.");
     return 0;
 }
 
+typedef struct {
+    const u8 *data;
+    size_t size;
+    size_t pos;
+} Base64Source;
+
+// 按 3 字节对齐分段编码，只有最后一段带填充
+static size_t produce_base64(void *ctx, char *out, size_t cap) {
+    Base64Source *src = (Base64Source *)ctx;
+    size_t in = (cap - 1) / 4 * 3; // stb_base64_encode 会额外写一个 NUL
+    if (in > src->size - src->pos) in = src->size - src->pos;
+    if (in == 0) return 0;
+    int n = stb_base64_encode(src->data + src->pos, in, out);
+    src->pos += in;
+    return (size_t)n;
+}
+
+int write_cur_frame(JsonWriter *writer, const cJSON *arguments, ToolContext *ctx) {
+    void *jpeg = NULL;
+    u64 jpeg_size = 0;
+    tool_report_progress(ctx, 0, 2, "capturing");
+    int rc = cur_frame_capture_jpeg(0, true, &jpeg, &jpeg_size);
+    tool_report_progress(ctx, 1, 2, "captured");
+    log_info("[cur_frame] cur_frame_capture_jpeg %s.", rc == 0 ? "succeeded" : "failed");
+
+    // 与 call_cur_frame 的输出一致：截图失败时没有 data 字段
+    json_begin_object(writer);
+    json_key(writer, "type");
+    json_string(writer, "image");
+    json_key(writer, "mimeType");
+    json_string(writer, "image/png");
+    if (rc == 0) {
+        // base64 边编码边写 socket，耗时取决于客户端，先把截图复制出来归还缓冲区
+        bool detached = cur_frame_detach_jpeg(&jpeg, jpeg_size);
+        Base64Source src = { (const u8 *)jpeg, (size_t)jpeg_size, 0 };
+        json_key(writer, "data");
+        json_string_produced(writer, produce_base64, &src);
+        if (detached) {
+            heap_free(jpeg);
+        } else {
+            cur_frame_release_jpeg();
+        }
+    }
+    json_end_object(writer);
+    return 0;
+}
+
+const ToolDescriptor cur_frame_tool = {
+    .name = "cur_frame",
+    .list = list_cur_frame,
+    .call = call_cur_frame,
+    .write = write_cur_frame,
+    .flags = TOOL_FLAG_READ_ONLY | TOOL_FLAG_BLOCKING,
+};
+
 Result cur_frameInitialize() {
     Result rc = smGetService(&capssc, "caps:sc");
     if (R_FAILED(rc)) {
@@ -67,21 +128,16 @@ void cur_frameFinalize() {
     }
 }
 
-int capture_jpeg_screenshot(char **out_b64) {
+int cur_frame_capture_jpeg(ViLayerStack layer_stack, bool wait, void **out_jpeg, u64 *out_size) {
     Result rc;
     u64 jpeg_size = 0;
-    size_t heap_free_before_jpeg = 0, heap_free_after_jpeg = 0;
-    svcGetInfo(&heap_free_before_jpeg, 0, 0, 6); // InfoType_HeapUsage = 6
-    log_info("[mem] heap free before jpeg malloc: %zu", heap_free_before_jpeg);
-    void* jpeg_buf = malloc(JPEG_BUF_SIZE);
-    svcGetInfo(&heap_free_after_jpeg, 0, 0, 6);
-    log_info("[mem] heap free after jpeg malloc: %zu", heap_free_after_jpeg);
+    *out_jpeg = NULL;
+    void *jpeg_buf = buffer_lease_acquire(&jpeg_lease, wait ? CAPTURE_LEASE_WAIT_NS : 0);
     if (!jpeg_buf) {
-        log_error("malloc failed\n");
-        return -1;
+        if (wait) log_error("[cur_frame] capture buffer busy, giving up after %llu ms", CAPTURE_LEASE_WAIT_NS / 1000000ULL);
+        return CUR_FRAME_BUSY;
     }
 
-    ViLayerStack layer_stack = 0; // 通常用0，或用viGetDefaultLayerStack()
     s64 timeout = 100000000; // 100ms
 
     const struct {
@@ -97,20 +153,51 @@ int capture_jpeg_screenshot(char **out_b64) {
 
     if (R_FAILED(rc)) {
         log_error("capsscCaptureJpegScreenShot failed: %x\n", rc);
-        free(jpeg_buf);
-        *out_b64 = NULL;
+        buffer_lease_release(&jpeg_lease);
         return -3;
-    } else {
-        log_info("Screenshot captured, jpeg size: %llu\n", jpeg_size);
-        *out_b64 = malloc(jpeg_size * 4 / 3 + 16 + 1); // 多分配1字节用于 null 结尾
-        if (!*out_b64) {
-            log_error("malloc for base64 buffer failed\n");
-            free(jpeg_buf);
-            return -4;
-        }
-        int b64_len = stb_base64_encode(jpeg_buf, jpeg_size, *out_b64);
-        (*out_b64)[b64_len] = '\0'; // 保证 null 结尾
-        free(jpeg_buf);
-        return 0;
     }
+    log_info("Screenshot captured, jpeg size: %llu\n", jpeg_size);
+    *out_jpeg = jpeg_buf;
+    *out_size = jpeg_size;
+    return 0;
+}
+
+void cur_frame_release_jpeg() {
+    buffer_lease_release(&jpeg_lease);
+}
+
+bool cur_frame_detach_jpeg(void **jpeg, u64 size) {
+    void *copy = heap_alloc(HEAP_TAG_CUR_FRAME, size);
+    if (!copy) {
+        log_warning("[cur_frame] no heap for a %llu byte frame copy, sending from the capture buffer", size);
+        return false;
+    }
+    memcpy(copy, *jpeg, size);
+    buffer_lease_release(&jpeg_lease);
+    *jpeg = copy;
+    return true;
+}
+
+int capture_jpeg_screenshot(cJSON **out_item) {
+    void *jpeg_buf = NULL;
+    u64 jpeg_size = 0;
+    *out_item = NULL;
+    int rc = cur_frame_capture_jpeg(0, true, &jpeg_buf, &jpeg_size); // layer stack 通常用0，或用viGetDefaultLayerStack()
+    if (rc != 0) return rc;
+    // 直接编码进 cJSON 节点持有的字符串，省去一份 base64 副本；cJSON_Delete 经 hooks 释放它
+    char *b64 = (char *)heap_alloc(HEAP_TAG_CUR_FRAME, (jpeg_size + 2) / 3 * 4 + 1); // 多分配1字节用于 null 结尾
+    cJSON *item = b64 ? cJSON_CreateString("") : NULL;
+    if (!item) {
+        log_error("malloc for base64 string (%llu bytes jpeg) failed\n", jpeg_size);
+        heap_free(b64);
+        cur_frame_release_jpeg();
+        return -4;
+    }
+    int b64_len = stb_base64_encode(jpeg_buf, jpeg_size, b64);
+    b64[b64_len] = '\0'; // 保证 null 结尾
+    cur_frame_release_jpeg();
+    cJSON_free(item->valuestring);
+    item->valuestring = b64;
+    *out_item = item;
+    return 0;
 }
\ No newline at end of file
@@ -1,10 +1,32 @@
 #include "../third_party/cJSON.h"
-#include <switch/types.h> // for u8, u32
+#include <switch.h>
+#include "tool_registry.h"
 
 
 int list_cur_frame(cJSON *tools);
 
-int call_cur_frame(cJSON *contents);
+int call_cur_frame(cJSON *contents, const cJSON *arguments, ToolContext *ctx);
+// 流式版本：base64 边编码边写出，不为整张图的 base64 分配内存
+int write_cur_frame(JsonWriter *writer, const cJSON *arguments, ToolContext *ctx);
+extern const ToolDescriptor cur_frame_tool;
+
+#define CUR_FRAME_BUSY -2 // 截图缓冲区正被占用（wait 时为等待超时）
+
+#define JPEG_BUF_SIZE 0x80000 // 官方推荐大小
+#define CUR_FRAME_JPEG_EXPECTED (300 * 1024) // 720p 截图 JPEG 的实际上限，远小于缓冲区
+#define CUR_FRAME_BASE64_SIZE(n) (((n) + 2) / 3 * 4)
+// cJSON 路径（resources/read、带 progressToken 的 SSE）的峰值堆：base64 字符串加上按 2 倍增长的打印缓冲
+#define CUR_FRAME_CJSON_HEAP(n) (CUR_FRAME_BASE64_SIZE(n) * 3)
+
+// 截取当前画面为 JPEG，写入唯一的静态截图缓冲区。成功时调用方借用该缓冲区，用完必须调用
+// cur_frame_release_jpeg；wait 为 false 时缓冲区被占用立即返回 CUR_FRAME_BUSY
+int cur_frame_capture_jpeg(ViLayerStack layer_stack, bool wait, void **out_jpeg, u64 *out_size);
+void cur_frame_release_jpeg();
+// 把借用中的截图复制到堆上并归还截图缓冲区，之后向慢速客户端发送时不再占住它；成功时 *jpeg 改指向副本，
+// 用完由调用方 heap_free。堆不足时保留借用并返回 false，调用方发送后照常 cur_frame_release_jpeg
+bool cur_frame_detach_jpeg(void **jpeg, u64 size);
+// 截图并把 base64 编码进一个 cJSON 字符串节点，成功时 *out_item 由调用方挂到树上
+int capture_jpeg_screenshot(cJSON **out_item);
 
 Result cur_frameInitialize();
 void cur_frameFinalize();
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "diagnostics.h"
+#include "../util/arena.h"
+#include "../util/heap.h"
+#include "../util/log.h"
+
+int list_diagnostics(cJSON *tools) {
+    cJSON *tool = cJSON_CreateObject();
+    cJSON_AddStringToObject(tool, "name", "diagnostics");
+    cJSON_AddStringToObject(tool, "title", "diagnostics");
+    cJSON_AddStringToObject(tool, "description", "report heap usage per subsystem (live, peak, largest allocation, failures) and free heap");
+
+    cJSON *inputSchema = cJSON_CreateObject();
+    cJSON_AddStringToObject(inputSchema, "type", "object");
+    cJSON_AddItemToObject(inputSchema, "properties", cJSON_CreateObject());
+    cJSON_AddItemToObject(inputSchema, "required", cJSON_CreateArray());
+    cJSON_AddItemToObject(tool, "inputSchema", inputSchema);
+    cJSON_AddItemToArray(tools, tool);
+    return 0;
+}
+
+int call_diagnostics(cJSON *content, const cJSON *arguments, ToolContext *ctx) {
+    cJSON *report = cJSON_CreateObject();
+    cJSON *heap = cJSON_AddObjectToObject(report, "heap");
+    cJSON_AddNumberToObject(heap, "size", (double)heap_size());
+    cJSON_AddNumberToObject(heap, "available", (double)heap_available());
+    cJSON_AddNumberToObject(heap, "largest_free", (double)heap_largest_free());
+
+    cJSON *tags = cJSON_AddObjectToObject(report, "tags");
+    for (int i = 0; i < HEAP_TAG_COUNT; ++i) {
+        HeapTagStats s;
+        heap_tag_stats((HeapTag)i, &s);
+        cJSON *tag = cJSON_AddObjectToObject(tags, heap_tag_name((HeapTag)i));
+        cJSON_AddNumberToObject(tag, "live_bytes", (double)s.live_bytes);
+        cJSON_AddNumberToObject(tag, "peak_bytes", (double)s.peak_bytes);
+        cJSON_AddNumberToObject(tag, "largest_alloc", (double)s.largest);
+        cJSON_AddNumberToObject(tag, "live_blocks", (double)s.live_blocks);
+        cJSON_AddNumberToObject(tag, "allocs", (double)s.allocs);
+        cJSON_AddNumberToObject(tag, "failures", (double)s.failures);
+    }
+
+    RequestArenaStats arena;
+    request_arena_stats(&arena);
+    cJSON *arenas = cJSON_AddObjectToObject(report, "request_arena");
+    cJSON_AddNumberToObject(arenas, "peak_bytes", (double)arena.peak_bytes);
+    cJSON_AddNumberToObject(arenas, "requests", (double)arena.requests);
+    cJSON_AddNumberToObject(arenas, "fallback_allocs", (double)arena.fallback_allocs);
+    cJSON_AddNumberToObject(arenas, "unavailable", (double)arena.unavailable);
+
+    // 与 controller_recorder 的 dump 一样以 JSON 文本返回
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "type", "text");
+    char *text = cJSON_PrintUnformatted(report);
+    cJSON_Delete(report);
+    cJSON_AddStringToObject(item, "text", text ? text : "{}");
+    cJSON_free(text);
+    cJSON_AddItemToArray(content, item);
+    heap_log_summary("diagnostics");
+    return text ? 0 : 1;
+}
+
+const ToolDescriptor diagnostics_tool = {
+    .name = "diagnostics",
+    .list = list_diagnostics,
+    .call = call_diagnostics,
+    .flags = TOOL_FLAG_READ_ONLY,
+};
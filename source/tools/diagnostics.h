@@ -0,0 +1,8 @@
+// 运行时诊断工具：按子系统报告堆用量与高水位，用于确定堆与录制容量的大小
+#pragma once
+#include "../third_party/cJSON.h"
+#include "tool_registry.h"
+
+int list_diagnostics(cJSON *tools);
+int call_diagnostics(cJSON *content, const cJSON *arguments, ToolContext *ctx);
+extern const ToolDescriptor diagnostics_tool;
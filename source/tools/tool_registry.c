@@ -0,0 +1,34 @@
+#include "tool_registry.h"
+#include <stdlib.h>
+#include <string.h>
+#include "controller.h"
+#include "controller_recorder.h"
+#include "cur_frame.h"
+#include "diagnostics.h"
+
+// 新增工具只需在此登记，必须按 name 字典序排列
+static const ToolDescriptor *const tools[] = {
+    &controller_tool,
+    &controller_recorder_tool,
+    &cur_frame_tool,
+    &diagnostics_tool,
+};
+
+#define TOOL_COUNT ((int)(sizeof(tools) / sizeof(tools[0])))
+
+static int tool_cmp(const void *key, const void *elem) {
+    return strcmp((const char *)key, (*(const ToolDescriptor *const *)elem)->name);
+}
+
+const ToolDescriptor *tool_registry_find(const char *name) {
+    const ToolDescriptor *const *found = (const ToolDescriptor *const *)bsearch(name, tools, TOOL_COUNT, sizeof(tools[0]), tool_cmp);
+    return found ? *found : NULL;
+}
+
+int tool_registry_count() {
+    return TOOL_COUNT;
+}
+
+const ToolDescriptor *tool_registry_at(int index) {
+    return (index >= 0 && index < TOOL_COUNT) ? tools[index] : NULL;
+}
@@ -0,0 +1,37 @@
+// MCP 工具注册表：每个工具导出一个描述符，tools/list 与 tools/call 均查表完成
+#pragma once
+#include "../third_party/cJSON.h"
+#include "../util/json_writer.h"
+#include "../util/json_doc.h"
+
+#define TOOL_FLAG_READ_ONLY  (1 << 0) // 不改变设备状态
+#define TOOL_FLAG_BLOCKING   (1 << 1) // 可能长时间阻塞（截图、文件 IO 等）
+#define TOOL_FLAG_NEEDS_ARGS (1 << 2) // 调用时必须提供 arguments
+#define TOOL_FLAG_INPUT      (1 << 3) // 注入手柄输入，延迟敏感，优先调度
+
+// 工具执行上下文：长耗时工具可通过它上报进度（transport 不支持时 progress 为 NULL）
+typedef struct ToolContext {
+    void (*progress)(struct ToolContext *ctx, double progress, double total, const char *message);
+} ToolContext;
+
+static inline void tool_report_progress(ToolContext *ctx, double progress, double total, const char *message) {
+    if (ctx && ctx->progress) ctx->progress(ctx, progress, total, message);
+}
+
+typedef struct {
+    const char *name;
+    // 向 tools/list 的数组追加工具 schema
+    int (*list)(cJSON *tools);
+    // 执行工具，结果追加到 content 数组，返回非 0 表示 isError；ctx 可能为 NULL
+    int (*call)(cJSON *content, const cJSON *arguments, ToolContext *ctx);
+    // 可选：把 content 数组的元素直接写入流式 writer，不构建 cJSON 树；返回非 0 表示 isError
+    int (*write)(JsonWriter *writer, const cJSON *arguments, ToolContext *ctx);
+    // 可选：与 call 相同，但参数直接从原地解析的请求体读取（arguments 为 token 下标），省去构建 cJSON 树
+    int (*call_doc)(cJSON *content, const JsonDoc *doc, int arguments, ToolContext *ctx);
+    unsigned flags;
+} ToolDescriptor;
+
+// 按名称二分查找，未注册返回 NULL
+const ToolDescriptor *tool_registry_find(const char *name);
+int tool_registry_count();
+const ToolDescriptor *tool_registry_at(int index);
@@ -1,308 +1,886 @@
 #include "streamable_http.h"
-#include "../tools/controller_recorder.h"
+#include "../tools/tool_registry.h"
+#include "resources.h"
 
-static char protocol_version[32] = "2025-06-18";
-static char session_id[40] = {0};
+static void send_text(int client_fd, bool keep_alive, const char *status, const char *content_type, const char *body) {
+    struct iovec iov = { (void *)body, body ? strlen(body) : 0 };
+    http_write_response(client_fd, status, content_type, NULL, &iov, body ? 1 : 0, keep_alive);
+}
+
+// 写出 200 响应，按协商结果压缩；分块流中途失败时连接已损坏，shutdown 后由 reactor 回收
+static void send_body(int client_fd, bool keep_alive, HttpEncoding encoding, const char *content_type, const char *extra_headers,
+                      const struct iovec *body, int body_cnt) {
+    if (http_write_response_encoded(client_fd, "200 OK", content_type, extra_headers, body, body_cnt, keep_alive, encoding) != 0 &&
+        encoding != HTTP_ENCODING_IDENTITY) {
+        shutdown(client_fd, SHUT_RDWR);
+    }
+}
+
+// 序列化 JSON-RPC 响应并与 header 一次写出
+static void send_json(int client_fd, bool keep_alive, HttpEncoding encoding, const char *extra_headers, const cJSON *json) {
+    size_t len = 0;
+    char *str = cJSON_PrintUnformattedWithLength(json, &len);
+    if (!str) {
+        log_error("Failed to serialize response");
+        send_text(client_fd, keep_alive, "500 Internal Server Error", "application/json", "{\"error\":\"Out of memory\"}\n");
+        return;
+    }
+    struct iovec iov = { str, len };
+    send_body(client_fd, keep_alive, encoding, "application/json", extra_headers, &iov, 1);
+    cJSON_free(str);
+}
+
+typedef enum {
+    MCP_REPLY_NONE = 0,     // 通知，无响应体
+    MCP_REPLY_RESULT,       // result 为动态构建的 cJSON 树
+    MCP_REPLY_CACHED,       // result 为预序列化的缓存文本
+    MCP_REPLY_UNSUPPORTED,  // 未知方法或缺少 id
+    MCP_REPLY_ERROR,        // JSON-RPC 错误，见 error_code / error_message
+} McpReplyKind;
+
+typedef struct {
+    McpReplyKind kind;
+    cJSON *result;
+    CachedBlob *cached;
+    int error_code;
+    const char *error_message;
+    char extra_headers[128];
+} McpReply;
+
+// session_id 为请求所属会话，initialize 时为 NULL
+typedef void (*McpMethodHandler)(const cJSON *params, const char *session_id, McpReply *reply);
+
+#define MCP_METHOD_REQUIRES_ID (1 << 0) // 必须是带 id 的请求，不能作为通知调用
+#define MCP_METHOD_NO_BATCH    (1 << 1) // 不允许出现在 batch 中
+
+#define MAX_BATCH_ENTRIES 16 // batch 用于成组的手柄指令，超过该条目数整批按 Invalid Request 拒绝
+
+// JSON-RPC 2.0 错误码
+#define RPC_PARSE_ERROR      -32700
+#define RPC_INVALID_REQUEST  -32600
+#define RPC_METHOD_NOT_FOUND -32601
+#define RPC_INTERNAL_ERROR   -32603
+#define RPC_INVALID_PARAMS   -32602
+#define RPC_SERVER_BUSY      -32000 // 实现自定义：会话等资源已耗尽
+#define RPC_RESOURCE_NOT_FOUND -32002 // MCP 约定
+
+typedef struct {
+    const char *name;
+    McpMethodHandler handler;
+    unsigned flags;
+} McpMethod;
+
+// 缓存的 result 与本次请求的 id 拼接后一次写出，不再构建/打印 cJSON 树
+static void send_cached_result(int client_fd, bool keep_alive, HttpEncoding encoding, const char *extra_headers, const cJSON *id, CachedBlob *blob) {
+    static const char prefix[] = "{\"jsonrpc\":\"2.0\",\"id\":";
+    static const char middle[] = ",\"result\":";
+    char id_buf[128];
+    char *id_str = id_buf;
+    size_t id_len = 0;
+    if (!id) {
+        strcpy(id_buf, "null");
+        id_len = 4;
+    } else if (cJSON_PrintPreallocated((cJSON *)id, id_buf, sizeof(id_buf), false)) {
+        id_len = strlen(id_buf);
+    } else {
+        id_str = cJSON_PrintUnformattedWithLength(id, &id_len); // 超长字符串 id
+    }
+    if (!id_str) {
+        send_text(client_fd, keep_alive, "500 Internal Server Error", "application/json", "{\"error\":\"Out of memory\"}\n");
+        return;
+    }
+    struct iovec iov[5] = {
+        { (void *)prefix, sizeof(prefix) - 1 },
+        { id_str, id_len },
+        { (void *)middle, sizeof(middle) - 1 },
+        { blob->data, blob->len },
+        { (void *)"}", 1 },
+    };
+    send_body(client_fd, keep_alive, encoding, "application/json", extra_headers, iov, 5);
+    if (id_str != id_buf) cJSON_free(id_str);
+}
+
+static void release_reply(McpReply *reply) {
+    if (reply->result) cJSON_Delete(reply->result);
+    reply->result = NULL;
+    response_cache_release(reply->cached);
+    reply->cached = NULL;
+}
+
+static cJSON *rpc_envelope(const cJSON *id) {
+    cJSON *resp = cJSON_CreateObject();
+    cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
+    cJSON_AddItemToObject(resp, "id", id ? cJSON_Duplicate(id, 1) : cJSON_CreateNull());
+    return resp;
+}
+
+static cJSON *rpc_error(const cJSON *id, int code, const char *message) {
+    cJSON *resp = rpc_envelope(id);
+    cJSON *error = cJSON_CreateObject();
+    cJSON_AddNumberToObject(error, "code", code);
+    cJSON_AddStringToObject(error, "message", message);
+    cJSON_AddItemToObject(resp, "error", error);
+    return resp;
+}
+
+// 把 reply 转成完整的 JSON-RPC 响应对象并释放 reply；通知返回 NULL
+static cJSON *reply_to_json(const cJSON *id, McpReply *reply) {
+    cJSON *resp = NULL;
+    if (reply->kind == MCP_REPLY_RESULT && reply->result) {
+        resp = rpc_envelope(id);
+        cJSON_AddItemToObject(resp, "result", reply->result);
+        reply->result = NULL; // 所有权已转移给 resp
+    } else if (reply->kind == MCP_REPLY_CACHED && reply->cached) {
+        resp = rpc_envelope(id);
+        cJSON_AddRawToObject(resp, "result", reply->cached->data);
+    } else if (reply->kind == MCP_REPLY_UNSUPPORTED) {
+        resp = rpc_error(id, RPC_METHOD_NOT_FOUND, "Method not found");
+    } else if (reply->kind == MCP_REPLY_ERROR) {
+        resp = rpc_error(id, reply->error_code, reply->error_message);
+    } else if (reply->kind != MCP_REPLY_NONE) {
+        resp = rpc_error(id, RPC_INTERNAL_ERROR, "Internal error");
+    }
+    release_reply(reply);
+    return resp;
+}
+
+static void send_reply(int client_fd, bool keep_alive, HttpEncoding encoding, const cJSON *id, McpReply *reply) {
+    const char *extra = reply->extra_headers[0] ? reply->extra_headers : NULL;
+    switch (reply->kind) {
+    case MCP_REPLY_NONE:
+        send_text(client_fd, keep_alive, "202 Accepted", NULL, NULL);
+        break;
+    case MCP_REPLY_CACHED:
+        if (reply->cached) {
+            send_cached_result(client_fd, keep_alive, encoding, extra, id, reply->cached);
+        } else {
+            send_text(client_fd, keep_alive, "500 Internal Server Error", "application/json", "{\"error\":\"Out of memory\"}\n");
+        }
+        break;
+    case MCP_REPLY_RESULT:
+    case MCP_REPLY_ERROR: {
+        cJSON *resp = reply_to_json(id, reply);
+        send_json(client_fd, keep_alive, encoding, extra, resp);
+        cJSON_Delete(resp);
+        break;
+    }
+    default:
+        send_text(client_fd, keep_alive, "400 Bad Request", "application/json", "{\"error\":\"Unsupported method\"}\n");
+        break;
+    }
+    release_reply(reply);
+}
+
+static void reply_error(McpReply *reply, int code, const char *message) {
+    reply->kind = MCP_REPLY_ERROR;
+    reply->error_code = code;
+    reply->error_message = message;
+}
+
+// 处理 initialize
+static void method_initialize(const cJSON *params, const char *session_id, McpReply *reply) {
+    if (session_id) {
+        // 连接建立时已分配会话的传输（WebSocket）
+        reply->kind = MCP_REPLY_CACHED;
+        reply->cached = response_cache_acquire(CACHED_INITIALIZE);
+        return;
+    }
+    const cJSON *version = params ? cJSON_GetObjectItem(params, "protocolVersion") : NULL;
+    char new_id[SESSION_ID_SIZE];
+    if (session_create(cJSON_IsString(version) ? version->valuestring : NULL, false, new_id) != SESSION_OK) {
+        log_error("No free session for initialize");
+        reply_error(reply, RPC_SERVER_BUSY, "Too many sessions");
+        return;
+    }
+    snprintf(reply->extra_headers, sizeof(reply->extra_headers), "Mcp-Session-Id: %s\r\nMCP-Protocol-Version: %s\r\n", new_id, MCP_PROTOCOL_VERSION);
+    reply->kind = MCP_REPLY_CACHED;
+    reply->cached = response_cache_acquire(CACHED_INITIALIZE);
+}
+
+static void method_initialized(const cJSON *params, const char *session_id, McpReply *reply) {
+    reply->kind = MCP_REPLY_NONE;
+}
 
-// 生成随机 session id
-void gen_session_id(char *buf, int len) {
-    for (int i = 0; i < len-1; ++i) {
-        int r = rand() % 62;
-        buf[i] = (r < 10) ? ('0'+r) : (r < 36 ? 'A'+r-10 : 'a'+r-36);
+static void method_ping(const cJSON *params, const char *session_id, McpReply *reply) {
+    reply->kind = MCP_REPLY_CACHED;
+    reply->cached = response_cache_acquire(CACHED_PING);
+}
+
+// 取 params.uri，并确认资源存在；失败时已填好错误回复
+static const char *resource_uri(const cJSON *params, McpReply *reply) {
+    const cJSON *uri = params ? cJSON_GetObjectItem(params, "uri") : NULL;
+    if (!cJSON_IsString(uri)) {
+        reply_error(reply, RPC_INVALID_PARAMS, "Missing uri");
+        return NULL;
+    }
+    if (!resources_exists(uri->valuestring)) {
+        reply_error(reply, RPC_RESOURCE_NOT_FOUND, "Resource not found");
+        return NULL;
     }
-    buf[len-1] = '\0';
+    return uri->valuestring;
+}
+
+// 处理 resources/list 方法
+static void method_resources_list(const cJSON *params, const char *session_id, McpReply *reply) {
+    cJSON *result = cJSON_CreateObject();
+    cJSON *resources = cJSON_CreateArray();
+
+    // 当前帧资源
+    resources_list(resources);
+
+    cJSON_AddItemToObject(result, "resources", resources);
+    // cJSON_AddStringToObject(result, "nextCursor", "");
+    reply->kind = MCP_REPLY_RESULT;
+    reply->result = result;
+}
+
+// 处理 resources/read 方法
+static void method_resources_read(const cJSON *params, const char *session_id, McpReply *reply) {
+    const char *uri = resource_uri(params, reply);
+    if (!uri) return;
+    cJSON *contents = cJSON_CreateArray();
+    if (resources_read(uri, contents) != 0) {
+        cJSON_Delete(contents);
+        reply_error(reply, RPC_INTERNAL_ERROR, "Failed to read resource");
+        return;
+    }
+    cJSON *result = cJSON_CreateObject();
+    cJSON_AddItemToObject(result, "contents", contents);
+    reply->kind = MCP_REPLY_RESULT;
+    reply->result = result;
+}
+
+// 处理 resources/subscribe 方法，资源变化时通过该会话的 SSE 流推送 notifications/resources/updated
+static void method_resources_subscribe(const cJSON *params, const char *session_id, McpReply *reply) {
+    const char *uri = resource_uri(params, reply);
+    if (!uri) return;
+    int rc = session_subscribe(session_id, uri);
+    if (rc == SESSION_ERR_FULL) {
+        reply_error(reply, RPC_SERVER_BUSY, "Too many subscriptions");
+        return;
+    }
+    reply->kind = MCP_REPLY_RESULT;
+    reply->result = cJSON_CreateObject();
+}
+
+static void method_resources_unsubscribe(const cJSON *params, const char *session_id, McpReply *reply) {
+    const char *uri = resource_uri(params, reply);
+    if (!uri) return;
+    session_unsubscribe(session_id, uri);
+    reply->kind = MCP_REPLY_RESULT;
+    reply->result = cJSON_CreateObject();
+}
+
+// 处理 tools/list 方法
+static void method_tools_list(const cJSON *params, const char *session_id, McpReply *reply) {
+    reply->kind = MCP_REPLY_CACHED;
+    reply->cached = response_cache_acquire(CACHED_TOOLS_LIST);
+}
+
+static cJSON *tool_result(cJSON *content, int isError) {
+    cJSON *result = cJSON_CreateObject();
+    cJSON_AddItemToObject(result, "content", content);
+    cJSON_AddBoolToObject(result, "isError", isError);
+    return result;
+}
+
+// 执行 tools/call，按工具名查表分发，返回 result 对象
+static cJSON *run_tool_call(const cJSON *params, ToolContext *ctx) {
+    const cJSON *tool_name = params ? cJSON_GetObjectItem(params, "name") : NULL;
+    const cJSON *arguments = params ? cJSON_GetObjectItem(params, "arguments") : NULL;
+    const ToolDescriptor *tool = cJSON_IsString(tool_name) ? tool_registry_find(tool_name->valuestring) : NULL;
+
+    cJSON *content = cJSON_CreateArray();
+    int isError = 0;
+
+    if (tool && (arguments || !(tool->flags & TOOL_FLAG_NEEDS_ARGS))) {
+        isError = tool->call(content, arguments, ctx);
+    } else {
+        isError = 1;
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "type", "text");
+        cJSON_AddStringToObject(item, "text", "Unknown tool or missing arguments");
+        cJSON_AddItemToArray(content, item);
+    }
+    return tool_result(content, isError);
+}
+
+// 处理 tools/call 方法
+static void method_tools_call(const cJSON *params, const char *session_id, McpReply *reply) {
+    reply->kind = MCP_REPLY_RESULT;
+    reply->result = run_tool_call(params, NULL);
+}
+
+// 按 name 字典序排列，供 bsearch 查找
+static const McpMethod mcp_methods[] = {
+    { "initialize",                method_initialize,            MCP_METHOD_NO_BATCH },
+    { "notifications/initialized", method_initialized,           0 },
+    { "ping",                      method_ping,                  MCP_METHOD_REQUIRES_ID },
+    { "resources/list",            method_resources_list,        MCP_METHOD_REQUIRES_ID },
+    { "resources/read",            method_resources_read,        MCP_METHOD_REQUIRES_ID | MCP_METHOD_NO_BATCH },
+    { "resources/subscribe",       method_resources_subscribe,   MCP_METHOD_REQUIRES_ID },
+    { "resources/unsubscribe",     method_resources_unsubscribe, MCP_METHOD_REQUIRES_ID },
+    { "tools/call",                method_tools_call,            MCP_METHOD_REQUIRES_ID },
+    { "tools/list",                method_tools_list,            MCP_METHOD_REQUIRES_ID },
+};
+
+static int method_cmp(const void *key, const void *elem) {
+    return strcmp((const char *)key, ((const McpMethod *)elem)->name);
+}
+
+static const McpMethod *find_method(const char *name) {
+    return (const McpMethod *)bsearch(name, mcp_methods, sizeof(mcp_methods) / sizeof(mcp_methods[0]), sizeof(McpMethod), method_cmp);
+}
+
+typedef struct {
+    ToolContext ctx; // 必须是第一个成员，进度回调据此还原 SseToolStream
+    int client_fd;
+    const cJSON *progress_token;
+    bool failed;
+    bool message_open; // 最终消息已开始经 JsonWriter 分段写出，不能再插入其它事件
+} SseToolStream;
+
+static const char sse_message_prefix[] = "event: message\ndata: ";
+
+// 以一个 SSE 事件（一个 HTTP chunk）写出 JSON-RPC 消息
+static void stream_event(SseToolStream *stream, const cJSON *msg) {
+    if (stream->failed || stream->message_open) return;
+    size_t len = 0;
+    char *str = cJSON_PrintUnformattedWithLength(msg, &len);
+    if (!str) return;
+    struct iovec parts[3] = {
+        { (void *)sse_message_prefix, sizeof(sse_message_prefix) - 1 },
+        { str, len },
+        { (void *)"\n\n", 2 },
+    };
+    if (http_write_chunk(stream->client_fd, parts, 3) != 0) stream->failed = true;
+    cJSON_free(str);
+}
+
+static void stream_progress(ToolContext *ctx, double progress, double total, const char *message) {
+    SseToolStream *stream = (SseToolStream *)ctx;
+    // 进度只是提示，最终消息写到一半时直接丢弃
+    if (stream->failed || stream->message_open) return;
+    cJSON *note = cJSON_CreateObject();
+    cJSON_AddStringToObject(note, "jsonrpc", "2.0");
+    cJSON_AddStringToObject(note, "method", "notifications/progress");
+    cJSON *params = cJSON_CreateObject();
+    cJSON_AddItemToObject(params, "progressToken", cJSON_Duplicate(stream->progress_token, 1));
+    cJSON_AddNumberToObject(params, "progress", progress);
+    if (total > 0) cJSON_AddNumberToObject(params, "total", total);
+    if (message) cJSON_AddStringToObject(params, "message", message);
+    cJSON_AddItemToObject(note, "params", params);
+    stream_event(stream, note);
+    cJSON_Delete(note);
+}
+
+// 客户端接受 SSE 且调用的是长耗时工具时，以 text/event-stream 响应；流以 chunk 写出，需要 HTTP/1.1
+static bool wants_event_stream(const HttpRequest *req, const char *method, const cJSON *params) {
+    if (req->version_minor < 1 || strcmp(method, "tools/call") != 0) return false;
+    if (!http_header_has_token(http_request_header(req, "Accept"), "text/event-stream")) return false;
+    const cJSON *tool_name = params ? cJSON_GetObjectItem(params, "name") : NULL;
+    const ToolDescriptor *tool = cJSON_IsString(tool_name) ? tool_registry_find(tool_name->valuestring) : NULL;
+    return tool && (tool->flags & TOOL_FLAG_BLOCKING);
+}
+
+static const cJSON *progress_token(const cJSON *params) {
+    const cJSON *meta = params ? cJSON_GetObjectItem(params, "_meta") : NULL;
+    return meta ? cJSON_GetObjectItem(meta, "progressToken") : NULL;
+}
+
+// /metrics 的 tool 标签：只用工具表中的名字，避免客户端传入的任意字符串造成标签爆炸
+static const char *metrics_tool_label(const char *method, const cJSON *params) {
+    if (strcmp(method, "tools/call") != 0) return NULL;
+    const cJSON *tool_name = params ? cJSON_GetObjectItem(params, "name") : NULL;
+    const ToolDescriptor *tool = cJSON_IsString(tool_name) ? tool_registry_find(tool_name->valuestring) : NULL;
+    return tool ? tool->name : "unknown";
+}
+
+#define JSON_STREAM_BUFFER 4096
+
+static int write_chunk_flush(void *ctx, const char *data, size_t len) {
+    struct iovec part = { (void *)data, len };
+    return http_write_chunk(*(const int *)ctx, &part, 1);
+}
+
+// 工具提供 write 时 tools/call 的响应边生成边以 chunk 写出（需要 HTTP/1.1），内存占用与响应大小无关
+static const ToolDescriptor *json_stream_tool(const HttpRequest *req, const char *method, const cJSON *params) {
+    if (req->version_minor < 1 || strcmp(method, "tools/call") != 0) return NULL;
+    const cJSON *tool_name = params ? cJSON_GetObjectItem(params, "name") : NULL;
+    const ToolDescriptor *tool = cJSON_IsString(tool_name) ? tool_registry_find(tool_name->valuestring) : NULL;
+    if (!tool || !tool->write) return NULL;
+    // 参数缺失的错误响应仍由 run_tool_call 生成
+    if ((tool->flags & TOOL_FLAG_NEEDS_ARGS) && !cJSON_GetObjectItem(params, "arguments")) return NULL;
+    return tool;
+}
+
+// 写出 tools/call 的完整 JSON-RPC 响应，content 由工具直接写入
+static void write_tool_response(JsonWriter *w, const cJSON *id, const cJSON *params, const ToolDescriptor *tool, ToolContext *ctx) {
+    json_begin_object(w);
+    json_key(w, "jsonrpc");
+    json_string(w, "2.0");
+    json_key(w, "id");
+    json_value(w, id);
+    json_key(w, "result");
+    json_begin_object(w);
+    json_key(w, "content");
+    json_begin_array(w);
+    int isError = tool->write(w, cJSON_GetObjectItem(params, "arguments"), ctx);
+    json_end_array(w);
+    json_key(w, "isError");
+    json_bool(w, isError != 0);
+    json_end_object(w);
+    json_end_object(w);
+}
+
+// 最终消息的 SSE 分帧：首段前加事件头，消息结束后由调用方补上空行。
+// 不格式化的 JSON 中没有换行，整条消息始终是同一个 data 行
+static int sse_message_flush(void *ctx, const char *data, size_t len) {
+    SseToolStream *stream = (SseToolStream *)ctx;
+    if (stream->failed) return -1;
+    struct iovec parts[2] = {
+        { (void *)sse_message_prefix, sizeof(sse_message_prefix) - 1 },
+        { (void *)data, len },
+    };
+    int rc = stream->message_open ? http_write_chunk(stream->client_fd, &parts[1], 1) : http_write_chunk(stream->client_fd, parts, 2);
+    stream->message_open = true;
+    if (rc != 0) stream->failed = true;
+    return rc;
+}
+
+// 立即写出 SSE 响应头，工具执行期间推送 notifications/progress，最后推送结果。
+// 工具提供 write 时结果经 JsonWriter 分段写出，不构建 cJSON 树
+static void stream_tools_call(int client_fd, bool keep_alive, const cJSON *id, const cJSON *params, const ToolDescriptor *write_tool) {
+    if (http_write_stream_header(client_fd, "200 OK", "text/event-stream", "Cache-Control: no-cache\r\n", keep_alive) != 0) {
+        shutdown(client_fd, SHUT_RDWR);
+        return;
+    }
+    const cJSON *token = progress_token(params);
+    SseToolStream stream = {
+        .ctx = { .progress = token ? stream_progress : NULL },
+        .client_fd = client_fd,
+        .progress_token = token,
+        .failed = false,
+        .message_open = false,
+    };
+    if (write_tool) {
+        char buf[JSON_STREAM_BUFFER];
+        JsonWriter w;
+        json_writer_init(&w, buf, sizeof(buf), sse_message_flush, &stream);
+        write_tool_response(&w, id, params, write_tool, &stream.ctx);
+        struct iovec end = { (void *)"\n\n", 2 };
+        if (json_writer_finish(&w) != 0 || http_write_chunk(client_fd, &end, 1) != 0) stream.failed = true;
+    } else {
+        McpReply reply = { .kind = MCP_REPLY_RESULT };
+        reply.result = run_tool_call(params, &stream.ctx);
+        cJSON *resp = reply_to_json(id, &reply);
+        if (resp) stream_event(&stream, resp);
+        cJSON_Delete(resp);
+    }
+    // 分块流已损坏时不能再复用连接，shutdown 后由 reactor 回收
+    if (stream.failed || http_write_chunk_end(client_fd) != 0) shutdown(client_fd, SHUT_RDWR);
+}
+
+static void write_tools_call(int client_fd, bool keep_alive, const cJSON *id, const cJSON *params, const ToolDescriptor *tool) {
+    if (http_write_stream_header(client_fd, "200 OK", "application/json", NULL, keep_alive) != 0) {
+        shutdown(client_fd, SHUT_RDWR);
+        return;
+    }
+    char buf[JSON_STREAM_BUFFER];
+    JsonWriter w;
+    json_writer_init(&w, buf, sizeof(buf), write_chunk_flush, &client_fd);
+    write_tool_response(&w, id, params, tool, NULL);
+    // 分块流已损坏时不能再复用连接，shutdown 后由 reactor 回收
+    if (json_writer_finish(&w) != 0 || http_write_chunk_end(client_fd) != 0) shutdown(client_fd, SHUT_RDWR);
+}
+
+static bool is_valid_call(const cJSON *call) {
+    const cJSON *jsonrpc = cJSON_GetObjectItem(call, "jsonrpc");
+    const cJSON *method = cJSON_GetObjectItem(call, "method");
+    return cJSON_IsObject(call) && cJSON_IsString(jsonrpc) && strcmp(jsonrpc->valuestring, "2.0") == 0 && cJSON_IsString(method);
+}
+
+// 截图等阻塞工具的结果很大，batch 中要保留到整批结束，还会连续占住唯一的截图槽位
+static bool is_blocking_tool_call(const char *method, const cJSON *params) {
+    if (strcmp(method, "tools/call") != 0) return false;
+    const cJSON *name = cJSON_GetObjectItem(params, "name");
+    const ToolDescriptor *tool = cJSON_IsString(name) ? tool_registry_find(name->valuestring) : NULL;
+    return tool && (tool->flags & TOOL_FLAG_BLOCKING);
+}
+
+static bool is_valid_batch(const cJSON *batch) {
+    int n = cJSON_GetArraySize(batch);
+    return n > 0 && n <= MAX_BATCH_ENTRIES;
+}
+
+// 执行单个调用并返回 JSON-RPC 响应对象，通知返回 NULL；batch 中各条目互相隔离，出错只影响自身的响应
+static cJSON *run_call(const cJSON *call, const char *session_id, bool in_batch) {
+    if (!is_valid_call(call)) return rpc_error(NULL, RPC_INVALID_REQUEST, "Invalid Request");
+    const char *name = cJSON_GetObjectItem(call, "method")->valuestring;
+    const cJSON *id = cJSON_GetObjectItem(call, "id");
+    const McpMethod *m = find_method(name);
+    if (!m) {
+        log_error("Unsupported method: %s", name);
+        return id ? rpc_error(id, RPC_METHOD_NOT_FOUND, "Method not found") : NULL;
+    }
+    if (in_batch && (m->flags & MCP_METHOD_NO_BATCH)) return rpc_error(id, RPC_INVALID_REQUEST, "Method not allowed in batch");
+    if (in_batch && is_blocking_tool_call(name, cJSON_GetObjectItem(call, "params"))) {
+        return rpc_error(id, RPC_INVALID_REQUEST, "Tool not allowed in batch");
+    }
+    if ((m->flags & MCP_METHOD_REQUIRES_ID) && !id) return NULL;
+
+    McpReply reply = {0};
+    m->handler(cJSON_GetObjectItem(call, "params"), session_id, &reply);
+    if (!id) {
+        // 通知不产生响应
+        release_reply(&reply);
+        return NULL;
+    }
+    return reply_to_json(id, &reply);
+}
+
+// JSON-RPC batch：按顺序在设备上依次执行，结果按原顺序返回
+static void handle_batch(int client_fd, bool keep_alive, HttpEncoding encoding, const cJSON *batch, const char *session_id) {
+    if (!is_valid_batch(batch)) {
+        cJSON *resp = rpc_error(NULL, RPC_INVALID_REQUEST, "Invalid Request");
+        send_json(client_fd, keep_alive, encoding, NULL, resp);
+        cJSON_Delete(resp);
+        return;
+    }
+    cJSON *responses = cJSON_CreateArray();
+    const cJSON *call = NULL;
+    cJSON_ArrayForEach(call, batch) {
+        cJSON *resp = run_call(call, session_id, true);
+        if (resp) cJSON_AddItemToArray(responses, resp);
+    }
+    if (cJSON_GetArraySize(responses) == 0) {
+        // 全部是通知
+        send_text(client_fd, keep_alive, "202 Accepted", NULL, NULL);
+    } else {
+        send_json(client_fd, keep_alive, encoding, NULL, responses);
+    }
+    cJSON_Delete(responses);
+}
+
+// 非 HTTP 传输（WebSocket）的入口：处理一条 JSON-RPC 消息或 batch，返回序列化后的响应（用 cJSON_free 释放），无需响应时返回 NULL
+char *mcp_handle_message(const char *json, size_t len, const char *session_id, size_t *out_len) {
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    cJSON *resp = NULL;
+    if (!root) {
+        resp = rpc_error(NULL, RPC_PARSE_ERROR, "Parse error");
+    } else if (!cJSON_IsArray(root)) {
+        resp = run_call(root, session_id, false);
+    } else if (!is_valid_batch(root)) {
+        resp = rpc_error(NULL, RPC_INVALID_REQUEST, "Invalid Request");
+    } else {
+        resp = cJSON_CreateArray();
+        const cJSON *call = NULL;
+        cJSON_ArrayForEach(call, root) {
+            cJSON *item = run_call(call, session_id, true);
+            if (item) cJSON_AddItemToArray(resp, item);
+        }
+        if (cJSON_GetArraySize(resp) == 0) {
+            cJSON_Delete(resp);
+            resp = NULL;
+        }
+    }
+    cJSON_Delete(root);
+    if (!resp) return NULL;
+    char *out = cJSON_PrintUnformattedWithLength(resp, out_len);
+    cJSON_Delete(resp);
+    return out;
+}
+
+static bool route_is(const HttpRequest *req, const char *method, const char *path) {
+    return strcmp(req->method, method) == 0 && strcmp(req->path, path) == 0;
+}
+
+// GET /frame.jpg?layer=N：直接写出截图缓冲区，不经过 base64 与 cJSON
+// caps:sc 的截图接口不支持调整 JPEG 质量，quality 参数被忽略
+static void send_frame_jpeg(const HttpRequest *req, int client_fd, bool keep_alive) {
+    ViLayerStack layer_stack = 0;
+    char value[16];
+    if (http_query_param(req->query, "layer", value, sizeof(value))) {
+        char *end = NULL;
+        unsigned long layer = strtoul(value, &end, 10);
+        if (end == value || *end || layer > 10) {
+            send_text(client_fd, keep_alive, "400 Bad Request", "text/plain", "Invalid layer\n");
+            return;
+        }
+        layer_stack = (ViLayerStack)layer;
+    }
+    void *jpeg = NULL;
+    u64 size = 0;
+    int rc = cur_frame_capture_jpeg(layer_stack, true, &jpeg, &size);
+    if (rc != 0) {
+        send_text(client_fd, keep_alive, "503 Service Unavailable", "text/plain", rc == CUR_FRAME_BUSY ? "Capture buffer busy\n" : "Capture failed\n");
+        return;
+    }
+    // 发送耗时取决于客户端，先把截图复制出来归还缓冲区，慢速客户端不会挡住其他截图
+    bool detached = cur_frame_detach_jpeg(&jpeg, size);
+    struct iovec iov = { jpeg, (size_t)size };
+    http_write_response(client_fd, "200 OK", "image/jpeg", "Cache-Control: no-store\r\n", &iov, 1, keep_alive);
+    if (detached) {
+        heap_free(jpeg);
+    } else {
+        cur_frame_release_jpeg();
+    }
+}
+
+// 工具名都很短，放不进 name 的一定查不到
+static const ToolDescriptor *doc_find_tool(const JsonDoc *doc, int params) {
+    char name[64];
+    int token = json_doc_get(doc, params, "name");
+    return json_doc_string(doc, token, name, sizeof(name)) >= 0 ? tool_registry_find(name) : NULL;
+}
+
+static JobClass tool_job_class(const ToolDescriptor *tool) {
+    if (!tool) return JOB_CLASS_READ;
+    if (tool->flags & TOOL_FLAG_BLOCKING) return JOB_CLASS_CAPTURE;
+    if (tool->flags & TOOL_FLAG_INPUT) return JOB_CLASS_INPUT;
+    return JOB_CLASS_READ;
+}
+
+static JobClass classify_doc_call(const JsonDoc *doc, int call) {
+    int method = json_doc_get(doc, call, "method");
+    if (json_doc_string_equals(doc, method, "resources/read")) return JOB_CLASS_CAPTURE;
+    if (!json_doc_string_equals(doc, method, "tools/call")) return JOB_CLASS_READ;
+    return tool_job_class(doc_find_tool(doc, json_doc_get(doc, call, "params")));
+}
+
+JobClass mcp_classify_request(const HttpRequest *req) {
+    if (route_is(req, "GET", "/frame.jpg")) return JOB_CLASS_CAPTURE;
+    if (!route_is(req, "POST", "/mcp") || req->content_length == 0) return JOB_CLASS_READ;
+    // 原地解析，不分配内存；worker 随后还会完整解析一次请求体
+    JsonDoc doc;
+    if (json_doc_parse(&doc, req->body, req->content_length) == JSON_DOC_OK) {
+        if (json_doc_type(&doc, 0) != JSON_DOC_ARRAY) return classify_doc_call(&doc, 0);
+        JobClass cls = JOB_CLASS_INPUT;
+        for (int call = json_doc_first(&doc, 0); call >= 0; call = json_doc_next(&doc, call)) {
+            JobClass c = classify_doc_call(&doc, call);
+            if (c > cls) cls = c;
+        }
+        return cls;
+    }
+    // 超出 token 上限的大批量请求与格式错误的请求体按默认类别入队，由 worker 完整解析；
+    // 这里运行在 reactor 线程上，不能为了分类去做可能很慢的 cJSON 解析
+    return JOB_CLASS_READ;
+}
+
+// GET /metrics：Prometheus 文本格式
+static void send_metrics(int client_fd, bool keep_alive, HttpEncoding encoding) {
+    metrics_gauge_set(METRIC_GAUGE_SSE_CONNECTIONS, sse_active_connections());
+    size_t len = 0;
+    char *text = metrics_render(&len);
+    if (!text) {
+        send_text(client_fd, keep_alive, "500 Internal Server Error", "text/plain", "Out of memory\n");
+        return;
+    }
+    struct iovec iov = { text, len };
+    send_body(client_fd, keep_alive, encoding, "text/plain; version=0.0.4", NULL, &iov, 1);
+    heap_free(text);
+}
+
+// 校验 Mcp-Session-Id 并占用一个处理中请求名额；失败时已写出错误响应
+static bool begin_session_request(int client_fd, bool keep_alive, const char *session_id) {
+    if (!session_id) {
+        send_text(client_fd, keep_alive, "400 Bad Request", "application/json", "{\"error\":\"Missing Mcp-Session-Id\"}\n");
+        return false;
+    }
+    switch (session_begin_request(session_id)) {
+    case SESSION_OK:
+        return true;
+    case SESSION_ERR_BUSY:
+        metrics_count_rejected(METRIC_REJECT_SESSION_BUSY);
+        send_text(client_fd, keep_alive, "429 Too Many Requests", "application/json", "{\"error\":\"Too many pending requests\"}\n");
+        return false;
+    default:
+        // 会话不存在或已过期，客户端应重新 initialize
+        send_text(client_fd, keep_alive, "404 Not Found", "application/json", "{\"error\":\"Unknown session\"}\n");
+        return false;
+    }
+}
+
+// tools/call 的快速路径：工具提供 call_doc 时直接从原地解析的请求体读取参数，不为请求构建 cJSON 树。
+// 返回 false 表示不适用（含各种错误情况），由调用方按常规路径处理
+static bool handle_doc_call(const HttpRequest *req, int client_fd, bool keep_alive, HttpEncoding encoding, const char *session_id) {
+    JsonDoc doc;
+    if (json_doc_parse(&doc, req->body, req->content_length) != JSON_DOC_OK) return false;
+    int id = json_doc_get(&doc, 0, "id");
+    int params = json_doc_get(&doc, 0, "params");
+    int arguments = json_doc_get(&doc, params, "arguments");
+    if (id < 0 || arguments < 0 ||
+        !json_doc_string_equals(&doc, json_doc_get(&doc, 0, "jsonrpc"), "2.0") ||
+        !json_doc_string_equals(&doc, json_doc_get(&doc, 0, "method"), "tools/call")) {
+        return false;
+    }
+    // 阻塞工具可能以 SSE 响应，提供 write 的工具以流式输出，都交给常规路径
+    const ToolDescriptor *tool = doc_find_tool(&doc, params);
+    if (!tool || !tool->call_doc || tool->write || (tool->flags & TOOL_FLAG_BLOCKING)) return false;
+
+    if (!begin_session_request(client_fd, keep_alive, session_id)) return true;
+    metrics_request_label("tools/call", tool->name);
+    // 只有 id 需要原样回显，单独解析它
+    size_t id_len = 0;
+    const char *id_text = json_doc_raw(&doc, id, &id_len);
+    cJSON *id_json = cJSON_ParseWithLength(id_text, id_len);
+    cJSON *content = cJSON_CreateArray();
+    McpReply reply = { .kind = MCP_REPLY_RESULT };
+    reply.result = tool_result(content, tool->call_doc(content, &doc, arguments, NULL));
+    send_reply(client_fd, keep_alive, encoding, id_json, &reply);
+    cJSON_Delete(id_json);
+    session_end_request(session_id);
+    return true;
 }
 
 // 处理 MCP HTTP 请求
-void handle_http_request(char *req, int req_len, int client_fd) {
+void handle_http_request(HttpRequest *req, int client_fd, bool keep_alive) {
+    // 压缩响应以 chunked 写出，HTTP/1.0 客户端不支持
+    HttpEncoding encoding = req->version_minor >= 1 ? http_negotiate_encoding(http_request_header(req, "Accept-Encoding"))
+                                                    : HTTP_ENCODING_IDENTITY;
     
     // 支持 OAuth2 endpoints
-    if (strstr(req, "GET /.well-known/oauth-authorization-server") == req) {
+    if (route_is(req, "GET", "/.well-known/oauth-authorization-server")) {
         const char *resp =
-            "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
             "{"
             "\"issuer\":\"http://192.168.1.15:12345\","  
             "\"authorization_endpoint\":\"http://192.168.1.15:12345/oauth/authorize\","  
             "\"token_endpoint\":\"http://192.168.1.15:12345/oauth/token\","  
             "\"response_types_supported\":[\"code\"]"
             "}";
-        send(client_fd, resp, strlen(resp), 0);
+        send_text(client_fd, keep_alive, "200 OK", "application/json", resp);
         return;
     }
     
-    if (strstr(req, "GET /.well-known/oauth-client-registration") == req) {
-        const char *resp = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n{}";
-        send(client_fd, resp, strlen(resp), 0);
+    if (route_is(req, "GET", "/.well-known/oauth-client-registration")) {
+        send_text(client_fd, keep_alive, "200 OK", "application/json", "{}");
         return;
     }
     
-    if (strstr(req, "GET /oauth/authorize") == req || strstr(req, "POST /oauth/authorize") == req) {
-        const char *resp = "HTTP/1.1 501 Not Implemented\r\nContent-Type: application/json\r\n\r\n{\"error\":\"OAuth2 authorization not supported\"}\n";
-        send(client_fd, resp, strlen(resp), 0);
+    if (route_is(req, "GET", "/oauth/authorize") || route_is(req, "POST", "/oauth/authorize")) {
+        send_text(client_fd, keep_alive, "501 Not Implemented", "application/json", "{\"error\":\"OAuth2 authorization not supported\"}\n");
         return;
     }
     
-    if (strstr(req, "GET /oauth/token") == req || strstr(req, "POST /oauth/token") == req) {
-        const char *resp = "HTTP/1.1 501 Not Implemented\r\nContent-Type: application/json\r\n\r\n{\"error\":\"OAuth2 token not supported\"}\n";
-        send(client_fd, resp, strlen(resp), 0);
+    if (route_is(req, "GET", "/oauth/token") || route_is(req, "POST", "/oauth/token")) {
+        send_text(client_fd, keep_alive, "501 Not Implemented", "application/json", "{\"error\":\"OAuth2 token not supported\"}\n");
         return;
     }
     
-    if (strncmp(req, "POST /mcp", 9) != 0) {
-        const char *resp = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n\r\nNot Found\n";
-        send(client_fd, resp, strlen(resp), 0);
+    if (route_is(req, "GET", "/frame.jpg")) {
+        send_frame_jpeg(req, client_fd, keep_alive);
         return;
     }
     
-    // 处理 MCP 请求，忽略 headers
-    (void)get_header(req, "MCP-Protocol-Version");
-    (void)get_header(req, "Mcp-Session-Id");
-    
-    // 解析 body
-    const char *body = strstr(req, "\r\n\r\n");
-    if (!body) {
-        const char *resp = "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n\r\n{\"error\":\"Missing body\"}\n";
-        send(client_fd, resp, strlen(resp), 0);
+    if (route_is(req, "GET", "/metrics")) {
+        send_metrics(client_fd, keep_alive, encoding);
         return;
     }
-    body += 4;
     
-    cJSON *root = cJSON_Parse(body);
-    if (!root) {
-        const char *resp = "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n\r\n{\"error\":\"Invalid JSON\"}\n";
-        send(client_fd, resp, strlen(resp), 0);
+    const char *session_id = http_request_header(req, "Mcp-Session-Id");
+    
+    // 有效会话的 GET /mcp 已由 worker 交给 sse 模块，到这里说明会话无效
+    if (route_is(req, "GET", "/mcp")) {
+        if (session_id) {
+            send_text(client_fd, keep_alive, "404 Not Found", "application/json", "{\"error\":\"Unknown session\"}\n");
+        } else {
+            send_text(client_fd, keep_alive, "400 Bad Request", "application/json", "{\"error\":\"Missing Mcp-Session-Id\"}\n");
+        }
         return;
     }
     
-    // 处理 JSON-RPC
-    const cJSON *jsonrpc = cJSON_GetObjectItem(root, "jsonrpc");
-    const cJSON *method = cJSON_GetObjectItem(root, "method");
-    const cJSON *id = cJSON_GetObjectItem(root, "id");
+    if (route_is(req, "DELETE", "/mcp")) {
+        if (session_id && session_remove(session_id) == SESSION_OK) {
+            send_text(client_fd, keep_alive, "200 OK", NULL, NULL);
+        } else {
+            send_text(client_fd, keep_alive, "404 Not Found", "application/json", "{\"error\":\"Unknown session\"}\n");
+        }
+        return;
+    }
     
-    if (!jsonrpc || !cJSON_IsString(jsonrpc) || strcmp(jsonrpc->valuestring, "2.0") != 0 || 
-        !method || !cJSON_IsString(method)) {
-        cJSON_Delete(root);
-        const char *resp = "HTTP/1.1 202 Accepted\r\nContent-Length: 0\r\n\r\n";
-        send(client_fd, resp, strlen(resp), 0);
+    if (!route_is(req, "POST", "/mcp")) {
+        send_text(client_fd, keep_alive, "404 Not Found", "text/plain", "Not Found\n");
         return;
     }
     
-    // 处理 initialize
-    if (strcmp(method->valuestring, "initialize") == 0) {
-        gen_session_id(session_id, sizeof(session_id));
-        
-        cJSON *result = cJSON_CreateObject();
-        cJSON_AddStringToObject(result, "protocolVersion", protocol_version);
-        
-        // 能力协商对象
-        cJSON *caps = cJSON_CreateObject();
-        
-        // logging 能力
-        // cJSON *logging = cJSON_CreateObject();
-        // cJSON_AddItemToObject(caps, "logging", logging);
-        
-        // prompts 能力
-        // cJSON *prompts = cJSON_CreateObject();
-        // cJSON_AddBoolToObject(prompts, "listChanged", 1);
-        // cJSON_AddItemToObject(caps, "prompts", prompts);
-        
-        // resources 能力
-        cJSON *resources = cJSON_CreateObject();
-        cJSON_AddBoolToObject(resources, "subscribe", 1);
-        cJSON_AddBoolToObject(resources, "listChanged", 1);
-        cJSON_AddItemToObject(caps, "resources", resources);
-        
-        // tools 能力
-        cJSON *tools = cJSON_CreateObject();
-        cJSON_AddBoolToObject(tools, "listChanged", 1);
-        cJSON_AddItemToObject(caps, "tools", tools);
-        
-        // experimental 能力
-        // cJSON *experimental = cJSON_CreateObject();
-        // cJSON_AddItemToObject(caps, "experimental", experimental);
-        
-        cJSON_AddItemToObject(result, "capabilities", caps);
-        
-        // 服务端信息
-        cJSON *info = cJSON_CreateObject();
-        cJSON_AddStringToObject(info, "name", "SwitchMCPServer");
-        cJSON_AddStringToObject(info, "title", "Nintendo Switch MCP Server");
-        cJSON_AddStringToObject(info, "version", "1.0.0");
-        cJSON_AddItemToObject(result, "serverInfo", info);
-        
-        cJSON_AddStringToObject(result, "instructions", "Welcome to Switch MCP Server.");
-        
-        cJSON *resp = cJSON_CreateObject();
-        cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
-        cJSON_AddItemToObject(resp, "id", cJSON_Duplicate(id, 1));
-        cJSON_AddItemToObject(resp, "result", result);
-        
-        char *resp_str = cJSON_PrintUnformatted(resp);
-        char header[256];
-        snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nMcp-Session-Id: %s\r\nMCP-Protocol-Version: %s\r\n\r\n", session_id, protocol_version);
-        send(client_fd, header, strlen(header), 0);
-        send(client_fd, resp_str, strlen(resp_str), 0);
-        free(resp_str);
-        cJSON_Delete(resp);
-        cJSON_Delete(root);
+    // 处理 MCP 请求，忽略 MCP-Protocol-Version
+    (void)http_request_header(req, "MCP-Protocol-Version");
+    
+    // 解析 body
+    if (req->content_length == 0) {
+        send_text(client_fd, keep_alive, "400 Bad Request", "application/json", "{\"error\":\"Missing body\"}\n");
         return;
     }
     
-    // 处理 resources/list 方法
-    if (strcmp(method->valuestring, "resources/list") == 0 && id) {
-        cJSON *resp = cJSON_CreateObject();
-        cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
-        cJSON_AddItemToObject(resp, "id", cJSON_Duplicate(id, 1));
-
-        cJSON *result = cJSON_CreateObject();
-        cJSON *resources = cJSON_CreateArray();
-
-        // 当前帧资源
-        // list_cur_frame(resources);
-
-        cJSON_AddItemToObject(result, "resources", resources);
-        // cJSON_AddStringToObject(result, "nextCursor", "");
+    if (handle_doc_call(req, client_fd, keep_alive, encoding, session_id)) return;
     
-        cJSON_AddItemToObject(resp, "result", result);
-        
-        char *resp_str = cJSON_PrintUnformatted(resp);
-        const char *header = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n";
-        send(client_fd, header, strlen(header), 0);
-        send(client_fd, resp_str, strlen(resp_str), 0);
-        free(resp_str);
-        cJSON_Delete(resp);
-        cJSON_Delete(root);
+    cJSON *root = cJSON_ParseWithLength(req->body, req->content_length);
+    if (!root) {
+        send_text(client_fd, keep_alive, "400 Bad Request", "application/json", "{\"error\":\"Invalid JSON\"}\n");
         return;
     }
-
-    // 处理 resources/read 方法
-    if (strcmp(method->valuestring, "resources/read") == 0 && id) {
-        cJSON *resp = cJSON_CreateObject();
-        cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
-        cJSON_AddItemToObject(resp, "id", cJSON_Duplicate(id, 1));
-
-        cJSON *result = cJSON_CreateObject();
-        cJSON *resources = cJSON_CreateArray();
-
-        // 当前帧资源
-        // read_cur_frame(resources);
-
-        cJSON_AddItemToObject(result, "resources", resources);
-        // cJSON_AddStringToObject(result, "nextCursor", "");
-
-        cJSON_AddItemToObject(resp, "result", result);
-
-        char *resp_str = cJSON_PrintUnformatted(resp);
-        const char *header = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n";
-        send(client_fd, header, strlen(header), 0);
-        send(client_fd, resp_str, strlen(resp_str), 0);
-        free(resp_str);
-        cJSON_Delete(resp);
+    
+    if (cJSON_IsArray(root)) {
+        metrics_request_label("batch", NULL);
+        if (begin_session_request(client_fd, keep_alive, session_id)) {
+            handle_batch(client_fd, keep_alive, encoding, root, session_id);
+            session_end_request(session_id);
+        }
         cJSON_Delete(root);
         return;
     }
-
-    // 处理 tools/list 方法
-    if (strcmp(method->valuestring, "tools/list") == 0 && id) {
-        cJSON *resp = cJSON_CreateObject();
-        cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
-        cJSON_AddItemToObject(resp, "id", cJSON_Duplicate(id, 1));
-        
-        cJSON *result = cJSON_CreateObject();
-        cJSON *tools = cJSON_CreateArray();
-        
-    // controller 工具
-    list_controller(tools);
-    // cur_frame 工具
-    list_cur_frame(tools);
-    // controller_recorder 工具
-    list_controller_recorder(tools);
-        
-        cJSON_AddItemToObject(result, "tools", tools);
-        // cJSON_AddStringToObject(result, "nextCursor", "");
-        cJSON_AddItemToObject(resp, "result", result);
-        
-        char *resp_str = cJSON_PrintUnformatted(resp);
-        const char *header = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n";
-        send(client_fd, header, strlen(header), 0);
-        send(client_fd, resp_str, strlen(resp_str), 0);
-        free(resp_str);
-        cJSON_Delete(resp);
+    
+    // 处理 JSON-RPC
+    const cJSON *jsonrpc = cJSON_GetObjectItem(root, "jsonrpc");
+    const cJSON *method = cJSON_GetObjectItem(root, "method");
+    const cJSON *id = cJSON_GetObjectItem(root, "id");
+    
+    if (!jsonrpc || !cJSON_IsString(jsonrpc) || strcmp(jsonrpc->valuestring, "2.0") != 0 || 
+        !method || !cJSON_IsString(method)) {
         cJSON_Delete(root);
+        send_text(client_fd, keep_alive, "202 Accepted", NULL, NULL);
         return;
     }
     
-    // 处理 tools/call 方法
-    if (strcmp(method->valuestring, "tools/call") == 0 && id) {
-        cJSON *params = cJSON_GetObjectItem(root, "params");
-        const cJSON *tool_name = params ? cJSON_GetObjectItem(params, "name") : NULL;
-        const cJSON *arguments = params ? cJSON_GetObjectItem(params, "arguments") : NULL;
-        
-        cJSON *resp = cJSON_CreateObject();
-        cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
-        cJSON_AddItemToObject(resp, "id", cJSON_Duplicate(id, 1));
-        
-        cJSON *result = cJSON_CreateObject();
-        cJSON *content = cJSON_CreateArray();
-        int isError = 0;
-        
-        if (tool_name && cJSON_IsString(tool_name) && strcmp(tool_name->valuestring, "controller") == 0 && arguments) {
-            isError = call_controller(content, arguments);
-        } else if (tool_name && cJSON_IsString(tool_name) && strcmp(tool_name->valuestring, "cur_frame") == 0) {
-            isError = call_cur_frame(content);
-        } else if (tool_name && cJSON_IsString(tool_name) && strcmp(tool_name->valuestring, "controller_recorder") == 0 && arguments) {
-            isError = call_controller_recorder(content, arguments);
-        } else {
-            isError = 1;
-            cJSON *item = cJSON_CreateObject();
-            cJSON_AddStringToObject(item, "type", "text");
-            cJSON_AddStringToObject(item, "text", "Unknown tool or missing arguments");
-            cJSON_AddItemToArray(content, item);
-        }
-        
-        cJSON_AddItemToObject(result, "content", content);
-        cJSON_AddBoolToObject(result, "isError", isError);
-        cJSON_AddItemToObject(resp, "result", result);
-        
-        char *resp_str = cJSON_PrintUnformatted(resp);
-        const char *header = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n";
-        send(client_fd, header, strlen(header), 0);
-        send(client_fd, resp_str, strlen(resp_str), 0);
-        free(resp_str);
-        cJSON_Delete(resp);
+    // initialize 之外的请求都必须属于一个有效会话
+    bool in_session = strcmp(method->valuestring, "initialize") != 0;
+    if (in_session && !begin_session_request(client_fd, keep_alive, session_id)) {
         cJSON_Delete(root);
         return;
     }
     
-    // 处理其他通知和方法
-    if (strcmp(method->valuestring, "notifications/initialized") == 0) {
+    const cJSON *params = cJSON_GetObjectItem(root, "params");
+    const McpMethod *m = find_method(method->valuestring);
+    metrics_request_label(m ? m->name : "unknown", metrics_tool_label(method->valuestring, params));
+    const ToolDescriptor *stream_tool = id ? json_stream_tool(req, method->valuestring, params) : NULL;
+    // 没有 progressToken 时 SSE 没有额外收益，能流式写出的工具直接以 JSON 响应
+    if (id && wants_event_stream(req, method->valuestring, params) && (!stream_tool || progress_token(params))) {
+        stream_tools_call(client_fd, keep_alive, id, params, stream_tool);
+        if (in_session) session_end_request(session_id);
         cJSON_Delete(root);
-        const char *resp = "HTTP/1.1 202 Accepted\r\nContent-Type: application/json\r\n\r\n";
-        send(client_fd, resp, strlen(resp), 0);
         return;
     }
-    
-    if (strcmp(method->valuestring, "ping") == 0 && id) {
-        cJSON *resp = cJSON_CreateObject();
-        cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
-        cJSON_AddItemToObject(resp, "id", cJSON_Duplicate(id, 1));
-        cJSON *result = cJSON_CreateObject();
-        cJSON_AddItemToObject(resp, "result", result);
-        
-        char *resp_str = cJSON_PrintUnformatted(resp);
-        const char *header = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n";
-        send(client_fd, header, strlen(header), 0);
-        send(client_fd, resp_str, strlen(resp_str), 0);
-        free(resp_str);
-        cJSON_Delete(resp);
+    if (stream_tool) {
+        write_tools_call(client_fd, keep_alive, id, params, stream_tool);
+        if (in_session) session_end_request(session_id);
         cJSON_Delete(root);
         return;
     }
     
-    // 其它方法暂不支持
+    McpReply reply = {0};
+    if (m && (id || !(m->flags & MCP_METHOD_REQUIRES_ID))) {
+        m->handler(params, in_session ? session_id : NULL, &reply);
+    } else {
+        // 其它方法暂不支持
+        log_error("Unsupported method: %s", method->valuestring);
+        reply.kind = MCP_REPLY_UNSUPPORTED;
+    }
+    if (!id) {
+        // 与 batch 中的 run_call 一致：通知不产生响应体，未知方法也只回 202
+        release_reply(&reply);
+        reply.kind = MCP_REPLY_NONE;
+    }
+    send_reply(client_fd, keep_alive, encoding, id, &reply);
+    if (in_session) session_end_request(session_id);
     cJSON_Delete(root);
-    const char *resp = "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n\r\n{\"error\":\"Unsupported method\"}\n";
-    log_error("Unsupported method: %s", method->valuestring);
-    send(client_fd, resp, strlen(resp), 0);
 }
-
@@ -0,0 +1,244 @@
+#include "http_parser.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+static void reset_parse(HttpRequest *req) {
+    req->state = HTTP_PARSE_REQUEST_LINE;
+    req->pos = 0;
+    req->error_status = 0;
+    req->saved_tail = '\0';
+    req->method_offset = 0;
+    req->path_offset = 0;
+    req->query_offset = 0;
+    req->method = NULL;
+    req->path = NULL;
+    req->query = NULL;
+    req->version_minor = 0;
+    req->header_count = 0;
+    req->content_length = 0;
+    req->body_offset = 0;
+    req->body = NULL;
+    req->request_len = 0;
+}
+
+static HttpParseState fail(HttpRequest *req, int status) {
+    req->state = HTTP_PARSE_ERROR;
+    req->error_status = status;
+    return req->state;
+}
+
+void http_request_init(HttpRequest *req, SlabPool *small_pool, SlabPool *large_pool) {
+    memset(req, 0, sizeof(*req));
+    req->small_pool = small_pool;
+    req->large_pool = large_pool;
+    reset_parse(req);
+}
+
+static void release_buf(HttpRequest *req) {
+    if (req->buf) slab_free(slab_owns(req->large_pool, req->buf) ? req->large_pool : req->small_pool, req->buf);
+    req->buf = NULL;
+    req->cap = 0;
+}
+
+void http_request_free(HttpRequest *req) {
+    release_buf(req);
+    http_request_init(req, req->small_pool, req->large_pool);
+}
+
+char *http_request_reserve(HttpRequest *req, size_t *avail) {
+    // 始终为结尾 NUL 预留 1 字节
+    if (req->len + 1 >= req->cap) {
+        if (req->cap >= req->large_pool->block_size) {
+            // 缓冲区已到上限仍未收全：header 过大回 431，body 过大回 413
+            fail(req, req->state == HTTP_PARSE_BODY ? 413 : 431);
+            return NULL;
+        }
+        SlabPool *pool = req->buf ? req->large_pool : req->small_pool;
+        char *n = (char *)slab_alloc(pool);
+        if (!n) {
+            // 大块同时被其他连接占满：立即 503，客户端按 Retry-After 重试
+            fail(req, 503);
+            return NULL;
+        }
+        if (req->buf) {
+            memcpy(n, req->buf, req->len);
+            release_buf(req);
+        }
+        req->buf = n;
+        req->cap = pool->block_size;
+    }
+    *avail = req->cap - 1 - req->len;
+    return req->buf + req->len;
+}
+
+void http_request_commit(HttpRequest *req, size_t n) {
+    req->len += n;
+    req->buf[req->len] = '\0';
+}
+
+static HttpParseState parse_request_line(HttpRequest *req, char *line, size_t line_off) {
+    char *sp1 = strchr(line, ' ');
+    char *sp2 = sp1 ? strchr(sp1 + 1, ' ') : NULL;
+    if (!sp1 || !sp2 || sp1 == line || sp2 == sp1 + 1) return fail(req, 400);
+    if (strncmp(sp2 + 1, "HTTP/1.", 7) != 0 || !isdigit((unsigned char)sp2[8])) return fail(req, 400);
+    *sp1 = '\0';
+    *sp2 = '\0';
+    req->version_minor = sp2[8] - '0';
+    req->method_offset = line_off;
+    req->path_offset = (size_t)(sp1 + 1 - req->buf);
+    char *q = strchr(sp1 + 1, '?');
+    if (q) {
+        *q = '\0';
+        req->query_offset = (size_t)(q + 1 - req->buf);
+    }
+    req->state = HTTP_PARSE_HEADERS;
+    return req->state;
+}
+
+static HttpParseState parse_header_line(HttpRequest *req, char *line, size_t line_len) {
+    char *colon = memchr(line, ':', line_len);
+    if (!colon || colon == line) return fail(req, 400);
+    if (req->header_count >= HTTP_MAX_HEADERS) return fail(req, 431);
+    *colon = '\0';
+    char *value = colon + 1;
+    char *end = line + line_len;
+    while (value < end && (*value == ' ' || *value == '\t')) ++value;
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+
+    HttpHeader *h = &req->headers[req->header_count++];
+    h->name = (size_t)(line - req->buf);
+    h->value = (size_t)(value - req->buf);
+
+    if (strcasecmp(line, "Content-Length") == 0) {
+        char *num_end = NULL;
+        unsigned long cl = strtoul(value, &num_end, 10);
+        if (num_end == value || *num_end != '\0') return fail(req, 400);
+        // 重复且取值不同的 Content-Length 会让前后两端对请求边界理解不一致（RFC 9112 §6.3），相同的重复值照常接受
+        for (int i = 0; i < req->header_count - 1; ++i) {
+            if (strcasecmp(req->buf + req->headers[i].name, "Content-Length") == 0 && req->content_length != cl) return fail(req, 400);
+        }
+        req->content_length = cl;
+    } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+        return fail(req, 501); // 不支持 chunked 请求体
+    }
+    return req->state;
+}
+
+static void finish(HttpRequest *req) {
+    req->method = req->buf + req->method_offset;
+    req->path = req->buf + req->path_offset;
+    req->query = req->query_offset ? req->buf + req->query_offset : NULL;
+    req->body = req->buf + req->body_offset;
+    req->request_len = req->body_offset + req->content_length;
+    // body 原地 NUL 结尾，被覆盖的字节在 consume 时还原
+    req->saved_tail = req->buf[req->request_len];
+    req->buf[req->request_len] = '\0';
+    req->state = HTTP_PARSE_DONE;
+}
+
+HttpParseState http_request_parse(HttpRequest *req) {
+    while (req->state < HTTP_PARSE_DONE) {
+        if (req->state == HTTP_PARSE_BODY) {
+            if (req->len - req->body_offset >= req->content_length) finish(req);
+            break;
+        }
+        if (req->pos >= req->len) break; // 没有新字节，新连接上 buf 可能还未分配
+        char *nl = memchr(req->buf + req->pos, '\n', req->len - req->pos);
+        if (!nl) break;
+        char *line = req->buf + req->pos;
+        size_t line_off = req->pos;
+        size_t line_len = (size_t)(nl - line);
+        if (line_len > 0 && line[line_len - 1] == '\r') --line_len;
+        line[line_len] = '\0';
+        req->pos = (size_t)(nl - req->buf) + 1;
+
+        if (req->state == HTTP_PARSE_REQUEST_LINE) {
+            if (line_len == 0) continue; // 容忍请求之间多余的空行
+            parse_request_line(req, line, line_off);
+        } else if (line_len == 0) {
+            // header 结束，body 长度由 Content-Length 决定
+            req->body_offset = req->pos;
+            if (req->content_length >= req->large_pool->block_size - req->body_offset) return fail(req, 413);
+            req->state = HTTP_PARSE_BODY;
+        } else {
+            parse_header_line(req, line, line_len);
+        }
+    }
+    return req->state;
+}
+
+void http_request_consume(HttpRequest *req) {
+    size_t rest = 0;
+    if (req->state == HTTP_PARSE_DONE) {
+        req->buf[req->request_len] = req->saved_tail;
+        rest = req->len - req->request_len;
+        memmove(req->buf, req->buf + req->request_len, rest);
+    }
+    req->len = rest;
+    if (req->buf) req->buf[req->len] = '\0';
+    reset_parse(req);
+    // 大请求处理完后换回小块，把大块还给其他连接
+    if (req->cap > req->small_pool->block_size && req->len < req->small_pool->block_size) {
+        char *n = (char *)slab_alloc(req->small_pool);
+        if (n) {
+            memcpy(n, req->buf, req->len + 1);
+            release_buf(req);
+            req->buf = n;
+            req->cap = req->small_pool->block_size;
+        }
+    }
+}
+
+const char *http_request_header(const HttpRequest *req, const char *name) {
+    for (int i = 0; i < req->header_count; ++i) {
+        if (strcasecmp(req->buf + req->headers[i].name, name) == 0) {
+            return req->buf + req->headers[i].value;
+        }
+    }
+    return NULL;
+}
+
+bool http_header_has_token(const char *value, const char *token) {
+    if (!value) return false;
+    size_t token_len = strlen(token);
+    const char *p = value;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') ++p;
+        const char *start = p;
+        while (*p && *p != ',' && *p != ';') ++p;
+        const char *end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) --end;
+        if ((size_t)(end - start) == token_len && strncasecmp(start, token, token_len) == 0) return true;
+        while (*p && *p != ',') ++p;
+    }
+    return false;
+}
+
+bool http_query_param(const char *query, const char *name, char *out, size_t out_size) {
+    if (!query) return false;
+    size_t name_len = strlen(name);
+    const char *p = query;
+    while (*p) {
+        const char *end = strchr(p, '&');
+        if (!end) end = p + strlen(p);
+        if (strncmp(p, name, name_len) == 0 && (p[name_len] == '=' || p + name_len == end)) {
+            const char *value = p[name_len] == '=' ? p + name_len + 1 : end;
+            size_t len = (size_t)(end - value);
+            if (len >= out_size) return false;
+            memcpy(out, value, len);
+            out[len] = '\0';
+            return true;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return false;
+}
+
+bool http_request_keep_alive(const HttpRequest *req) {
+    const char *conn = http_request_header(req, "Connection");
+    if (http_header_has_token(conn, "close")) return false;
+    if (http_header_has_token(conn, "keep-alive")) return true;
+    return req->version_minor >= 1;
+}
@@ -0,0 +1,69 @@
+// 增量 HTTP/1.x 请求解析器
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include "../util/pool.h"
+
+#define HTTP_MAX_HEADERS 32
+
+typedef enum {
+    HTTP_PARSE_REQUEST_LINE = 0,
+    HTTP_PARSE_HEADERS,
+    HTTP_PARSE_BODY,
+    HTTP_PARSE_DONE,
+    HTTP_PARSE_ERROR,
+} HttpParseState;
+
+typedef struct {
+    size_t name;  // 相对 buf 的偏移，均已原地 NUL 结尾
+    size_t value;
+} HttpHeader;
+
+typedef struct {
+    // 每连接复用的接收缓冲区：先用小块，放不下时换成大块（大小即请求上限），处理完再换回
+    char *buf;
+    size_t cap;
+    size_t len;
+    SlabPool *small_pool;
+    SlabPool *large_pool;
+
+    // 状态机
+    HttpParseState state;
+    size_t pos;         // 下一个待解析字节
+    int error_status;   // HTTP_PARSE_ERROR 时建议回复的状态码
+    char saved_tail;    // body 末尾被 NUL 覆盖前的字节（属于下一个流水线请求）
+    size_t method_offset;
+    size_t path_offset;
+    size_t query_offset; // 0 表示无 query
+
+    // 解析结果，仅在 HTTP_PARSE_DONE 时有效，指针均指向 buf 内部
+    char *method;
+    char *path;
+    char *query;        // '?' 之后的部分，没有则为 NULL
+    int version_minor;  // HTTP/1.x 中的 x
+    HttpHeader headers[HTTP_MAX_HEADERS];
+    int header_count;
+    size_t content_length;
+    size_t body_offset;
+    char *body;         // NUL 结尾，无 body 时指向空串
+    size_t request_len; // 整个请求（含 body）的字节数
+} HttpRequest;
+
+// 缓冲区从两个池中借用，large_pool 的块大小即单个请求的上限
+void http_request_init(HttpRequest *req, SlabPool *small_pool, SlabPool *large_pool);
+void http_request_free(HttpRequest *req);
+// 为 recv 预留空间，返回写入位置与可写字节数；已达上限或池已用尽时返回 NULL
+char *http_request_reserve(HttpRequest *req, size_t *avail);
+void http_request_commit(HttpRequest *req, size_t n);
+// 推进状态机，只解析新到达的字节
+HttpParseState http_request_parse(HttpRequest *req);
+// 当前请求处理完毕：保留流水线中剩余的字节，重置解析状态
+void http_request_consume(HttpRequest *req);
+
+// header 名大小写不敏感，不存在返回 NULL
+const char *http_request_header(const HttpRequest *req, const char *name);
+bool http_request_keep_alive(const HttpRequest *req);
+// 逗号分隔的 header 值中是否包含 token（大小写不敏感，忽略 ;q= 等参数）
+bool http_header_has_token(const char *value, const char *token);
+// 取 query 中 name 的原始值（不做百分号解码），不存在或超出 out_size 返回 false
+bool http_query_param(const char *query, const char *name, char *out, size_t out_size);
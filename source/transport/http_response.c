@@ -0,0 +1,214 @@
+#include "http_response.h"
+#include <poll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <zlib.h>
+#include "../util/heap.h"
+#include "../util/log.h"
+#include "../util/metrics.h"
+
+int http_send_iov(int fd, struct iovec *iov, int iovcnt) {
+    u64 start = svcGetSystemTick();
+    int rc = 0;
+    while (iovcnt > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        ssize_t n = sendmsg(fd, &msg, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 非阻塞套接字发送缓冲区满，等待可写
+                struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+                if (poll(&pfd, 1, HTTP_SEND_TIMEOUT_MS) <= 0) {
+                    log_error("send timeout fd=%d", fd);
+                    rc = -1;
+                    break;
+                }
+                continue;
+            }
+            log_error("sendmsg failed fd=%d errno=%d", fd, errno);
+            rc = -1;
+            break;
+        }
+        // 短写：跳过已完整发送的段，再调整当前段的起点
+        size_t sent = (size_t)n;
+        while (iovcnt > 0 && sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    metrics_add_send_ticks(svcGetSystemTick() - start);
+    return rc;
+}
+
+int http_write_response(int fd, const char *status, const char *content_type, const char *extra_headers,
+                        const struct iovec *body, int body_cnt, bool keep_alive) {
+    if (body_cnt < 0 || body_cnt > HTTP_MAX_BODY_IOV) return -1;
+    size_t body_len = 0;
+    for (int i = 0; i < body_cnt; ++i) body_len += body[i].iov_len;
+
+    char header[512];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\n"
+                     "%s%s%s"
+                     "%s"
+                     "Content-Length: %zu\r\n"
+                     "Connection: %s\r\n"
+                     "\r\n",
+                     status,
+                     content_type ? "Content-Type: " : "", content_type ? content_type : "", content_type ? "\r\n" : "",
+                     extra_headers ? extra_headers : "",
+                     body_len,
+                     keep_alive ? "keep-alive" : "close");
+    if (n < 0 || n >= (int)sizeof(header)) {
+        log_error("Response header overflow for status %s", status);
+        return -1;
+    }
+
+    struct iovec iov[1 + HTTP_MAX_BODY_IOV];
+    iov[0].iov_base = header;
+    iov[0].iov_len = (size_t)n;
+    memcpy(&iov[1], body, sizeof(struct iovec) * body_cnt);
+    return http_send_iov(fd, iov, 1 + body_cnt);
+}
+
+int http_write_stream_header(int fd, const char *status, const char *content_type, const char *extra_headers, bool keep_alive) {
+    char header[512];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "%s"
+                     "Transfer-Encoding: chunked\r\n"
+                     "Connection: %s\r\n"
+                     "\r\n",
+                     status, content_type,
+                     extra_headers ? extra_headers : "",
+                     keep_alive ? "keep-alive" : "close");
+    if (n < 0 || n >= (int)sizeof(header)) {
+        log_error("Stream header overflow for status %s", status);
+        return -1;
+    }
+    struct iovec iov = { header, (size_t)n };
+    return http_send_iov(fd, &iov, 1);
+}
+
+int http_write_chunk(int fd, const struct iovec *parts, int part_cnt) {
+    if (part_cnt <= 0 || part_cnt > HTTP_MAX_BODY_IOV) return -1;
+    size_t len = 0;
+    for (int i = 0; i < part_cnt; ++i) len += parts[i].iov_len;
+    if (len == 0) return 0; // 空 chunk 会被当作结束块
+
+    char size_line[24];
+    int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    struct iovec iov[2 + HTTP_MAX_BODY_IOV];
+    iov[0].iov_base = size_line;
+    iov[0].iov_len = (size_t)n;
+    memcpy(&iov[1], parts, sizeof(struct iovec) * part_cnt);
+    iov[1 + part_cnt].iov_base = (void *)"\r\n";
+    iov[1 + part_cnt].iov_len = 2;
+    return http_send_iov(fd, iov, 2 + part_cnt);
+}
+
+int http_write_chunk_end(int fd) {
+    struct iovec iov = { (void *)"0\r\n\r\n", 5 };
+    return http_send_iov(fd, &iov, 1);
+}
+
+HttpEncoding http_negotiate_encoding(const char *accept_encoding) {
+    if (!accept_encoding) return HTTP_ENCODING_IDENTITY;
+    bool accept_gzip = false, accept_deflate = false;
+    const char *p = accept_encoding;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') ++p;
+        const char *name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') ++p;
+        size_t name_len = (size_t)(p - name);
+        // 参数中只关心 q 值
+        bool allowed = true;
+        while (*p && *p != ',') {
+            if (*p++ != ';') continue;
+            while (*p == ' ' || *p == '\t') ++p;
+            if ((*p == 'q' || *p == 'Q') && p[1] == '=') allowed = strtod(p + 2, NULL) > 0;
+        }
+        if (name_len == 4 && strncasecmp(name, "gzip", 4) == 0) accept_gzip = allowed;
+        else if (name_len == 7 && strncasecmp(name, "deflate", 7) == 0) accept_deflate = allowed;
+    }
+    if (accept_gzip) return HTTP_ENCODING_GZIP;
+    if (accept_deflate) return HTTP_ENCODING_DEFLATE;
+    return HTTP_ENCODING_IDENTITY;
+}
+
+// deflate 的窗口、哈希表与 pending 缓冲同样记在 http tag 下
+static voidpf zlib_alloc(voidpf opaque, uInt items, uInt size) {
+    if (size && items > SIZE_MAX / size) return Z_NULL;
+    return heap_alloc(HEAP_TAG_HTTP, (size_t)items * size);
+}
+
+static void zlib_free(voidpf opaque, voidpf ptr) {
+    heap_free(ptr);
+}
+
+int http_write_response_encoded(int fd, const char *status, const char *content_type, const char *extra_headers,
+                                const struct iovec *body, int body_cnt, bool keep_alive, HttpEncoding encoding) {
+    size_t body_len = 0;
+    for (int i = 0; i < body_cnt; ++i) body_len += body[i].iov_len;
+    if (encoding == HTTP_ENCODING_IDENTITY || body_len < HTTP_COMPRESS_MIN_SIZE || body_cnt > HTTP_MAX_BODY_IOV) {
+        return http_write_response(fd, status, content_type, extra_headers, body, body_cnt, keep_alive);
+    }
+
+    char headers[384];
+    int n = snprintf(headers, sizeof(headers), "%sContent-Encoding: %s\r\nVary: Accept-Encoding\r\n",
+                     extra_headers ? extra_headers : "", encoding == HTTP_ENCODING_GZIP ? "gzip" : "deflate");
+    if (n < 0 || n >= (int)sizeof(headers)) {
+        log_error("Response header overflow for status %s", status);
+        return -1;
+    }
+
+    // windowBits + 16 输出 gzip 头尾，否则为 zlib 格式
+    int window_bits = HTTP_COMPRESS_WINDOW_BITS + (encoding == HTTP_ENCODING_GZIP ? 16 : 0);
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = zlib_alloc;
+    zs.zfree = zlib_free;
+    zs.opaque = Z_NULL;
+    unsigned char *out = heap_alloc(HEAP_TAG_HTTP, HTTP_COMPRESS_CHUNK);
+    if (!out || deflateInit2(&zs, HTTP_COMPRESS_LEVEL, Z_DEFLATED, window_bits, HTTP_COMPRESS_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        log_warning("Compressor unavailable, sending %zu bytes uncompressed", body_len);
+        heap_free(out);
+        return http_write_response(fd, status, content_type, extra_headers, body, body_cnt, keep_alive);
+    }
+
+    int rc = http_write_stream_header(fd, status, content_type, headers, keep_alive);
+    // 逐段压缩，最后一轮以 Z_FINISH 刷出剩余数据与校验尾
+    for (int i = 0; rc == 0 && i <= body_cnt; ++i) {
+        bool last = i == body_cnt;
+        zs.next_in = last ? Z_NULL : (Bytef *)body[i].iov_base;
+        zs.avail_in = last ? 0 : (uInt)body[i].iov_len;
+        do {
+            zs.next_out = out;
+            zs.avail_out = HTTP_COMPRESS_CHUNK;
+            if (deflate(&zs, last ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                log_error("deflate failed fd=%d", fd);
+                rc = -1;
+                break;
+            }
+            struct iovec part = { out, HTTP_COMPRESS_CHUNK - zs.avail_out };
+            if (part.iov_len > 0) rc = http_write_chunk(fd, &part, 1);
+        } while (rc == 0 && zs.avail_out == 0);
+    }
+    if (rc == 0) rc = http_write_chunk_end(fd);
+    deflateEnd(&zs);
+    heap_free(out);
+    return rc;
+}
@@ -0,0 +1,43 @@
+// HTTP 响应写出：status line + headers + body 合并为一次 sendmsg
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define HTTP_MAX_BODY_IOV 8 // 单个响应 body 最多由多少段拼接
+#ifndef HTTP_SEND_TIMEOUT_MS
+#define HTTP_SEND_TIMEOUT_MS 5000 // 非阻塞 fd 上连续这么久不可写即放弃发送
+#endif
+
+// 响应压缩：recorder dump、tools/list 等较大的 JSON 在拥挤的 2.4GHz 链路上收益明显
+#define HTTP_COMPRESS_MIN_SIZE 1024    // 小于该大小的 body 原样发送，压缩收益抵不过 CPU 与额外的 header
+#define HTTP_COMPRESS_LEVEL 6
+#define HTTP_COMPRESS_WINDOW_BITS 10   // 1KB 窗口 + memLevel 4，deflate 状态约 18KB，适应 2MB 堆
+#define HTTP_COMPRESS_MEM_LEVEL 4
+#define HTTP_COMPRESS_CHUNK 4096       // 压缩输出缓冲区，写满即作为一个 chunk 发出
+
+typedef enum {
+    HTTP_ENCODING_IDENTITY = 0,
+    HTTP_ENCODING_GZIP,
+    HTTP_ENCODING_DEFLATE, // zlib 格式，见 RFC 9110
+} HttpEncoding;
+
+// 完整写出 iov 中的全部数据，处理短写与 EAGAIN（会修改 iov）；失败返回 -1
+int http_send_iov(int fd, struct iovec *iov, int iovcnt);
+
+// status 形如 "200 OK"；extra_headers 为预格式化的额外 header，每行以 \r\n 结尾，可为 NULL
+int http_write_response(int fd, const char *status, const char *content_type, const char *extra_headers,
+                        const struct iovec *body, int body_cnt, bool keep_alive);
+
+// 分块（chunked）响应：先立即写出 header，之后每次写一个 chunk，最后写结束块
+int http_write_stream_header(int fd, const char *status, const char *content_type, const char *extra_headers, bool keep_alive);
+int http_write_chunk(int fd, const struct iovec *parts, int part_cnt);
+int http_write_chunk_end(int fd);
+
+// 根据 Accept-Encoding 选择编码，gzip 优先；q=0 视为拒绝，不认识或缺失时为 identity
+HttpEncoding http_negotiate_encoding(const char *accept_encoding);
+// 同 http_write_response；encoding 非 identity 且 body 不小于 HTTP_COMPRESS_MIN_SIZE 时以 chunked 流式压缩写出，
+// 压缩器初始化失败时退回原样发送。chunk 写到一半失败时连接已不可复用，返回 -1
+int http_write_response_encoded(int fd, const char *status, const char *content_type, const char *extra_headers,
+                                const struct iovec *body, int body_cnt, bool keep_alive, HttpEncoding encoding);
@@ -0,0 +1,162 @@
+#include "streamable_http.h"
+#include "resources.h"
+
+static Thread sampler_thread;
+
+void resources_list(cJSON *resources) {
+    cJSON *screen = cJSON_CreateObject();
+    cJSON_AddStringToObject(screen, "uri", SCREEN_RESOURCE_URI);
+    cJSON_AddStringToObject(screen, "name", "screen");
+    cJSON_AddStringToObject(screen, "title", "Current screen");
+    cJSON_AddStringToObject(screen, "description", "current graphic frame, subscribe to get notified when it changes");
+    cJSON_AddStringToObject(screen, "mimeType", "image/jpeg");
+    cJSON_AddItemToArray(resources, screen);
+}
+
+bool resources_exists(const char *uri) {
+    return uri && strcmp(uri, SCREEN_RESOURCE_URI) == 0;
+}
+
+int resources_read(const char *uri, cJSON *contents) {
+    if (!resources_exists(uri)) return -1;
+    cJSON *blob = NULL;
+    int rc = capture_jpeg_screenshot(&blob);
+    if (rc != 0) return rc;
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "uri", SCREEN_RESOURCE_URI);
+    cJSON_AddStringToObject(item, "mimeType", "image/jpeg");
+    cJSON_AddItemToObject(item, "blob", blob);
+    cJSON_AddItemToArray(contents, item);
+    return 0;
+}
+
+// FNV-1a
+static u32 hash_bytes(const u8 *data, u64 len) {
+    u32 h = 2166136261u;
+    for (u64 i = 0; i < len; ++i) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+typedef struct {
+    u32 hash;     // 整张 JPEG
+    int segments; // 0 表示没有可比较的 restart 段
+    u32 segment_hash[SCREEN_MAX_SEGMENTS];
+} FrameSignature;
+
+// restart 标记（RSTn）处 DC 预测重置且字节对齐，每段对应画面中固定的一组 MCU：
+// 画面某处变化时只有覆盖该处的段字节不同，按段比较就能得到变化区域的比例，不需要解码
+static void frame_signature(const u8 *jpeg, u64 size, FrameSignature *sig) {
+    sig->hash = hash_bytes(jpeg, size);
+    sig->segments = 0;
+    // 跳过 SOS 之前的各个 marker 段
+    u64 pos = 2;
+    bool found_scan = false;
+    while (!found_scan && pos + 4 <= size) {
+        if (jpeg[pos] != 0xFF) return;
+        u8 marker = jpeg[pos + 1];
+        if (marker == 0xFF) {
+            pos++; // 填充字节
+            continue;
+        }
+        pos += 2 + (((u64)jpeg[pos + 2] << 8) | jpeg[pos + 3]);
+        found_scan = marker == 0xDA;
+    }
+    if (!found_scan) return;
+    u64 start = pos;
+    for (u64 i = pos; i + 1 < size; ++i) {
+        if (jpeg[i] != 0xFF) continue;
+        u8 marker = jpeg[i + 1];
+        if (marker == 0x00 || marker == 0xFF) continue; // 字节填充 / 标记前的填充
+        bool restart = marker >= 0xD0 && marker <= 0xD7;
+        if ((!restart && marker != 0xD9) || sig->segments == SCREEN_MAX_SEGMENTS) break; // 多个 scan 或段太多
+        sig->segment_hash[sig->segments++] = hash_bytes(jpeg + start, i - start);
+        if (!restart) {
+            // 只有一段时没有区域信息
+            if (sig->segments == 1) sig->segments = 0;
+            return;
+        }
+        start = i + 2;
+        ++i;
+    }
+    sig->segments = 0; // 没有以 EOI 正常结束
+}
+
+// 变化区域的千分比；段数不同（分辨率或编码参数变化）或没有段信息时按整张图的哈希判断
+static int frame_change_permille(const FrameSignature *base, const FrameSignature *cur) {
+    if (cur->hash == base->hash) return 0;
+    if (!cur->segments || cur->segments != base->segments) return 1000;
+    int changed = 0;
+    for (int i = 0; i < cur->segments; ++i) changed += cur->segment_hash[i] != base->segment_hash[i];
+    return changed * 1000 / cur->segments;
+}
+
+// 只有采样线程使用，放在静态区以免占用线程栈
+static FrameSignature base_sig, last_sig, cur_sig;
+
+static void sampler_func(void *arg) {
+    SSEvent updated = {
+        .event = "message",
+        .data = "{\"jsonrpc\":\"2.0\",\"method\":\"notifications/resources/updated\",\"params\":{\"uri\":\"" SCREEN_RESOURCE_URI "\"}}"
+    };
+    char subscribers[MAX_SESSIONS][SESSION_ID_SIZE];
+    bool have_base = false;
+    u64 changed_at = 0; // 相对基准的变化首次出现的 tick，0 表示没有未推送的变化
+
+    while (1) {
+        svcSleepThread(SCREEN_SAMPLE_INTERVAL_MS * 1000000ULL);
+        if (session_subscribers(SCREEN_RESOURCE_URI, subscribers, MAX_SESSIONS) == 0) {
+            // 没有订阅者时不截图，下次有订阅时重新建立基准
+            have_base = false;
+            continue;
+        }
+        void *jpeg = NULL;
+        u64 size = 0;
+        // 客户端正在用截图缓冲区时跳过这次采样，不和请求抢
+        if (cur_frame_capture_jpeg(0, false, &jpeg, &size) != 0) continue;
+        frame_signature((const u8 *)jpeg, size, &cur_sig);
+        cur_frame_release_jpeg();
+
+        if (!have_base) {
+            have_base = true;
+            base_sig = cur_sig;
+            last_sig = cur_sig;
+            changed_at = 0;
+            continue;
+        }
+        int permille = frame_change_permille(&base_sig, &cur_sig);
+        // 与上一帧相同说明画面已经稳定（切换菜单的过渡动画结束），光标闪烁这类来回变化不会稳定
+        bool settled = cur_sig.hash == last_sig.hash;
+        last_sig = cur_sig;
+        if (permille < SCREEN_CHANGE_PERMILLE) {
+            changed_at = 0;
+            continue;
+        }
+        u64 now = svcGetSystemTick();
+        if (!changed_at) changed_at = now;
+        if (!settled && now - changed_at < armNsToTicks(SCREEN_SETTLE_MAX_MS * 1000000ULL)) continue;
+        base_sig = cur_sig;
+        changed_at = 0;
+        // 截图期间订阅者可能变化，重新获取
+        int count = session_subscribers(SCREEN_RESOURCE_URI, subscribers, MAX_SESSIONS);
+        for (int i = 0; i < count; ++i) notify_session(subscribers[i], &updated);
+        log_info("Screen changed (%d/1000 of %d segments, jpeg %llu bytes), notified %d subscribers",
+                 permille, cur_sig.segments, size, count);
+    }
+}
+
+Result resources_init() {
+    Result rs = threadCreate(&sampler_thread, sampler_func, NULL, NULL, 0x2000, 49, -2);
+    if (R_FAILED(rs)) {
+        log_error("Failed to create screen sampler thread (%x)", rs);
+        return rs;
+    }
+    rs = threadStart(&sampler_thread);
+    if (R_FAILED(rs)) {
+        log_error("Failed to start screen sampler thread (%x)", rs);
+        return rs;
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+// MCP resources：当前画面资源及其变化推送
+#pragma once
+#include <switch.h>
+#include <stdbool.h>
+#include "../third_party/cJSON.h"
+
+#define SCREEN_RESOURCE_URI "switch://screen/current"
+#define SCREEN_SAMPLE_INTERVAL_MS 1000 // 有订阅者时的采样间隔
+#define SCREEN_CHANGE_PERMILLE 20      // 超过千分之几的图像区块（JPEG restart 段）变化才视为画面变化
+#define SCREEN_MAX_SEGMENTS 256        // 参与比较的 restart 段上限，超出或没有 restart 标记时只比较整张图的哈希
+#define SCREEN_SETTLE_MAX_MS 5000      // 画面变化后等到连续两帧相同再推送，持续变化（动画）时最多等这么久
+
+// 向 resources/list 的数组追加全部资源
+void resources_list(cJSON *resources);
+bool resources_exists(const char *uri);
+// 读取资源内容追加到 contents 数组，失败返回非 0
+int resources_read(const char *uri, cJSON *contents);
+
+// 启动采样线程：仅在有会话订阅画面资源时截图，画面变化时推送 notifications/resources/updated
+Result resources_init();
@@ -0,0 +1,150 @@
+#include "streamable_http.h"
+#include "response_cache.h"
+#include "../tools/tool_registry.h"
+
+static CachedBlob *blobs[CACHED_RESULT_COUNT] = {0};
+static Mutex cache_mutex = 0;
+
+static cJSON *build_initialize() {
+    cJSON *result = cJSON_CreateObject();
+    cJSON_AddStringToObject(result, "protocolVersion", MCP_PROTOCOL_VERSION);
+
+    // 能力协商对象
+    cJSON *caps = cJSON_CreateObject();
+
+    // logging 能力
+    // cJSON *logging = cJSON_CreateObject();
+    // cJSON_AddItemToObject(caps, "logging", logging);
+
+    // prompts 能力
+    // cJSON *prompts = cJSON_CreateObject();
+    // cJSON_AddBoolToObject(prompts, "listChanged", 1);
+    // cJSON_AddItemToObject(caps, "prompts", prompts);
+
+    // resources 能力
+    cJSON *resources = cJSON_CreateObject();
+    cJSON_AddBoolToObject(resources, "subscribe", 1);
+    cJSON_AddBoolToObject(resources, "listChanged", 1);
+    cJSON_AddItemToObject(caps, "resources", resources);
+
+    // tools 能力
+    cJSON *tools = cJSON_CreateObject();
+    cJSON_AddBoolToObject(tools, "listChanged", 1);
+    cJSON_AddItemToObject(caps, "tools", tools);
+
+    // experimental 能力
+    // cJSON *experimental = cJSON_CreateObject();
+    // cJSON_AddItemToObject(caps, "experimental", experimental);
+
+    cJSON_AddItemToObject(result, "capabilities", caps);
+
+    // 服务端信息
+    cJSON *info = cJSON_CreateObject();
+    cJSON_AddStringToObject(info, "name", "SwitchMCPServer");
+    cJSON_AddStringToObject(info, "title", "Nintendo Switch MCP Server");
+    cJSON_AddStringToObject(info, "version", "1.0.0");
+    cJSON_AddItemToObject(result, "serverInfo", info);
+
+    cJSON_AddStringToObject(result, "instructions", "Welcome to Switch MCP Server.");
+    return result;
+}
+
+static cJSON *build_tools_list() {
+    cJSON *result = cJSON_CreateObject();
+    cJSON *tools = cJSON_CreateArray();
+
+    for (int i = 0; i < tool_registry_count(); ++i) {
+        tool_registry_at(i)->list(tools);
+    }
+
+    cJSON_AddItemToObject(result, "tools", tools);
+    // cJSON_AddStringToObject(result, "nextCursor", "");
+    return result;
+}
+
+// 缓存跨请求保存，构建期间暂停当前线程的请求 arena
+static CachedBlob *build_blob(CachedResult which) {
+    if (which < 0 || which >= CACHED_RESULT_COUNT) return NULL;
+    RequestArena *arena = request_arena_suspend();
+    cJSON *result = NULL;
+    switch (which) {
+    case CACHED_INITIALIZE: result = build_initialize(); break;
+    case CACHED_TOOLS_LIST: result = build_tools_list(); break;
+    default:                result = cJSON_CreateObject(); break;
+    }
+    CachedBlob *blob = result ? (CachedBlob *)heap_alloc(HEAP_TAG_HTTP, sizeof(CachedBlob)) : NULL;
+    if (blob) {
+        blob->refs = 1; // 缓存表自身持有的引用
+        blob->data = cJSON_PrintUnformattedWithLength(result, &blob->len);
+        if (!blob->data) {
+            heap_free(blob);
+            blob = NULL;
+        }
+    }
+    cJSON_Delete(result);
+    request_arena_resume(arena);
+    if (!blob) log_error("[cache] failed to build cached result %d", which);
+    return blob;
+}
+
+static void blob_unref(CachedBlob *blob) {
+    if (--blob->refs == 0) {
+        cJSON_free(blob->data);
+        heap_free(blob);
+    }
+}
+
+int response_cache_init() {
+    int failed = 0;
+    for (int i = 0; i < CACHED_RESULT_COUNT; ++i) {
+        CachedBlob *blob = build_blob((CachedResult)i);
+        mutexLock(&cache_mutex);
+        if (blobs[i]) blob_unref(blobs[i]);
+        blobs[i] = blob;
+        mutexUnlock(&cache_mutex);
+        if (!blob) failed = 1;
+        else log_info("[cache] result %d cached, %zu bytes", i, blob->len);
+    }
+    return failed ? -1 : 0;
+}
+
+CachedBlob *response_cache_acquire(CachedResult which) {
+    if (which < 0 || which >= CACHED_RESULT_COUNT) return NULL;
+    mutexLock(&cache_mutex);
+    CachedBlob *blob = blobs[which];
+    if (blob) blob->refs++;
+    mutexUnlock(&cache_mutex);
+    if (blob) return blob;
+
+    // 已失效或启动时构建失败：在锁外构建，避免阻塞其他读者
+    blob = build_blob(which);
+    if (!blob) return NULL;
+    mutexLock(&cache_mutex);
+    if (blobs[which]) {
+        // 其他线程已先一步重建
+        blob_unref(blob);
+        blob = blobs[which];
+    } else {
+        blobs[which] = blob;
+    }
+    blob->refs++;
+    mutexUnlock(&cache_mutex);
+    return blob;
+}
+
+void response_cache_release(CachedBlob *blob) {
+    if (!blob) return;
+    mutexLock(&cache_mutex);
+    blob_unref(blob);
+    mutexUnlock(&cache_mutex);
+}
+
+void response_cache_invalidate(CachedResult which) {
+    if (which < 0 || which >= CACHED_RESULT_COUNT) return;
+    mutexLock(&cache_mutex);
+    if (blobs[which]) {
+        blob_unref(blobs[which]);
+        blobs[which] = NULL;
+    }
+    mutexUnlock(&cache_mutex);
+}
@@ -0,0 +1,24 @@
+// 预序列化的常量 JSON-RPC result，避免每次请求重复构建/打印 cJSON 树
+#pragma once
+#include <stddef.h>
+
+typedef enum {
+    CACHED_INITIALIZE = 0,
+    CACHED_TOOLS_LIST,
+    CACHED_PING,
+    CACHED_RESULT_COUNT,
+} CachedResult;
+
+typedef struct {
+    int refs;    // 由 cache_mutex 保护
+    size_t len;
+    char *data;  // result 对象的 JSON 文本，NUL 结尾
+} CachedBlob;
+
+// 启动时构建全部缓存
+int response_cache_init();
+// 获取缓存（不存在时重新构建），使用完毕后必须 release；失败返回 NULL
+CachedBlob *response_cache_acquire(CachedResult which);
+void response_cache_release(CachedBlob *blob);
+// 工具集等内容变化时调用，下次 acquire 时重新构建
+void response_cache_invalidate(CachedResult which);
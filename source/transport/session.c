@@ -0,0 +1,285 @@
+#include "streamable_http.h"
+#include "session.h"
+
+// 开放寻址哈希表（线性探测），大小为 2 的幂且至少是会话数的两倍，保证探测链很短
+#define SESSION_HASH_SIZE 16
+
+typedef struct {
+    bool used;
+    char id[SESSION_ID_SIZE];
+    char protocol_version[16];
+    u64 last_active;
+    int pending;    // 处理中的请求数
+    bool pinned;    // 生命周期由连接决定，不淘汰也不过期
+    int sse_slot;   // sse 模块中的槽位，-1 表示没有事件流
+    int subscription_count;
+    char subscriptions[SESSION_MAX_SUBSCRIPTIONS][SESSION_URI_SIZE];
+} McpSession;
+
+// 全部状态静态分配，会话数与每会话内存均有固定上限；由 session_mutex 保护
+static McpSession sessions[MAX_SESSIONS];
+static s8 session_index[SESSION_HASH_SIZE]; // 会话下标，-1 表示空位
+static bool index_ready = false;
+static Mutex session_mutex = 0;
+
+// 被回收会话的事件流需在释放 session_mutex 后关闭（sse 模块会在持有自身锁时回调本模块）
+typedef struct {
+    int slot;
+    char id[SESSION_ID_SIZE];
+} ClosedStream;
+
+// 生成随机 session id
+static void gen_session_id(char *buf, int len) {
+    for (int i = 0; i < len-1; ++i) {
+        int r = rand() % 62;
+        buf[i] = (r < 10) ? ('0'+r) : (r < 36 ? 'A'+r-10 : 'a'+r-36);
+    }
+    buf[len-1] = '\0';
+}
+
+// FNV-1a
+static u32 hash_id(const char *id) {
+    u32 h = 2166136261u;
+    while (*id) {
+        h ^= (unsigned char)*id++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void ensure_index() {
+    if (index_ready) return;
+    memset(session_index, -1, sizeof(session_index));
+    index_ready = true;
+}
+
+// 返回哈希表中的位置，不存在返回 -1
+static int find_pos(const char *id) {
+    ensure_index();
+    u32 pos = hash_id(id) & (SESSION_HASH_SIZE - 1);
+    for (int n = 0; n < SESSION_HASH_SIZE; ++n) {
+        int idx = session_index[pos];
+        if (idx < 0) return -1;
+        if (strcmp(sessions[idx].id, id) == 0) return (int)pos;
+        pos = (pos + 1) & (SESSION_HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+static void index_insert(int idx) {
+    ensure_index();
+    u32 pos = hash_id(sessions[idx].id) & (SESSION_HASH_SIZE - 1);
+    while (session_index[pos] >= 0) pos = (pos + 1) & (SESSION_HASH_SIZE - 1);
+    session_index[pos] = (s8)idx;
+}
+
+// 删除后把探测链上的后续元素前移，避免留下墓碑
+static void index_erase(int pos) {
+    session_index[pos] = -1;
+    u32 next = (pos + 1) & (SESSION_HASH_SIZE - 1);
+    while (session_index[next] >= 0) {
+        int idx = session_index[next];
+        session_index[next] = -1;
+        index_insert(idx);
+        next = (next + 1) & (SESSION_HASH_SIZE - 1);
+    }
+}
+
+static void remove_at(int pos, ClosedStream *closed) {
+    McpSession *s = &sessions[session_index[pos]];
+    closed->slot = s->sse_slot;
+    strcpy(closed->id, s->id);
+    log_info("Session %s removed", s->id);
+    *s = (McpSession){0};
+    index_erase(pos);
+}
+
+static bool is_expired(const McpSession *s, u64 now) {
+    return !s->pinned && s->pending == 0 && now - s->last_active > armNsToTicks(SESSION_IDLE_TIMEOUT_MS * 1000000ULL);
+}
+
+// 查找会话，过期的会话在此处回收
+static McpSession *lookup(const char *id, ClosedStream *closed) {
+    if (!id) return NULL;
+    int pos = find_pos(id);
+    if (pos < 0) return NULL;
+    McpSession *s = &sessions[session_index[pos]];
+    if (is_expired(s, svcGetSystemTick())) {
+        remove_at(pos, closed);
+        return NULL;
+    }
+    return s;
+}
+
+static void close_streams(const ClosedStream *closed, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (closed[i].slot >= 0) sse_close_session(closed[i].slot, closed[i].id);
+    }
+}
+
+int session_create(const char *protocol_version, bool pinned, char *id_out) {
+    ClosedStream closed[MAX_SESSIONS];
+    int closed_count = 0;
+    int rc = SESSION_OK;
+
+    mutexLock(&session_mutex);
+    ensure_index();
+    u64 now = svcGetSystemTick();
+    int free_idx = -1;
+    int lru_idx = -1;
+    for (int i = 0; i < MAX_SESSIONS; ++i) {
+        if (sessions[i].used && is_expired(&sessions[i], now)) {
+            remove_at(find_pos(sessions[i].id), &closed[closed_count++]);
+        }
+        if (!sessions[i].used) {
+            if (free_idx < 0) free_idx = i;
+        } else if (sessions[i].pending == 0 && !sessions[i].pinned && (lru_idx < 0 || sessions[i].last_active < sessions[lru_idx].last_active)) {
+            lru_idx = i;
+        }
+    }
+    if (free_idx < 0 && lru_idx >= 0) {
+        // 表满时淘汰最久未活动且空闲的会话
+        log_warning("Session table full, evicting %s", sessions[lru_idx].id);
+        remove_at(find_pos(sessions[lru_idx].id), &closed[closed_count++]);
+        free_idx = lru_idx;
+    }
+    if (free_idx < 0) {
+        rc = SESSION_ERR_FULL;
+    } else {
+        McpSession *s = &sessions[free_idx];
+        do {
+            gen_session_id(s->id, sizeof(s->id));
+        } while (find_pos(s->id) >= 0);
+        s->used = true;
+        s->pinned = pinned;
+        snprintf(s->protocol_version, sizeof(s->protocol_version), "%s", protocol_version ? protocol_version : MCP_PROTOCOL_VERSION);
+        s->last_active = now;
+        s->sse_slot = -1;
+        index_insert(free_idx);
+        strcpy(id_out, s->id);
+        log_info("Session %s created (protocol %s)", s->id, s->protocol_version);
+    }
+    mutexUnlock(&session_mutex);
+
+    close_streams(closed, closed_count);
+    return rc;
+}
+
+int session_remove(const char *id) {
+    ClosedStream closed = { .slot = -1 };
+    mutexLock(&session_mutex);
+    int pos = id ? find_pos(id) : -1;
+    if (pos >= 0) remove_at(pos, &closed);
+    mutexUnlock(&session_mutex);
+    close_streams(&closed, 1);
+    return pos >= 0 ? SESSION_OK : SESSION_ERR_UNKNOWN;
+}
+
+int session_touch(const char *id) {
+    ClosedStream closed = { .slot = -1 };
+    mutexLock(&session_mutex);
+    McpSession *s = lookup(id, &closed);
+    if (s) s->last_active = svcGetSystemTick();
+    mutexUnlock(&session_mutex);
+    close_streams(&closed, 1);
+    return s ? SESSION_OK : SESSION_ERR_UNKNOWN;
+}
+
+int session_begin_request(const char *id) {
+    ClosedStream closed = { .slot = -1 };
+    int rc = SESSION_OK;
+    mutexLock(&session_mutex);
+    McpSession *s = lookup(id, &closed);
+    if (!s) {
+        rc = SESSION_ERR_UNKNOWN;
+    } else if (s->pending >= SESSION_MAX_PENDING) {
+        rc = SESSION_ERR_BUSY;
+    } else {
+        s->pending++;
+        s->last_active = svcGetSystemTick();
+    }
+    mutexUnlock(&session_mutex);
+    close_streams(&closed, 1);
+    return rc;
+}
+
+void session_end_request(const char *id) {
+    mutexLock(&session_mutex);
+    int pos = id ? find_pos(id) : -1;
+    if (pos >= 0) {
+        McpSession *s = &sessions[session_index[pos]];
+        if (s->pending > 0) s->pending--;
+        s->last_active = svcGetSystemTick();
+    }
+    mutexUnlock(&session_mutex);
+}
+
+int session_get_sse_slot(const char *id, int *slot) {
+    mutexLock(&session_mutex);
+    int pos = id ? find_pos(id) : -1;
+    if (pos >= 0) *slot = sessions[session_index[pos]].sse_slot;
+    mutexUnlock(&session_mutex);
+    return pos >= 0 ? SESSION_OK : SESSION_ERR_UNKNOWN;
+}
+
+static int find_subscription(const McpSession *s, const char *uri) {
+    for (int i = 0; i < s->subscription_count; ++i) {
+        if (strcmp(s->subscriptions[i], uri) == 0) return i;
+    }
+    return -1;
+}
+
+int session_subscribe(const char *id, const char *uri) {
+    ClosedStream closed = { .slot = -1 };
+    int rc = SESSION_OK;
+    mutexLock(&session_mutex);
+    McpSession *s = lookup(id, &closed);
+    if (!s) {
+        rc = SESSION_ERR_UNKNOWN;
+    } else if (find_subscription(s, uri) < 0) {
+        if (s->subscription_count >= SESSION_MAX_SUBSCRIPTIONS || strlen(uri) >= SESSION_URI_SIZE) {
+            rc = SESSION_ERR_FULL;
+        } else {
+            strcpy(s->subscriptions[s->subscription_count++], uri);
+        }
+    }
+    mutexUnlock(&session_mutex);
+    close_streams(&closed, 1);
+    return rc;
+}
+
+int session_unsubscribe(const char *id, const char *uri) {
+    ClosedStream closed = { .slot = -1 };
+    mutexLock(&session_mutex);
+    McpSession *s = lookup(id, &closed);
+    if (s) {
+        int i = find_subscription(s, uri);
+        if (i >= 0) {
+            --s->subscription_count;
+            if (i != s->subscription_count) strcpy(s->subscriptions[i], s->subscriptions[s->subscription_count]);
+        }
+    }
+    mutexUnlock(&session_mutex);
+    close_streams(&closed, 1);
+    return s ? SESSION_OK : SESSION_ERR_UNKNOWN;
+}
+
+int session_subscribers(const char *uri, char ids[][SESSION_ID_SIZE], int max) {
+    int count = 0;
+    mutexLock(&session_mutex);
+    for (int i = 0; i < MAX_SESSIONS && count < max; ++i) {
+        if (sessions[i].used && find_subscription(&sessions[i], uri) >= 0) {
+            strcpy(ids[count++], sessions[i].id);
+        }
+    }
+    mutexUnlock(&session_mutex);
+    return count;
+}
+
+int session_set_sse_slot(const char *id, int slot) {
+    mutexLock(&session_mutex);
+    int pos = id ? find_pos(id) : -1;
+    if (pos >= 0) sessions[session_index[pos]].sse_slot = slot;
+    mutexUnlock(&session_mutex);
+    return pos >= 0 ? SESSION_OK : SESSION_ERR_UNKNOWN;
+}
@@ -0,0 +1,37 @@
+// MCP 会话表：按 Mcp-Session-Id 哈希索引，每个会话占用固定大小的状态
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MAX_SESSIONS 8
+#define SESSION_ID_SIZE 40          // 含结尾 NUL
+#define SESSION_IDLE_TIMEOUT_MS (10 * 60 * 1000)  // 无请求、无事件流活动超过该时间的会话被回收
+#define SESSION_MAX_PENDING 4       // 单个会话同时处理中的请求上限
+#define SESSION_MAX_SUBSCRIPTIONS 4 // 单个会话可订阅的资源数
+#define SESSION_URI_SIZE 64
+
+#define SESSION_OK 0
+#define SESSION_ERR_UNKNOWN -1  // 不存在或已过期
+#define SESSION_ERR_BUSY -2     // 处理中的请求已达上限
+#define SESSION_ERR_FULL -3     // 会话表已满且没有可回收的会话，或订阅数已达上限
+
+// 新建会话，id 写入 id_out（至少 SESSION_ID_SIZE 字节）。pinned 的会话（WebSocket 连接所有）
+// 不会被淘汰或因空闲过期，只能由 session_remove 结束
+int session_create(const char *protocol_version, bool pinned, char *id_out);
+// 显式结束会话（DELETE /mcp），同时关闭其事件流
+int session_remove(const char *id);
+// 刷新活动时间，用于校验 id
+int session_touch(const char *id);
+// 请求开始/结束时调用，统计处理中的请求数
+int session_begin_request(const char *id);
+void session_end_request(const char *id);
+
+// 会话对应的 SSE 槽位，-1 表示没有
+int session_get_sse_slot(const char *id, int *slot);
+int session_set_sse_slot(const char *id, int slot);
+
+// 资源订阅
+int session_subscribe(const char *id, const char *uri);
+int session_unsubscribe(const char *id, const char *uri);
+// 收集订阅了 uri 的会话 id，返回数量
+int session_subscribers(const char *uri, char ids[][SESSION_ID_SIZE], int max);
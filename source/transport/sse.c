@@ -6,67 +6,246 @@
 
 #define SSE_BUFFER_SIZE 512
 #define MAX_SSE_CONNECTIONS 2
-static int sse_connection = 0;
+#define SSE_REPLAY_EVENTS 16 // 每个会话保留最近的事件数，供 Last-Event-ID 断线续传
+#define SSE_QUEUE_LEN 32     // 每个连接待发送的消息上限，需容纳 header + 全部重放事件
+#define SSE_HEARTBEAT_MS 4000
+
+// 发送队列已满时的处理策略
+#define SSE_OVERFLOW_DROP_OLDEST 0 // 丢弃最旧的未开始发送的消息
+#define SSE_OVERFLOW_COALESCE    1 // 心跳只保留一条；普通事件溢出时先丢心跳，仍无空间则断开
+#define SSE_OVERFLOW_DISCONNECT  2 // 直接断开，客户端凭 Last-Event-ID 重连补发
+#ifndef SSE_OVERFLOW_POLICY
+#define SSE_OVERFLOW_POLICY SSE_OVERFLOW_COALESCE
+#endif
+
+// 引用计数的预格式化消息，由事件环与各连接的发送队列共享
+typedef struct {
+    int refs;
+    bool heartbeat;
+    u32 id;  // 0 表示不参与重放
+    int len;
+    char data[];
+} SseMessage;
 
 typedef struct STORED_CONNECTION {
-    int client_fd;
-    int event_id; // 用于跟踪事件 ID
+    int client_fd;  // -1 表示已断开，保留事件环等待同一会话重连
+    u32 event_id;   // 下一个事件 ID，单调递增
     char *Mcp_Session_Id;
-    Thread thread;
+    SseMessage *events[SSE_REPLAY_EVENTS]; // 环形缓冲，最旧的事件被覆盖
+    int event_head;  // 最旧事件所在位置
+    int event_count;
+    SseMessage *queue[SSE_QUEUE_LEN]; // 待发送消息，queue_head 处的消息可能已部分写出
+    int queue_head;
+    int queue_count;
+    int queue_sent;  // 队首消息已写出的字节数
 } StoredConnection;
 
+// 连接表由 sse_mutex 保护；所有 fd 均为非阻塞，任何线程都不会在持锁时阻塞于 send
+// 槽位固定不移动，会话表中记录槽位下标；Mcp_Session_Id 为 NULL 表示空槽
 static StoredConnection sse_connections[MAX_SSE_CONNECTIONS] = {0};
+static int sse_connection = 0; // 已占用的槽位数
+static Mutex sse_mutex = 0;
+
+// 唤醒发送线程的 loopback 套接字对：[0] 发送线程读端，[1] 其他线程写端
+static int pump_wake_fds[2] = {-1, -1};
+
+static SseMessage *message_new(const char *prefix, int prefix_len, const char *body, int body_len) {
+    SseMessage *msg = (SseMessage*)heap_alloc(HEAP_TAG_SSE, sizeof(SseMessage) + prefix_len + body_len);
+    if (!msg) {
+        log_error("Failed to alloc SSE message");
+        return NULL;
+    }
+    msg->refs = 1;
+    msg->heartbeat = false;
+    msg->id = 0;
+    msg->len = prefix_len + body_len;
+    memcpy(msg->data, prefix, prefix_len);
+    memcpy(msg->data + prefix_len, body, body_len);
+    return msg;
+}
+
+// 引用计数只在持有 sse_mutex 时修改
+static SseMessage *message_ref(SseMessage *msg) {
+    ++msg->refs;
+    return msg;
+}
+
+static void message_unref(SseMessage *msg) {
+    if (msg && --msg->refs == 0) heap_free(msg);
+}
+
+static void clear_queue(StoredConnection *conn) {
+    for (int i = 0; i < conn->queue_count; ++i) {
+        message_unref(conn->queue[(conn->queue_head + i) % SSE_QUEUE_LEN]);
+    }
+    conn->queue_head = 0;
+    conn->queue_count = 0;
+    conn->queue_sent = 0;
+}
 
 static void free_connection(int idx) {
-    if (idx < 0 || idx >= sse_connection) return;
+    if (idx < 0 || idx >= MAX_SSE_CONNECTIONS || !sse_connections[idx].Mcp_Session_Id) return;
     if (sse_connections[idx].client_fd >= 0) {
         close(sse_connections[idx].client_fd);
     }
     if (sse_connections[idx].Mcp_Session_Id) {
-        free(sse_connections[idx].Mcp_Session_Id);
+        heap_free(sse_connections[idx].Mcp_Session_Id);
         sse_connections[idx].Mcp_Session_Id = NULL;
     }
+    for (int i = 0; i < sse_connections[idx].event_count; ++i) {
+        message_unref(sse_connections[idx].events[(sse_connections[idx].event_head + i) % SSE_REPLAY_EVENTS]);
+    }
+    clear_queue(&sse_connections[idx]);
     sse_connections[idx] = (StoredConnection){0};
+    --sse_connection;
+}
+
+// 断开连接但保留会话与事件环，客户端可带 Last-Event-ID 重连
+static void detach_connection(StoredConnection *conn) {
+    if (conn->client_fd >= 0) close(conn->client_fd);
+    conn->client_fd = -1;
+    clear_queue(conn);
+}
+
+static void wake_pump() {
+    if (pump_wake_fds[1] >= 0) send(pump_wake_fds[1], "w", 1, 0); // 缓冲区满说明已有待处理唤醒，忽略失败
 }
 
-static void compact_connections(int start_idx) {
-    if (start_idx < 0 || start_idx >= sse_connection) return;
-    for (int i = start_idx; i < sse_connection - 1; ++i) {
-        sse_connections[i] = sse_connections[i+1];
+// 丢弃一条未开始发送的消息腾出空间；heartbeat_only 时只丢心跳
+static bool drop_queued(StoredConnection *conn, bool heartbeat_only) {
+    int first = conn->queue_sent > 0 ? 1 : 0; // 部分写出的队首不能丢，否则破坏事件流
+    for (int i = first; i < conn->queue_count; ++i) {
+        int pos = (conn->queue_head + i) % SSE_QUEUE_LEN;
+        if (heartbeat_only && !conn->queue[pos]->heartbeat) continue;
+        message_unref(conn->queue[pos]);
+        for (int j = i; j < conn->queue_count - 1; ++j) {
+            conn->queue[(conn->queue_head + j) % SSE_QUEUE_LEN] = conn->queue[(conn->queue_head + j + 1) % SSE_QUEUE_LEN];
+        }
+        --conn->queue_count;
+        return true;
     }
-    sse_connections[sse_connection-1] = (StoredConnection){0};
-    --sse_connection;
+    return false;
+}
+
+// 消息入队（增加引用），按 SSE_OVERFLOW_POLICY 处理溢出；返回 false 表示应断开该连接
+static bool enqueue_message(StoredConnection *conn, SseMessage *msg) {
+    if (msg->heartbeat && conn->queue_count > 0) {
+        // 队列非空说明连接本身仍有数据在路上，心跳没有意义
+        return true;
+    }
+    if (conn->queue_count == SSE_QUEUE_LEN) {
+#if SSE_OVERFLOW_POLICY == SSE_OVERFLOW_DROP_OLDEST
+        if (!drop_queued(conn, false)) return false;
+        log_warning("SSE queue full fd=%d, dropped oldest message", conn->client_fd);
+#elif SSE_OVERFLOW_POLICY == SSE_OVERFLOW_COALESCE
+        if (!drop_queued(conn, true)) return false;
+#else
+        return false;
+#endif
+    }
+    conn->queue[(conn->queue_head + conn->queue_count) % SSE_QUEUE_LEN] = message_ref(msg);
+    ++conn->queue_count;
+    return true;
 }
 
-// 发送SSE头部
-void sse_send_header(int sock) {
-    const char *header =
+// 非阻塞地尽量写出队列；返回 false 表示连接出错
+static bool flush_queue(StoredConnection *conn) {
+    while (conn->queue_count > 0) {
+        SseMessage *msg = conn->queue[conn->queue_head];
+        ssize_t n = send(conn->client_fd, msg->data + conn->queue_sent, msg->len - conn->queue_sent, 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        conn->queue_sent += n;
+        if (conn->queue_sent < msg->len) return true;
+        message_unref(msg);
+        conn->queue_head = (conn->queue_head + 1) % SSE_QUEUE_LEN;
+        --conn->queue_count;
+        conn->queue_sent = 0;
+    }
+    return true;
+}
+
+// 入队并立即尝试写出，剩余部分交给发送线程；返回队列是否仍有剩余
+static bool deliver(StoredConnection *conn, SseMessage *msg) {
+    if (!enqueue_message(conn, msg)) {
+        log_error("SSE client fd=%d fell behind (%d queued), detaching", conn->client_fd, conn->queue_count);
+        detach_connection(conn);
+        return false;
+    }
+    if (!flush_queue(conn)) {
+        log_error("SSE send failed fd=%d errno=%d, detaching", conn->client_fd, errno);
+        detach_connection(conn);
+        return false;
+    }
+    return conn->queue_count > 0;
+}
+
+// 记录一条事件到会话的事件环，满时丢弃最旧的
+static SseMessage *store_event(StoredConnection *conn, const char *body, int body_len) {
+    char id_line[24];
+    int id_len = snprintf(id_line, sizeof(id_line), "id: %lu\n", (unsigned long)conn->event_id);
+    SseMessage *msg = message_new(id_line, id_len, body, body_len);
+    if (!msg) return NULL;
+    msg->id = conn->event_id++;
+
+    int pos;
+    if (conn->event_count == SSE_REPLAY_EVENTS) {
+        pos = conn->event_head;
+        message_unref(conn->events[pos]);
+        conn->event_head = (conn->event_head + 1) % SSE_REPLAY_EVENTS;
+    } else {
+        pos = (conn->event_head + conn->event_count) % SSE_REPLAY_EVENTS;
+        ++conn->event_count;
+    }
+    conn->events[pos] = msg;
+    return msg;
+}
+
+// 把 last_event_id 之后的全部事件放入发送队列
+static void replay_events(StoredConnection *conn, u32 last_event_id) {
+    if (conn->event_count == 0) return;
+    u32 oldest = conn->events[conn->event_head]->id;
+    if (oldest > last_event_id + 1) {
+        log_warning("SSE replay gap for %s: requested after %lu, oldest kept %lu",
+            conn->Mcp_Session_Id, (unsigned long)last_event_id, (unsigned long)oldest);
+    }
+    int replayed = 0;
+    for (int i = 0; i < conn->event_count && conn->client_fd >= 0; ++i) {
+        SseMessage *ev = conn->events[(conn->event_head + i) % SSE_REPLAY_EVENTS];
+        if (ev->id <= last_event_id) continue;
+        if (!enqueue_message(conn, ev)) {
+            log_error("SSE replay overflow fd=%d", conn->client_fd);
+            detach_connection(conn);
+            return;
+        }
+        ++replayed;
+    }
+    log_info("Queued %d SSE events for replay to %s", replayed, conn->Mcp_Session_Id);
+}
+
+// SSE 头部与首个心跳事件，符合客户端固定格式
+static SseMessage *header_message() {
+    static const char header[] =
         "HTTP/1.1 200 OK\r\n"
         "Content-Type: text/event-stream\r\n"
         "Cache-Control: no-cache\r\n"
         "Connection: keep-alive\r\n"
         "\r\n";
-    ssize_t sent = send(sock, header, strlen(header), 0);
-    if (sent <= 0) {
-        log_error("Failed to send SSE header fd=%d errno=%d", sock, errno);
-        return;
-    }
-    // 立即发送一个正式心跳事件，符合客户端固定格式
-    const char *hb_evt = "event: message\n"
-                         "data: {\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}\n\n";
-    send(sock, hb_evt, strlen(hb_evt), 0);
-    log_info("SSE header sent successfully to client_fd: %d", sock);
+    static const char hb_evt[] =
+        "event: message\n"
+        "data: {\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}\n\n";
+    return message_new(header, sizeof(header) - 1, hb_evt, sizeof(hb_evt) - 1);
 }
 
-// 发送一条SSE事件
-void notificate_all(SSEvent *ssevent) {
-    if (!ssevent || sse_connection <= 0) return;
-
-    char buf[SSE_BUFFER_SIZE];
+// 格式化事件正文（event/data 行与结尾空行，不含 id）
+static int format_event(const SSEvent *ssevent, char *buf) {
     int len = 0;
     if (ssevent->event) {
         int written = snprintf(buf + len, SSE_BUFFER_SIZE - len, "event: %s\n", ssevent->event);
-        if (written < 0 || written >= SSE_BUFFER_SIZE - len) return; // 防止溢出
+        if (written < 0 || written >= SSE_BUFFER_SIZE - len) return -1; // 防止溢出
         len += written;
     }
     const char *p = ssevent->data ? ssevent->data : "";
@@ -82,48 +261,184 @@ void notificate_all(SSEvent *ssevent) {
         buf[len++] = '\n';
         buf[len] = '\0';
     }
+    return len;
+}
 
-    for (int i = 0; i < sse_connection; ) {
-        ssize_t sent = send(sse_connections[i].client_fd, buf, len, 0);
-        if (sent <= 0) {
-            log_error("SSE send failed fd=%d errno=%d, removing", sse_connections[i].client_fd, errno);
-            free_connection(i);
-            compact_connections(i); // i 位置已填充下一个连接，再继续同 i
-            continue;
+// 发送一条SSE事件，target 为 NULL 时发给所有会话；replayable 的事件带 id 并进入事件环，心跳不记录
+static void broadcast(const SSEvent *ssevent, const char *target, bool replayable) {
+    char buf[SSE_BUFFER_SIZE];
+    int len = format_event(ssevent, buf);
+    if (len < 0) return;
+
+    bool pending = false;
+    char live[MAX_SSE_CONNECTIONS][SESSION_ID_SIZE];
+    int live_count = 0;
+    mutexLock(&sse_mutex);
+    SseMessage *shared = NULL;
+    if (!replayable && sse_connection > 0) {
+        shared = message_new("", 0, buf, len);
+        if (shared) shared->heartbeat = true;
+    }
+    for (int i = 0; i < MAX_SSE_CONNECTIONS; ++i) {
+        StoredConnection *conn = &sse_connections[i];
+        if (!conn->Mcp_Session_Id || (target && strcmp(conn->Mcp_Session_Id, target) != 0)) continue;
+        SseMessage *msg = replayable ? store_event(conn, buf, len) : shared;
+        if (!msg || conn->client_fd < 0) continue;
+        pending |= deliver(conn, msg);
+        if (!replayable && conn->client_fd >= 0) {
+            snprintf(live[live_count++], SESSION_ID_SIZE, "%s", conn->Mcp_Session_Id);
+        }
+    }
+    message_unref(shared);
+    mutexUnlock(&sse_mutex);
+    if (pending) wake_pump();
+    // 事件流仍在的会话视为活跃；会话模块可能回调 sse_close_session，须在释放 sse_mutex 后调用
+    for (int i = 0; i < live_count; ++i) session_touch(live[i]);
+}
+
+void notificate_all(SSEvent *ssevent) {
+    if (!ssevent) return;
+    broadcast(ssevent, NULL, true);
+}
+
+void notify_session(const char *Mcp_Session_Id, SSEvent *ssevent) {
+    if (!ssevent || !Mcp_Session_Id) return;
+    broadcast(ssevent, Mcp_Session_Id, true);
+}
+
+static StoredConnection *find_by_fd(int fd) {
+    for (int i = 0; i < MAX_SSE_CONNECTIONS; ++i) {
+        if (sse_connections[i].Mcp_Session_Id && sse_connections[i].client_fd == fd) return &sse_connections[i];
+    }
+    return NULL;
+}
+
+// 处理 poll 结果：客户端不应发送数据，可读即意味着关闭或出错
+static void service_connection(const struct pollfd *pfd) {
+    StoredConnection *conn = find_by_fd(pfd->fd);
+    if (!conn) return; // 期间已被替换或淘汰
+    if (pfd->revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        log_info("SSE client fd=%d closed", pfd->fd);
+        detach_connection(conn);
+        return;
+    }
+    if (pfd->revents & POLLIN) {
+        char tmp[64];
+        ssize_t n = recv(conn->client_fd, tmp, sizeof(tmp), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            log_info("SSE client fd=%d closed", pfd->fd);
+            detach_connection(conn);
+            return;
         }
-        ++i;
     }
+    if ((pfd->revents & POLLOUT) && !flush_queue(conn)) {
+        log_error("SSE send failed fd=%d errno=%d, detaching", conn->client_fd, errno);
+        detach_connection(conn);
+    }
+}
+
+Result sse_init() {
+    return loopback_socket_pair(pump_wake_fds);
 }
 
-// 连接主循环（伪代码）
+// 发送线程：等待可写或对端关闭，定时发送心跳
 void sse_heartbeat(void* arg) {
     SSEvent ssevent = {
         .event = "message",
         .data = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}"
     };
+    u64 interval = armNsToTicks(SSE_HEARTBEAT_MS * 1000000ULL);
+    u64 next_heartbeat = svcGetSystemTick() + interval;
+    struct pollfd pfds[MAX_SSE_CONNECTIONS + 1];
 
     while (1) {
-        notificate_all(&ssevent);
-        svcSleepThread(4000000000ULL); // 4s heartbeat
+        int nfds = 0;
+        pfds[nfds++] = (struct pollfd){ .fd = pump_wake_fds[0], .events = POLLIN };
+        mutexLock(&sse_mutex);
+        for (int i = 0; i < MAX_SSE_CONNECTIONS; ++i) {
+            if (!sse_connections[i].Mcp_Session_Id || sse_connections[i].client_fd < 0) continue;
+            short events = POLLIN | (sse_connections[i].queue_count > 0 ? POLLOUT : 0);
+            pfds[nfds++] = (struct pollfd){ .fd = sse_connections[i].client_fd, .events = events };
+        }
+        mutexUnlock(&sse_mutex);
+
+        u64 now = svcGetSystemTick();
+        int timeout_ms = now >= next_heartbeat ? 0 : (int)(armTicksToNs(next_heartbeat - now) / 1000000ULL);
+        int ready = poll(pfds, nfds, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            log_error("SSE poll failed errno=%d", errno);
+            svcSleepThread(10000000ULL); // 10ms
+        }
+        if (ready > 0) {
+            if (pfds[0].revents) {
+                char tmp[64];
+                while (recv(pump_wake_fds[0], tmp, sizeof(tmp), 0) > 0) {}
+            }
+            mutexLock(&sse_mutex);
+            for (int i = 1; i < nfds; ++i) {
+                if (pfds[i].revents) service_connection(&pfds[i]);
+            }
+            mutexUnlock(&sse_mutex);
+        }
+
+        if (svcGetSystemTick() >= next_heartbeat) {
+            broadcast(&ssevent, NULL, false);
+            next_heartbeat = svcGetSystemTick() + interval;
+        }
     }
 }
 
+// 通过会话表 O(1) 找到该会话的槽位，没有返回 -1
 int connected(const char *Mcp_Session_Id) {
-    for (int i = 0; i < sse_connection; i++) {
-        if (sse_connections[i].Mcp_Session_Id && strcmp(sse_connections[i].Mcp_Session_Id, Mcp_Session_Id) == 0) {
+    int slot = -1;
+    if (session_get_sse_slot(Mcp_Session_Id, &slot) != SESSION_OK || slot < 0 || slot >= MAX_SSE_CONNECTIONS) return -1;
+    const char *owner = sse_connections[slot].Mcp_Session_Id;
+    return owner && strcmp(owner, Mcp_Session_Id) == 0 ? slot : -1;
+}
+
+static int free_slot() {
+    for (int i = 0; i < MAX_SSE_CONNECTIONS; ++i) {
+        if (!sse_connections[i].Mcp_Session_Id) return i;
+    }
+    return -1;
+}
+
+// 槽位已满时淘汰一个已断开的会话，返回腾出的槽位
+static int evict_detached(void) {
+    for (int i = 0; i < MAX_SSE_CONNECTIONS; ++i) {
+        if (sse_connections[i].Mcp_Session_Id && sse_connections[i].client_fd < 0) {
+            log_info("Evicting detached SSE session %s", sse_connections[i].Mcp_Session_Id);
+            session_set_sse_slot(sse_connections[i].Mcp_Session_Id, -1);
+            free_connection(i);
             return i;
         }
     }
     return -1;
 }
 
-Result add_sse_connection(int client_fd, char *Mcp_Session_Id, char *Last_Event_ID) {
-    if (sse_connection >= MAX_SSE_CONNECTIONS) {
-        log_error("Max SSE connections reached");
-        // todo 不要直接关闭，而是返回错误码
-        close(client_fd);
-        return -1;
+// 会话结束或过期时由会话模块调用
+void sse_close_session(int slot, const char *Mcp_Session_Id) {
+    mutexLock(&sse_mutex);
+    if (slot >= 0 && slot < MAX_SSE_CONNECTIONS && sse_connections[slot].Mcp_Session_Id &&
+        strcmp(sse_connections[slot].Mcp_Session_Id, Mcp_Session_Id) == 0) {
+        log_info("Closing SSE stream of session %s", Mcp_Session_Id);
+        free_connection(slot);
+    }
+    mutexUnlock(&sse_mutex);
+}
+
+// 当前已连接（未断开）的事件流数量
+int sse_active_connections() {
+    int count = 0;
+    mutexLock(&sse_mutex);
+    for (int i = 0; i < MAX_SSE_CONNECTIONS; ++i) {
+        if (sse_connections[i].Mcp_Session_Id && sse_connections[i].client_fd >= 0) ++count;
     }
+    mutexUnlock(&sse_mutex);
+    return count;
+}
+
+Result add_sse_connection(int client_fd, const char *Mcp_Session_Id, const char *Last_Event_ID) {
     if (client_fd < 0) {
         log_error("Invalid client_fd: %d", client_fd);
         return -2;
@@ -133,34 +448,73 @@ Result add_sse_connection(int client_fd, char *Mcp_Session_Id, char *Last_Event_
         close(client_fd);
         return -3;
     }
+    bool resume = Last_Event_ID != NULL;
+    u32 last_event_id = resume ? (u32)strtoul(Last_Event_ID, NULL, 10) : 0;
+    SseMessage *header = header_message();
+    if (!header) {
+        close(client_fd);
+        return -5;
+    }
+    int flags = fcntl(client_fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
+
+    mutexLock(&sse_mutex);
     int indx = connected(Mcp_Session_Id);
     if (indx >= 0) {
-        log_warning("Mcp_Session_Id already connected: %s, will abort old connection", Mcp_Session_Id);
-        // 复用该槽：关闭旧 fd，保留/替换 session id (相同值)
-        if (sse_connections[indx].client_fd >= 0) close(sse_connections[indx].client_fd);
+        if (sse_connections[indx].client_fd >= 0) {
+            log_warning("Mcp_Session_Id already connected: %s, will abort old connection", Mcp_Session_Id);
+        }
+        // 复用该槽：关闭旧 fd，保留 session id 与事件环
+        detach_connection(&sse_connections[indx]);
         sse_connections[indx].client_fd = client_fd;
-        sse_connections[indx].event_id = Last_Event_ID ? atoi(Last_Event_ID) + 1 : 1;
     } else {
-        if (sse_connection >= MAX_SSE_CONNECTIONS) {
-            log_error("SSE connection race overflow");
+        indx = free_slot();
+        if (indx < 0) indx = evict_detached();
+        if (indx < 0) {
+            mutexUnlock(&sse_mutex);
+            message_unref(header);
+            log_error("Max SSE connections reached");
+            metrics_count_rejected(METRIC_REJECT_SSE_FULL);
+            // todo 不要直接关闭，而是返回错误码
+            close(client_fd);
+            return -1;
+        }
+        if (session_set_sse_slot(Mcp_Session_Id, indx) != SESSION_OK) {
+            mutexUnlock(&sse_mutex);
+            message_unref(header);
+            log_error("Session %s ended before its SSE stream was attached", Mcp_Session_Id);
             close(client_fd);
             return -4;
         }
-        sse_connections[sse_connection].client_fd = client_fd;
         // 复制 session id，避免使用静态缓冲被覆盖
         size_t sid_len = strlen(Mcp_Session_Id) + 1;
-        char *sid_copy = (char*)malloc(sid_len);
+        char *sid_copy = (char*)heap_alloc(HEAP_TAG_SSE, sid_len);
         if (!sid_copy) {
+            session_set_sse_slot(Mcp_Session_Id, -1);
+            mutexUnlock(&sse_mutex);
+            message_unref(header);
             log_error("Failed to alloc for session id");
             close(client_fd);
             return -5;
         }
         memcpy(sid_copy, Mcp_Session_Id, sid_len);
-        sse_connections[sse_connection].Mcp_Session_Id = sid_copy;
-        sse_connections[sse_connection].event_id = Last_Event_ID ? atoi(Last_Event_ID) + 1 : 1;
+        sse_connections[indx].client_fd = client_fd;
+        sse_connections[indx].Mcp_Session_Id = sid_copy;
+        // 服务端没有该会话的历史时，从客户端已见的 ID 之后继续编号，保证单调
+        sse_connections[indx].event_id = resume ? last_event_id + 1 : 1;
         ++sse_connection;
     }
+    StoredConnection *conn = &sse_connections[indx];
+    enqueue_message(conn, header); // 队列刚清空，必然成功
+    if (resume) replay_events(conn, last_event_id);
+    if (conn->client_fd >= 0 && !flush_queue(conn)) {
+        log_error("Failed to send SSE header fd=%d errno=%d", client_fd, errno);
+        detach_connection(conn);
+    }
     log_info("New SSE connection added, total: %d", sse_connection);
-    sse_send_header(client_fd);
+    mutexUnlock(&sse_mutex);
+    message_unref(header);
+    // 新 fd 需要加入发送线程的 poll 集合
+    wake_pump();
     return 0;
 }
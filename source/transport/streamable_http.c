@@ -1,93 +1,387 @@
 #include "streamable_http.h"
 
-#define MAX_REQUEST_SIZE 2048
+#ifndef MAX_REQUEST_SIZE
+#define MAX_REQUEST_SIZE (64 * 1024) // 单个请求（header + body）上限，可通过 DEFINES 覆盖
+#endif
+#define MAX_CONNECTIONS 8  // reactor 同时管理的客户端连接数（含排队中的请求）
+#define REQUEST_SMALL_BUFFER 2048 // 每个连接一块，容纳常见的请求
+#ifndef REQUEST_LARGE_BUFFERS
+#define REQUEST_LARGE_BUFFERS 2 // 同时接收大请求的连接数上限，超出时回复 503
+#endif
+#define KEEPALIVE_TIMEOUT_MS 15000  // keep-alive 连接空闲超时
+#define KEEPALIVE_MAX_REQUESTS 100  // 单连接最多处理的请求数，之后响应 Connection: close
+#ifndef CAPTURE_HEAP_BUDGET
+#define CAPTURE_HEAP_BUDGET CUR_FRAME_CJSON_HEAP(CUR_FRAME_JPEG_EXPECTED) // 截图类请求入队所需的空闲堆，约 1.2MB
+#endif
 
 // 线程池相关
 #define WORKER_COUNT 2
 static Thread worker_threads[WORKER_COUNT];
-static int worker_client_fd[WORKER_COUNT];
-static volatile int worker_busy[WORKER_COUNT];
 static int listen_fd = -1;
 
+typedef enum {
+    CONN_FREE = 0,
+    CONN_READING,   // reactor 非阻塞读取中
+    CONN_QUEUED,    // 已收到完整请求，等待 worker
+    CONN_HANDLING,  // worker 处理中
+} ConnState;
+
+typedef struct {
+    int fd;
+    ConnState state;
+    int requests;    // 该连接已处理的请求数
+    u64 last_active; // 最近一次收到数据或完成响应的 tick
+    u64 accepted_at;   // 以下 tick 用于 /metrics 的分阶段耗时
+    u64 first_byte_at; // 当前请求首字节到达，0 表示尚未收到
+    u64 complete_at;   // 当前请求收齐入队
+    JobClass job_class;
+    HttpRequest req; // 增量解析状态与复用的接收缓冲区
+} HttpConnection;
+
+// 各优先级的并发与排队上限：截图类最多占用一个 worker，输入与读取总有 worker 可用
+static const struct {
+    int max_running;
+    int max_queued;
+    size_t heap_budget; // 入队时要求的空闲堆，0 表示不检查
+} job_limits[JOB_CLASS_COUNT] = {
+    [JOB_CLASS_INPUT]   = { WORKER_COUNT, MAX_CONNECTIONS, 0 },
+    [JOB_CLASS_READ]    = { WORKER_COUNT, MAX_CONNECTIONS, 0 },
+    [JOB_CLASS_CAPTURE] = { 1, 2, CAPTURE_HEAP_BUDGET },
+};
+
+// 连接表与按优先级划分的任务队列，由 conn_mutex 保护
+static HttpConnection connections[MAX_CONNECTIONS];
+static int job_queue[JOB_CLASS_COUNT][MAX_CONNECTIONS];
+static int job_head[JOB_CLASS_COUNT];
+static int job_count[JOB_CLASS_COUNT];
+static int job_running[JOB_CLASS_COUNT];
+static Mutex conn_mutex = 0;
+static CondVar job_cond = 0;
+
+// 请求缓冲区全部静态分配：MAX_CONNECTIONS * 2KB + REQUEST_LARGE_BUFFERS * MAX_REQUEST_SIZE
+SLAB_POOL_STORAGE(small_request_storage, REQUEST_SMALL_BUFFER, MAX_CONNECTIONS);
+SLAB_POOL_STORAGE(large_request_storage, MAX_REQUEST_SIZE, REQUEST_LARGE_BUFFERS);
+static SlabPool small_request_pool;
+static SlabPool large_request_pool;
+
+// worker -> reactor 唤醒用的 loopback 套接字对：[0] reactor 读端，[1] worker 写端
+static int wake_fds[2] = {-1, -1};
+
+static void set_nonblocking(int fd, bool nonblocking) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return;
+    fcntl(fd, F_SETFL, nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
 Result socket_init() {
     struct sockaddr_in addr;
     listen_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (listen_fd < 0) {
         return -1;
     }
-    
+
     int opt = 1;
     setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
+
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(MCP_PORT);
-    
+
     if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
         close(listen_fd);
         listen_fd = -1;
         return -1;
     }
-    
-    if (listen(listen_fd, 1) < 0) {
+
+    if (listen(listen_fd, MAX_CONNECTIONS) < 0) {
         close(listen_fd);
         listen_fd = -1;
         return -1;
     }
-    
+    set_nonblocking(listen_fd, true);
+
     srand((unsigned int)time(NULL));
     return 0;
 }
 
-// 解析 HTTP header，获取指定 key 的值
-char *get_header(char *req, char *key) {
-    static char val[128];
-    val[0] = 0;
-    char *p = strstr(req, key);
-    if (p) {
-        p += strlen(key);
-        while (*p == ' ' || *p == ':') ++p;
-        int i = 0;
-        while (*p && *p != '\r' && *p != '\n' && i < 127) val[i++] = *p++;
-        val[i] = 0;
-        return val;
+// 建立非阻塞的 loopback TCP 套接字对，用于唤醒阻塞在 poll() 上的线程：[0] 读端，[1] 写端
+Result loopback_socket_pair(int fds[2]) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (lfd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 1) < 0 ||
+        getsockname(lfd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        close(lfd);
+        return -2;
+    }
+    int wfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (wfd < 0 || connect(wfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        if (wfd >= 0) close(wfd);
+        close(lfd);
+        return -3;
+    }
+    int rfd = accept(lfd, NULL, NULL);
+    close(lfd);
+    if (rfd < 0) {
+        close(wfd);
+        return -4;
+    }
+    set_nonblocking(rfd, true);
+    set_nonblocking(wfd, true);
+    fds[0] = rfd;
+    fds[1] = wfd;
+    return 0;
+}
+
+static void wake_reactor() {
+    if (wake_fds[1] >= 0) send(wake_fds[1], "w", 1, 0); // 缓冲区满说明 reactor 已有待处理唤醒，忽略失败
+}
+
+static void drain_wake() {
+    char tmp[64];
+    while (recv(wake_fds[0], tmp, sizeof(tmp), 0) > 0) {}
+}
+
+static const char *status_text(int status) {
+    switch (status) {
+    case 400: return "400 Bad Request";
+    case 413: return "413 Payload Too Large";
+    case 431: return "431 Request Header Fields Too Large";
+    case 501: return "501 Not Implemented";
+    default:  return "503 Service Unavailable";
+    }
+}
+
+static void enqueue_connection(int idx, JobClass cls) {
+    connections[idx].state = CONN_QUEUED;
+    connections[idx].job_class = cls;
+    connections[idx].complete_at = svcGetSystemTick();
+    if (!connections[idx].first_byte_at) connections[idx].first_byte_at = connections[idx].complete_at;
+    job_queue[cls][(job_head[cls] + job_count[cls]) % MAX_CONNECTIONS] = idx;
+    ++job_count[cls];
+    condvarWakeOne(&job_cond);
+}
+
+// 取优先级最高且未达并发上限的类别的队首，没有可运行的任务返回 -1；调用时持有 conn_mutex
+static int next_job() {
+    for (int cls = 0; cls < JOB_CLASS_COUNT; ++cls) {
+        if (job_count[cls] == 0 || job_running[cls] >= job_limits[cls].max_running) continue;
+        int idx = job_queue[cls][job_head[cls]];
+        job_head[cls] = (job_head[cls] + 1) % MAX_CONNECTIONS;
+        --job_count[cls];
+        ++job_running[cls];
+        return idx;
     }
-    return NULL;
+    return -1;
+}
+
+static void release_connection(HttpConnection *conn, bool close_fd) {
+    if (close_fd && conn->fd >= 0) close(conn->fd);
+    http_request_free(&conn->req);
+    mutexLock(&conn_mutex);
+    conn->fd = -1;
+    conn->state = CONN_FREE;
+    mutexUnlock(&conn_mutex);
+}
+
+// 请求无法解析（过大、格式错误等）或无法调度：回复对应状态码并关闭连接。
+// 通常运行在 reactor 线程上，只尝试一次不阻塞的 send，发送缓冲区已满时对端只会看到连接关闭
+static void reject_request(HttpConnection *conn, MetricReject reason) {
+    int status = conn->req.error_status;
+    log_error("Rejecting request on fd=%d with status %d", conn->fd, status);
+    metrics_count_rejected(reason);
+    char response[128];
+    int n = snprintf(response, sizeof(response), "HTTP/1.1 %s\r\n%sContent-Length: 0\r\nConnection: close\r\n\r\n",
+                     status_text(status), status == 503 ? "Retry-After: 1\r\n" : "");
+    send(conn->fd, response, (size_t)n, MSG_DONTWAIT);
+    release_connection(conn, true);
+}
+
+// 已收齐的请求按优先级入队；对应类别排队已满或堆预算不足时回复 503。调用时不持有 conn_mutex
+static void admit_request(HttpConnection *conn) {
+    JobClass cls = mcp_classify_request(&conn->req);
+    bool admitted = false;
+    if (job_limits[cls].heap_budget && heap_available() < job_limits[cls].heap_budget) {
+        log_warning("Heap below budget for class %d request on fd=%d", cls, conn->fd);
+    } else {
+        mutexLock(&conn_mutex);
+        if (job_count[cls] < job_limits[cls].max_queued) {
+            enqueue_connection((int)(conn - connections), cls);
+            admitted = true;
+        }
+        mutexUnlock(&conn_mutex);
+    }
+    if (!admitted) {
+        conn->req.error_status = 503;
+        reject_request(conn, METRIC_REJECT_OVERLOADED);
+    }
+}
+
+// keep-alive：保留流水线中剩余的字节，把连接交还给 reactor
+static void recycle_connection(HttpConnection *conn) {
+    http_request_consume(&conn->req);
+    conn->requests++;
+    conn->last_active = svcGetSystemTick();
+    conn->first_byte_at = conn->req.len > 0 ? conn->last_active : 0; // 流水线中已有下一个请求的字节
+    HttpParseState st = http_request_parse(&conn->req);
+    if (st == HTTP_PARSE_ERROR) {
+        reject_request(conn, METRIC_REJECT_BAD_REQUEST);
+        return;
+    }
+    if (st == HTTP_PARSE_DONE) {
+        admit_request(conn);
+        return;
+    }
+    mutexLock(&conn_mutex);
+    conn->state = CONN_READING;
+    mutexUnlock(&conn_mutex);
+}
+
+// 任务处理完毕，释放所属类别的并发名额；被上限挡住的任务可能因此可以运行，唤醒全部 worker
+static void finish_job(JobClass cls) {
+    mutexLock(&conn_mutex);
+    --job_running[cls];
+    condvarWakeAll(&job_cond);
+    mutexUnlock(&conn_mutex);
 }
 
 void worker_func(void* arg) {
-    int idx = (int)(intptr_t)arg;
+    (void)arg;
     while (1) {
-        if (!worker_busy[idx]) {
-            svcSleepThread(1000000ULL); // 1ms
-            continue;
+        mutexLock(&conn_mutex);
+        int idx;
+        while ((idx = next_job()) < 0) {
+            condvarWait(&job_cond, &conn_mutex);
         }
-        int client_fd = worker_client_fd[idx];
-        char req[MAX_REQUEST_SIZE];
-        int n = recv(client_fd, req, sizeof(req)-1, 0);
-        if (n > 0) {
-            req[n] = '\0';
-            log_info("Received request: %s", req);
-            if (strncmp(req, "GET /mcp", 8) == 0) {
-                add_sse_connection(client_fd, get_header(req, "Mcp-Session-Id"), get_header(req, "Last-Event-ID"));
-                // send(client_fd, "HTTP/1.1 405 Method Not Allowed\r\nconnection: close\r\ncontent-length: 0\r\n\r\n", 78, 0);
-                // close(client_fd);
+        HttpConnection *conn = &connections[idx];
+        JobClass cls = conn->job_class;
+        conn->state = CONN_HANDLING;
+        mutexUnlock(&conn_mutex);
+
+        int client_fd = conn->fd;
+        HttpRequest *req = &conn->req;
+        // fd 保持非阻塞：http_send_iov 在发送缓冲区满时 poll 等待，超过 HTTP_SEND_TIMEOUT_MS 即放弃，
+        // 停止读取的客户端不会永久占住 worker
+        log_info("Received request: %s %s %s", req->method, req->path, req->body);
+        const char *session_id = http_request_header(req, "Mcp-Session-Id");
+        if (strcmp(req->method, "GET") == 0 && strcmp(req->path, "/mcp") == 0 && session_touch(session_id) == SESSION_OK) {
+            // SSE 连接的 fd 由 sse 模块接管，reactor 不再关闭
+            add_sse_connection(client_fd, session_id, http_request_header(req, "Last-Event-ID"));
+            finish_job(cls);
+            release_connection(conn, false);
+        } else if (strcmp(req->path, WS_PATH) == 0 && websocket_is_upgrade(req)) {
+            // 升级后的 fd 由 WebSocket 连接线程接管
+            websocket_accept(client_fd, req);
+            finish_job(cls);
+            release_connection(conn, false);
+        } else {
+            bool keep_alive = http_request_keep_alive(req) && conn->requests + 1 < KEEPALIVE_MAX_REQUESTS;
+            // keep-alive 连接上后续请求的等待时间是客户端空闲，不计入 first_byte
+            metrics_request_begin(conn->requests == 0 ? conn->first_byte_at - conn->accepted_at : METRICS_NO_SAMPLE,
+                                  conn->complete_at - conn->first_byte_at, svcGetSystemTick() - conn->complete_at);
+            request_arena_begin();
+            handle_http_request(req, client_fd, keep_alive);
+            request_arena_end();
+            metrics_request_end();
+            finish_job(cls);
+            if (keep_alive) {
+                recycle_connection(conn);
             } else {
-                handle_http_request(req, n, client_fd);
-                close(client_fd);
+                release_connection(conn, true);
             }
         }
         log_info("Processed request from client_fd: %d", client_fd);
-        worker_busy[idx] = 0; // 标记空闲
+        wake_reactor();
+    }
+}
+
+static void accept_clients() {
+    while (1) {
+        int idx = -1;
+        mutexLock(&conn_mutex);
+        for (int i = 0; i < MAX_CONNECTIONS; ++i) {
+            if (connections[i].state == CONN_FREE) {
+                idx = i;
+                break;
+            }
+        }
+        mutexUnlock(&conn_mutex);
+        if (idx < 0) return; // 连接表已满，留在 backlog 中等待空位
+
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_fd = accept(listen_fd, (struct sockaddr *)&client_addr, &client_len);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_error("Failed to accept client connection errno=%d", errno);
+                close(listen_fd);
+                listen_fd = -1; // 重置监听套接字
+            }
+            return;
+        }
+        set_nonblocking(client_fd, true);
+        log_info("Accepted client connection fd=%d slot=%d", client_fd, idx);
+        metrics_count_accepted();
+        mutexLock(&conn_mutex);
+        connections[idx].fd = client_fd;
+        connections[idx].requests = 0;
+        connections[idx].last_active = svcGetSystemTick();
+        connections[idx].accepted_at = connections[idx].last_active;
+        connections[idx].first_byte_at = 0;
+        connections[idx].state = CONN_READING;
+        mutexUnlock(&conn_mutex);
+    }
+}
+
+static void read_client(int idx) {
+    HttpConnection *conn = &connections[idx];
+    // 每次 recv 后只解析新到达的字节，收全一个请求即停止读取
+    while (http_request_parse(&conn->req) < HTTP_PARSE_DONE) {
+        size_t avail = 0;
+        char *dst = http_request_reserve(&conn->req, &avail);
+        if (!dst) break;
+        int n = recv(conn->fd, dst, avail, 0);
+        if (n > 0) {
+            http_request_commit(&conn->req, n);
+            conn->last_active = svcGetSystemTick();
+            if (!conn->first_byte_at) conn->first_byte_at = conn->last_active;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        // 对端关闭或出错
+        release_connection(conn, true);
+        return;
+    }
+    if (conn->req.state == HTTP_PARSE_DONE) {
+        admit_request(conn);
+    } else if (conn->req.error_status == 503) {
+        log_warning("Request buffer pool exhausted (%d large buffers in use) on fd=%d", REQUEST_LARGE_BUFFERS, conn->fd);
+        reject_request(conn, METRIC_REJECT_OVERLOADED);
+    } else {
+        reject_request(conn, METRIC_REJECT_BAD_REQUEST);
     }
 }
 
 void run(void* arg) {
+    slab_pool_init(&small_request_pool, small_request_storage, REQUEST_SMALL_BUFFER, MAX_CONNECTIONS);
+    slab_pool_init(&large_request_pool, large_request_storage, MAX_REQUEST_SIZE, REQUEST_LARGE_BUFFERS);
+    for (int i = 0; i < MAX_CONNECTIONS; ++i) {
+        connections[i].fd = -1;
+        connections[i].state = CONN_FREE;
+        http_request_init(&connections[i].req, &small_request_pool, &large_request_pool);
+    }
+    if (R_FAILED(loopback_socket_pair(wake_fds))) {
+        log_error("Failed to create reactor wake socket pair");
+        return;
+    }
     // 初始化 worker 线程
     for (int i = 0; i < WORKER_COUNT; ++i) {
-        worker_busy[i] = 0;
-        worker_client_fd[i] = -1;
         Result rs = threadCreate(&worker_threads[i], worker_func, (void*)(intptr_t)i, NULL, 0x10000, 49, -2);
         if (R_FAILED(rs)) {
             log_error("Failed to create worker thread %d (%x)", i, rs);
@@ -99,41 +393,86 @@ void run(void* arg) {
             return;
         }
     }
+    struct pollfd pfds[MAX_CONNECTIONS + 2];
+    int pfd_conn[MAX_CONNECTIONS + 2];
     while (1) {
         if (listen_fd < 0 && R_FAILED(socket_init())) {
             svcSleepThread(10000000ULL); // 10ms
             continue;
         }
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        int client_fd = accept(listen_fd, (struct sockaddr *)&client_addr, &client_len);
-        if (client_fd < 0) {
-            listen_fd = -1; // 重置监听套接字
-            log_error("Failed to accept client connection");
-            svcSleepThread(10000000ULL); // 10ms
-            continue;
+        int nfds = 0;
+        bool has_free = false;
+        int timeout_ms = -1;
+        u64 now = svcGetSystemTick();
+        u64 idle_ticks = armNsToTicks(KEEPALIVE_TIMEOUT_MS * 1000000ULL);
+        pfds[nfds].fd = wake_fds[0];
+        pfds[nfds].events = POLLIN;
+        pfd_conn[nfds++] = -1;
+        mutexLock(&conn_mutex);
+        for (int i = 0; i < MAX_CONNECTIONS; ++i) {
+            if (connections[i].state == CONN_FREE) {
+                has_free = true;
+            } else if (connections[i].state == CONN_READING) {
+                if (now - connections[i].last_active > idle_ticks) {
+                    // 空闲超时，关闭 keep-alive 连接
+                    close(connections[i].fd);
+                    http_request_free(&connections[i].req);
+                    connections[i].fd = -1;
+                    connections[i].state = CONN_FREE;
+                    has_free = true;
+                    continue;
+                }
+                timeout_ms = 1000; // 有空闲连接时每秒检查一次超时
+                pfds[nfds].fd = connections[i].fd;
+                pfds[nfds].events = POLLIN;
+                pfd_conn[nfds++] = i;
+            }
         }
-        log_info("Accepted client connection");
-        // 分配给空闲 worker
-        int assigned = 0;
-        for (int i = 0; i < WORKER_COUNT; ++i) {
-            if (!worker_busy[i]) {
-                worker_client_fd[i] = client_fd;
-                worker_busy[i] = 1;
-                assigned = 1;
-                break;
+        mutexUnlock(&conn_mutex);
+        // 连接表满时不再 accept，新连接留在 backlog 中而不是被直接关闭
+        if (has_free) {
+            pfds[nfds].fd = listen_fd;
+            pfds[nfds].events = POLLIN;
+            pfd_conn[nfds++] = -2;
+        }
+
+        int ready = poll(pfds, nfds, timeout_ms);
+        if (ready < 0) {
+            if (errno != EINTR) {
+                log_error("poll failed errno=%d", errno);
+                svcSleepThread(10000000ULL); // 10ms
             }
+            continue;
         }
-        if (!assigned) {
-            log_error("No available worker thread, rejecting client_fd: %d", client_fd);
-            close(client_fd);
+        for (int i = 0; i < nfds; ++i) {
+            if (!pfds[i].revents) continue;
+            if (pfd_conn[i] == -1) {
+                drain_wake();
+            } else if (pfd_conn[i] == -2) {
+                accept_clients();
+            } else {
+                read_client(pfd_conn[i]);
+            }
         }
     }
 }
 
 Result streamable_http_init() {
+    request_arena_init();
+    if (response_cache_init() != 0) {
+        log_warning("Some cached responses failed to build, will retry on demand");
+    }
+    Result rs = sse_init();
+    if (R_FAILED(rs)) {
+        log_error("Failed to init SSE pump (%x)", rs);
+        return rs;
+    }
+    if (R_FAILED(resources_init())) {
+        log_warning("Screen resource updates disabled");
+    }
     Thread listen_thread;
-    Result rs = threadCreate(&listen_thread, run, NULL, NULL, 0x1000, 49, -2);
+    // reactor 在栈上原地解析请求体以确定调度类别（JsonDoc 约 2.3 KB）
+    rs = threadCreate(&listen_thread, run, NULL, NULL, 0x4000, 49, -2);
     if (R_FAILED(rs)) {
         log_error("Failed to create listen thread for streamable_http (%x)", rs);
         return rs;
@@ -144,7 +483,7 @@ Result streamable_http_init() {
         return rs;
     }
     Thread notification_thread;
-    rs = threadCreate(&notification_thread, sse_heartbeat, NULL, NULL, 0x1000, 49, -2);
+    rs = threadCreate(&notification_thread, sse_heartbeat, NULL, NULL, 0x2000, 49, -2);
     if (R_FAILED(rs)) {
         log_error("Failed to create notification thread for streamable_http (%x)", rs);
         return rs;
@@ -155,4 +494,4 @@ Result streamable_http_init() {
         return rs;
     }
     return 0;
-}
\ No newline at end of file
+}
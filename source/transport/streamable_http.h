@@ -3,6 +3,8 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <string.h>
 #include "../third_party/cJSON.h"
 #include <stdlib.h>
@@ -12,9 +14,19 @@
 #include <errno.h>
 #include "../tools/controller.h"
 #include "../tools/cur_frame.h"
+#include "http_parser.h"
+#include "http_response.h"
+#include "response_cache.h"
+#include "session.h"
+#include "resources.h"
+#include "websocket.h"
+#include "../util/metrics.h"
+#include "../util/heap.h"
+#include "../util/arena.h"
 
 
 #define MCP_PORT 12345
+#define MCP_PROTOCOL_VERSION "2025-06-18"
 
 typedef struct {
     char *event; // 事件类型
@@ -22,9 +34,26 @@ typedef struct {
     char *id;    // 事件 ID
 } SSEvent;
 
-char *get_header(char *req, char *key);
-Result add_sse_connection(int client_fd, char *Mcp_Session_Id, char *Last_Event_ID);
-void handle_http_request(char *req, int req_len, int client_fd);
+Result add_sse_connection(int client_fd, const char *Mcp_Session_Id, const char *Last_Event_ID);
+// 请求调度优先级，数值越小越优先
+typedef enum {
+    JOB_CLASS_INPUT = 0, // 手柄输入注入
+    JOB_CLASS_READ,      // 廉价读取与会话管理
+    JOB_CLASS_CAPTURE,   // 截图、录制 dump 等长耗时请求
+    JOB_CLASS_COUNT,
+} JobClass;
 
+void handle_http_request(HttpRequest *req, int client_fd, bool keep_alive);
+// reactor 入队前调用：按路由、JSON-RPC 方法与工具标志确定优先级，batch 取其中最低的优先级
+JobClass mcp_classify_request(const HttpRequest *req);
+char *mcp_handle_message(const char *json, size_t len, const char *session_id, size_t *out_len);
+
+Result sse_init();
+void sse_close_session(int slot, const char *Mcp_Session_Id);
+int sse_active_connections();
+// 向指定会话的事件流推送一条事件：流已断开时进入重放环，从未建立事件流则丢弃
+void notify_session(const char *Mcp_Session_Id, SSEvent *ssevent);
+// SSE 发送线程：非阻塞地排空各连接的发送队列，并定时发送心跳
 void sse_heartbeat(void* arg);
+Result loopback_socket_pair(int fds[2]);
 Result streamable_http_init();
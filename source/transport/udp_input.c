@@ -0,0 +1,120 @@
+#include "streamable_http.h"
+#include "udp_input.h"
+
+#define UDP_INPUT_DATAGRAM_SIZE (UDP_INPUT_HEADER_SIZE + CONTROLLER_PACKET_SIZE)
+#define UDP_INPUT_DRIFT_PACKETS 64 // 每接受这么多包把延迟基准放宽 1ms，跟随两端时钟漂移
+
+UdpInputVerdict udp_input_check(UdpInputStream *stream, u32 seq, u32 target_tick, u32 now_ms, bool stream_start) {
+    s32 delay = (s32)(now_ms - target_tick);
+    if (stream_start || !stream->started) {
+        stream->started = true;
+        stream->last_seq = seq;
+        stream->best_delay = delay;
+        stream->accepted = 1;
+        return UDP_INPUT_ACCEPT;
+    }
+    // 序号按回绕算术比较
+    if ((s32)(seq - stream->last_seq) <= 0) return UDP_INPUT_REORDERED;
+    if (delay < stream->best_delay) {
+        stream->best_delay = delay;
+    } else if (delay - stream->best_delay > UDP_INPUT_MAX_LATENESS_MS) {
+        // 过期包也推进序号：比它更早发出的包只会更晚
+        stream->last_seq = seq;
+        return UDP_INPUT_STALE;
+    }
+    stream->last_seq = seq;
+    if (++stream->accepted % UDP_INPUT_DRIFT_PACKETS == 0) stream->best_delay++;
+    return UDP_INPUT_ACCEPT;
+}
+
+#if UDP_INPUT_ENABLED
+static int udp_fd = -1;
+static Thread udp_thread;
+
+static u32 now_ms() {
+    return (u32)(armTicksToNs(svcGetSystemTick()) / 1000000ULL);
+}
+
+static void udp_input_thread(void *arg) {
+    UdpInputStream stream = {0};
+    struct sockaddr_in source = {0};
+    u32 dropped_reordered = 0, dropped_stale = 0;
+    u8 buf[UDP_INPUT_DATAGRAM_SIZE + 1]; // 多 1 字节用于识别超长数据报
+
+    while (1) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(udp_fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+        if (n < 0) {
+            if (errno != EINTR) {
+                log_error("UDP input recvfrom failed errno=%d", errno);
+                svcSleepThread(100000000ULL); // 100ms
+            }
+            continue;
+        }
+        if (n != UDP_INPUT_DATAGRAM_SIZE) continue;
+
+        u32 seq, target_tick;
+        memcpy(&seq, buf, 4);
+        memcpy(&target_tick, buf + 4, 4);
+        const u8 *packet = buf + UDP_INPUT_HEADER_SIZE;
+        bool stream_start = (packet[1] & UDP_INPUT_FLAG_STREAM_START) != 0;
+        if (source.sin_addr.s_addr != from.sin_addr.s_addr || source.sin_port != from.sin_port) {
+            // 换了发送端，按新流处理
+            if (stream.started) log_info("UDP input source changed to %s:%d", inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+            source = from;
+            stream_start = true;
+        }
+
+        UdpInputVerdict verdict = udp_input_check(&stream, seq, target_tick, now_ms(), stream_start);
+        if (verdict != UDP_INPUT_ACCEPT) {
+            u32 dropped = verdict == UDP_INPUT_STALE ? ++dropped_stale : ++dropped_reordered;
+            if ((dropped & (dropped - 1)) == 0) {
+                // 只在 2 的幂次时记录，避免日志刷屏
+                log_warning("UDP input dropped %lu %s packets", (unsigned long)dropped, verdict == UDP_INPUT_STALE ? "stale" : "reordered");
+            }
+            continue;
+        }
+        HiddbgHdlsState state;
+        bool long_press = false;
+        if (controller_decode_packet(packet, CONTROLLER_PACKET_SIZE, &state, &long_press) == 0) {
+            controller_apply_state(&state, long_press);
+        }
+    }
+}
+
+Result udp_input_init() {
+    udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_fd < 0) {
+        log_error("Failed to create UDP input socket errno=%d", errno);
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(UDP_INPUT_PORT);
+    if (bind(udp_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        log_error("Failed to bind UDP input port %d errno=%d", UDP_INPUT_PORT, errno);
+        close(udp_fd);
+        udp_fd = -1;
+        return -2;
+    }
+    Result rs = threadCreate(&udp_thread, udp_input_thread, NULL, NULL, 0x2000, 44, -2); // 优先级高于 HTTP 线程
+    if (R_FAILED(rs)) {
+        log_error("Failed to create UDP input thread (%x)", rs);
+        return rs;
+    }
+    rs = threadStart(&udp_thread);
+    if (R_FAILED(rs)) {
+        log_error("Failed to start UDP input thread (%x)", rs);
+        return rs;
+    }
+    log_info("UDP input listening on port %d", UDP_INPUT_PORT);
+    return 0;
+}
+#else
+Result udp_input_init() {
+    return 0;
+}
+#endif
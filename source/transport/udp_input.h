@@ -0,0 +1,34 @@
+// UDP 手柄输入通道：定长数据报，丢弃乱序与过期的包，避免 TCP 队头阻塞导致摇杆卡顿
+#pragma once
+#include <switch.h>
+#include <stdbool.h>
+
+#ifndef UDP_INPUT_ENABLED
+#define UDP_INPUT_ENABLED 1 // 可通过 DEFINES=-DUDP_INPUT_ENABLED=0 关闭
+#endif
+#define UDP_INPUT_PORT 12346
+#define UDP_INPUT_MAX_LATENESS_MS 50 // 比观测到的最短路径延迟晚到超过该值的包视为过期
+
+// 数据报格式（小端，共 UDP_INPUT_DATAGRAM_SIZE 字节）：
+// u32 seq（单调递增，允许回绕）, u32 target_tick（发送端毫秒时间戳）, 之后为 CONTROLLER_PACKET_SIZE 字节的手柄状态。
+// 手柄状态 flags 的 bit1 表示新流开始，接收端据此重置序号与延迟基准（客户端重启时使用）。
+#define UDP_INPUT_HEADER_SIZE 8
+#define UDP_INPUT_FLAG_STREAM_START (1 << 1)
+
+typedef enum {
+    UDP_INPUT_ACCEPT = 0,
+    UDP_INPUT_REORDERED, // 序号不大于已应用的包
+    UDP_INPUT_STALE,     // 到达过晚
+} UdpInputVerdict;
+
+typedef struct {
+    bool started;
+    u32 last_seq;
+    s32 best_delay; // 观测到的最小 (本地时间 - target_tick)，包含两端时钟差
+    u32 accepted;
+} UdpInputStream;
+
+// 纯函数形式的排序/过期规则，now_ms 为本地毫秒时间
+UdpInputVerdict udp_input_check(UdpInputStream *stream, u32 seq, u32 target_tick, u32 now_ms, bool stream_start);
+
+Result udp_input_init();
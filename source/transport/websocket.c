@@ -0,0 +1,376 @@
+#include "streamable_http.h"
+#include "websocket.h"
+#include "../third_party/stb_base64.h"
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_THREAD_STACK_SIZE 0x8000
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT   0x1
+#define WS_OP_BINARY 0x2
+#define WS_OP_CLOSE  0x8
+#define WS_OP_PING   0x9
+#define WS_OP_PONG   0xA
+
+#define WS_CLOSE_NORMAL         1000
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+#define WS_CLOSE_POLICY         1008
+#define WS_CLOSE_TOO_BIG        1009
+
+typedef struct {
+    bool used;      // 槽位占用中（线程运行中或等待回收）
+    bool finished;  // 线程已退出，等待 threadClose
+    int fd;
+    Thread thread;
+    char session_id[SESSION_ID_SIZE]; // 每个 WebSocket 连接对应一个会话，连接关闭时结束
+    u8 *message;    // 分片合并缓冲区，每条消息处理完即释放
+    size_t message_len;
+    u8 message_op;  // 0 表示没有未完成的分片消息
+    u8 *pending;    // 与握手请求同批到达的字节（客户端的首帧），读帧时先于 socket 消费，用完即释放
+    size_t pending_len;
+    size_t pending_pos;
+} WsConnection;
+
+// 槽位分配与回收由 ws_mutex 保护，连接内部状态只由各自线程访问
+static WsConnection ws_connections[MAX_WS_CONNECTIONS];
+static Mutex ws_mutex = 0;
+
+bool websocket_is_upgrade(const HttpRequest *req) {
+    return strcmp(req->method, "GET") == 0 &&
+        http_header_has_token(http_request_header(req, "Upgrade"), "websocket") &&
+        http_header_has_token(http_request_header(req, "Connection"), "upgrade");
+}
+
+static void free_pending(WsConnection *conn) {
+    heap_free(conn->pending);
+    conn->pending = NULL;
+    conn->pending_len = conn->pending_pos = 0;
+}
+
+// 在 deadline（tick）之前收齐 len 字节；对端停在半个帧上时超时返回，不会永久占住连接线程
+static bool recv_exact(WsConnection *conn, void *buf, size_t len, u64 deadline) {
+    int fd = conn->fd;
+    u8 *p = (u8 *)buf;
+    if (conn->pending) {
+        size_t n = conn->pending_len - conn->pending_pos;
+        if (n > len) n = len;
+        memcpy(p, conn->pending + conn->pending_pos, n);
+        conn->pending_pos += n;
+        if (conn->pending_pos == conn->pending_len) free_pending(conn);
+        p += n;
+        len -= n;
+    }
+    while (len > 0) {
+        u64 now = svcGetSystemTick();
+        if (now >= deadline) {
+            log_warning("WebSocket fd=%d stalled mid-frame", fd);
+            return false;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, (int)(armTicksToNs(deadline - now) / 1000000ULL) + 1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) return false;
+        if (ready == 0) continue;
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 服务端发出的帧不加掩码，且总是 FIN
+static bool send_frame(int fd, u8 opcode, const void *payload, size_t len) {
+    u8 header[10];
+    size_t header_len = 2;
+    header[0] = 0x80 | opcode;
+    if (len < 126) {
+        header[1] = (u8)len;
+    } else if (len <= 0xFFFF) {
+        header[1] = 126;
+        header[2] = (u8)(len >> 8);
+        header[3] = (u8)len;
+        header_len = 4;
+    } else {
+        header[1] = 127;
+        for (int i = 0; i < 8; ++i) header[2 + i] = (u8)((u64)len >> (56 - 8 * i));
+        header_len = 10;
+    }
+    struct iovec iov[2] = {
+        { header, header_len },
+        { (void *)payload, len },
+    };
+    return http_send_iov(fd, iov, len ? 2 : 1) == 0;
+}
+
+static void send_close(int fd, u16 code) {
+    u8 payload[2] = { (u8)(code >> 8), (u8)code };
+    send_frame(fd, WS_OP_CLOSE, payload, sizeof(payload));
+}
+
+static void unmask(u8 *data, size_t len, const u8 mask[4]) {
+    for (size_t i = 0; i < len; ++i) data[i] ^= mask[i & 3];
+}
+
+static void reset_message(WsConnection *conn) {
+    heap_free(conn->message);
+    conn->message = NULL;
+    conn->message_len = 0;
+    conn->message_op = 0;
+}
+
+// 处理一条完整消息；返回 false 表示应关闭连接
+static bool dispatch_message(WsConnection *conn) {
+    if (conn->message_op == WS_OP_BINARY) {
+        // 二进制帧：手柄状态，不经过 JSON-RPC，也没有响应
+        HiddbgHdlsState state;
+        bool long_press = false;
+        if (controller_decode_packet(conn->message, conn->message_len, &state, &long_press) != 0) {
+            log_warning("Ignoring malformed controller packet (%zu bytes) on ws fd=%d", conn->message_len, conn->fd);
+            return true;
+        }
+        controller_apply_state(&state, long_press);
+        return true;
+    }
+    if (session_begin_request(conn->session_id) != SESSION_OK) {
+        log_warning("Session %s of ws fd=%d has ended", conn->session_id, conn->fd);
+        send_close(conn->fd, WS_CLOSE_POLICY);
+        return false;
+    }
+    size_t out_len = 0;
+    request_arena_begin();
+    char *out = mcp_handle_message((const char *)conn->message, conn->message_len, conn->session_id, &out_len);
+    session_end_request(conn->session_id);
+    bool ok = !out || send_frame(conn->fd, WS_OP_TEXT, out, out_len);
+    cJSON_free(out);
+    request_arena_end();
+    return ok;
+}
+
+// 控制帧（close/ping/pong）可插在分片消息之间，长度不超过 125
+static bool handle_control(WsConnection *conn, u8 opcode, const u8 *payload, size_t len) {
+    switch (opcode) {
+    case WS_OP_PING:
+        return send_frame(conn->fd, WS_OP_PONG, payload, len);
+    case WS_OP_PONG:
+        return true;
+    case WS_OP_CLOSE:
+        send_frame(conn->fd, WS_OP_CLOSE, payload, len >= 2 ? 2 : 0);
+        return false;
+    default:
+        send_close(conn->fd, WS_CLOSE_PROTOCOL_ERROR);
+        return false;
+    }
+}
+
+// 读取并处理一帧；返回 false 表示应关闭连接
+static bool read_frame(WsConnection *conn) {
+    u8 header[2];
+    u64 deadline = svcGetSystemTick() + armNsToTicks(WS_FRAME_TIMEOUT_MS * 1000000ULL);
+    if (!recv_exact(conn, header, 2, deadline)) return false;
+    bool fin = (header[0] & 0x80) != 0;
+    u8 opcode = header[0] & 0x0F;
+    u64 len = header[1] & 0x7F;
+    if (!(header[1] & 0x80) || (header[0] & 0x70)) {
+        // 客户端帧必须带掩码，且未协商任何扩展
+        send_close(conn->fd, WS_CLOSE_PROTOCOL_ERROR);
+        return false;
+    }
+    if (len == 126) {
+        u8 ext[2];
+        if (!recv_exact(conn, ext, 2, deadline)) return false;
+        len = ((u64)ext[0] << 8) | ext[1];
+    } else if (len == 127) {
+        u8 ext[8];
+        if (!recv_exact(conn, ext, 8, deadline)) return false;
+        len = 0;
+        for (int i = 0; i < 8; ++i) len = (len << 8) | ext[i];
+    }
+    u8 mask[4];
+    if (!recv_exact(conn, mask, 4, deadline)) return false;
+
+    if (opcode & 0x8) {
+        u8 payload[125];
+        if (!fin || len > sizeof(payload)) {
+            send_close(conn->fd, WS_CLOSE_PROTOCOL_ERROR);
+            return false;
+        }
+        if (!recv_exact(conn, payload, len, deadline)) return false;
+        unmask(payload, len, mask);
+        return handle_control(conn, opcode, payload, len);
+    }
+
+    if ((opcode == WS_OP_CONTINUATION) != (conn->message_op != 0) ||
+        (opcode != WS_OP_CONTINUATION && opcode != WS_OP_TEXT && opcode != WS_OP_BINARY)) {
+        send_close(conn->fd, WS_CLOSE_PROTOCOL_ERROR);
+        return false;
+    }
+    if (len > WS_MAX_MESSAGE - conn->message_len) {
+        log_warning("WebSocket message too large on fd=%d", conn->fd);
+        send_close(conn->fd, WS_CLOSE_TOO_BIG);
+        return false;
+    }
+    if (opcode != WS_OP_CONTINUATION) conn->message_op = opcode;
+    if (len > 0) {
+        u8 *buf = (u8 *)heap_realloc(HEAP_TAG_HTTP, conn->message, conn->message_len + len);
+        if (!buf) {
+            log_error("Failed to alloc WebSocket message buffer");
+            send_close(conn->fd, WS_CLOSE_TOO_BIG);
+            return false;
+        }
+        conn->message = buf;
+        if (!recv_exact(conn, conn->message + conn->message_len, len, deadline)) return false;
+        unmask(conn->message + conn->message_len, len, mask);
+        conn->message_len += len;
+    }
+    if (!fin) return true;
+    bool ok = dispatch_message(conn);
+    reset_message(conn);
+    return ok;
+}
+
+static void ws_thread(void *arg) {
+    WsConnection *conn = (WsConnection *)arg;
+    bool ping_sent = false;
+    while (1) {
+        struct pollfd pfd = { .fd = conn->fd, .events = POLLIN };
+        int ready = conn->pending ? 1 : poll(&pfd, 1, WS_PING_INTERVAL_MS);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ready == 0) {
+            if (ping_sent) {
+                log_info("WebSocket fd=%d timed out", conn->fd);
+                break;
+            }
+            if (!send_frame(conn->fd, WS_OP_PING, NULL, 0)) break;
+            ping_sent = true;
+            continue;
+        }
+        ping_sent = false;
+        session_touch(conn->session_id);
+        if (!read_frame(conn)) break;
+    }
+    log_info("WebSocket fd=%d closed", conn->fd);
+    reset_message(conn);
+    free_pending(conn);
+    close(conn->fd);
+    session_remove(conn->session_id);
+    mutexLock(&ws_mutex);
+    conn->finished = true;
+    mutexUnlock(&ws_mutex);
+}
+
+// 回收已退出的连接线程，返回一个空闲槽位
+static WsConnection *acquire_slot() {
+    WsConnection *slot = NULL;
+    mutexLock(&ws_mutex);
+    for (int i = 0; i < MAX_WS_CONNECTIONS; ++i) {
+        WsConnection *conn = &ws_connections[i];
+        if (conn->used && conn->finished) {
+            threadWaitForExit(&conn->thread);
+            threadClose(&conn->thread);
+            *conn = (WsConnection){0};
+        }
+        if (!conn->used && !slot) slot = conn;
+    }
+    if (slot) slot->used = true;
+    mutexUnlock(&ws_mutex);
+    return slot;
+}
+
+static void release_slot(WsConnection *conn) {
+    free_pending(conn);
+    mutexLock(&ws_mutex);
+    *conn = (WsConnection){0};
+    mutexUnlock(&ws_mutex);
+}
+
+static void reject(int client_fd, const char *status, const char *extra_headers) {
+    http_write_response(client_fd, status, NULL, extra_headers, NULL, 0, false);
+    close(client_fd);
+}
+
+Result websocket_accept(int client_fd, const HttpRequest *req) {
+    const char *key = http_request_header(req, "Sec-WebSocket-Key");
+    const char *version = http_request_header(req, "Sec-WebSocket-Version");
+    if (!key || strlen(key) > 64 || !version || strcmp(version, "13") != 0) {
+        log_error("Invalid WebSocket handshake on fd=%d", client_fd);
+        reject(client_fd, "400 Bad Request", "Sec-WebSocket-Version: 13\r\n");
+        return -1;
+    }
+    WsConnection *conn = acquire_slot();
+    if (!conn) {
+        log_error("Max WebSocket connections reached");
+        metrics_count_rejected(METRIC_REJECT_WS_FULL);
+        reject(client_fd, "503 Service Unavailable", NULL);
+        return -2;
+    }
+    // 会话随连接存在：两条消息之间 pending 为 0，不固定的话会被淘汰或过期
+    if (session_create(NULL, true, conn->session_id) != SESSION_OK) {
+        release_slot(conn);
+        reject(client_fd, "503 Service Unavailable", NULL);
+        return -3;
+    }
+    // 客户端可能紧跟握手请求发出首帧，这些字节已被 reactor 读进请求缓冲区；其首字节被解析器改成 NUL，原值在 saved_tail
+    size_t extra = req->len - req->request_len;
+    if (extra > 0) {
+        conn->pending = (u8 *)heap_alloc(HEAP_TAG_HTTP, extra);
+        if (!conn->pending) {
+            log_error("Failed to alloc %zu pipelined WebSocket bytes", extra);
+            session_remove(conn->session_id);
+            release_slot(conn);
+            reject(client_fd, "503 Service Unavailable", NULL);
+            return -3;
+        }
+        conn->pending[0] = (u8)req->saved_tail;
+        memcpy(conn->pending + 1, req->buf + req->request_len + 1, extra - 1);
+        conn->pending_len = extra;
+    }
+    // reactor 交来的 fd 本就是非阻塞的，这里再确认一次：发送经 http_send_iov 的超时约束，停止读取的对端不会卡住连接线程
+    int flags = fcntl(client_fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
+
+    char concat[64 + sizeof(WS_GUID)];
+    int concat_len = snprintf(concat, sizeof(concat), "%s%s", key, WS_GUID);
+    u8 digest[SHA1_HASH_SIZE];
+    sha1CalculateHash(digest, concat, concat_len);
+    char accept[32];
+    stb_base64_encode(digest, SHA1_HASH_SIZE, accept);
+
+    char response[256];
+    int response_len = snprintf(response, sizeof(response),
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: %s\r\n"
+        "Mcp-Session-Id: %s\r\n"
+        "\r\n", accept, conn->session_id);
+    struct iovec iov = { response, (size_t)response_len };
+    if (http_send_iov(client_fd, &iov, 1) != 0) {
+        log_error("Failed to send WebSocket handshake fd=%d errno=%d", client_fd, errno);
+        session_remove(conn->session_id);
+        release_slot(conn);
+        close(client_fd);
+        return -4;
+    }
+
+    conn->fd = client_fd;
+    Result rs = threadCreate(&conn->thread, ws_thread, conn, NULL, WS_THREAD_STACK_SIZE, 49, -2);
+    if (R_SUCCEEDED(rs)) {
+        rs = threadStart(&conn->thread);
+        if (R_FAILED(rs)) threadClose(&conn->thread);
+    }
+    if (R_FAILED(rs)) {
+        log_error("Failed to start WebSocket thread (%x)", rs);
+        send_close(client_fd, WS_CLOSE_POLICY);
+        session_remove(conn->session_id);
+        release_slot(conn);
+        close(client_fd);
+        return rs;
+    }
+    log_info("WebSocket connection established fd=%d session=%s", client_fd, conn->session_id);
+    return 0;
+}
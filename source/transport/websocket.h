@@ -0,0 +1,15 @@
+// WebSocket 传输（RFC 6455）：GET /ws 升级后，文本帧承载 MCP JSON-RPC，二进制帧承载紧凑的手柄状态
+#pragma once
+#include <switch.h>
+#include <stdbool.h>
+#include "http_parser.h"
+
+#define WS_PATH "/ws"
+#define MAX_WS_CONNECTIONS 2
+#define WS_MAX_MESSAGE (64 * 1024)   // 单条消息（含分片合并后）上限
+#define WS_PING_INTERVAL_MS 30000    // 空闲超过该时间发送 ping，两个周期无数据则断开
+#define WS_FRAME_TIMEOUT_MS 10000    // 帧的首字节到达后，整个帧必须在该时间内收齐
+
+bool websocket_is_upgrade(const HttpRequest *req);
+// 完成握手并由独立线程接管 fd；失败时已回复错误并关闭 fd
+Result websocket_accept(int client_fd, const HttpRequest *req);
@@ -0,0 +1,125 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include "../third_party/cJSON.h"
+#include "heap.h"
+
+#define ARENA_ALIGN 8 // cJSON 只需要指针与 double 对齐
+
+struct RequestArena {
+    char *base;    // 只会从 NULL 变为非 NULL 一次
+    size_t used;
+    size_t last;   // 最近一次分配的偏移，realloc 可以原地扩展它
+    u64 fallbacks; // 本次请求的退回次数，结束时汇总
+    bool in_use;
+};
+
+// arenas[].in_use 与 stats 由 arena_mutex 保护
+static RequestArena arenas[REQUEST_ARENA_COUNT];
+static RequestArenaStats stats;
+static Mutex arena_mutex = 0;
+static __thread RequestArena *current = NULL;
+
+static void *arena_malloc(size_t size) {
+    RequestArena *arena = current;
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (arena && aligned <= REQUEST_ARENA_MAX_BLOCK && aligned <= REQUEST_ARENA_SIZE - arena->used) {
+        void *ptr = arena->base + arena->used;
+        arena->last = arena->used;
+        arena->used += aligned;
+        return ptr;
+    }
+    if (arena) arena->fallbacks++;
+    return heap_alloc(HEAP_TAG_CJSON, size);
+}
+
+// 检查全部 arena 而非只看当前线程：cJSON 数据可能在别的线程释放
+static RequestArena *owning_arena(const void *ptr) {
+    for (int i = 0; i < REQUEST_ARENA_COUNT; ++i) {
+        const char *base = __atomic_load_n(&arenas[i].base, __ATOMIC_ACQUIRE);
+        if (base && (const char *)ptr >= base && (const char *)ptr < base + REQUEST_ARENA_SIZE) return &arenas[i];
+    }
+    return NULL;
+}
+
+// arena 内的块在请求结束时统一回收，这里什么都不做
+static void arena_free(void *ptr) {
+    if (ptr && !owning_arena(ptr)) heap_free(ptr);
+}
+
+// cJSON 打印缓冲区按倍数增长：最近一次分配的块原地扩展，其余情况复制到新块
+static void *arena_realloc(void *ptr, size_t size) {
+    if (!ptr) return arena_malloc(size);
+    RequestArena *owner = owning_arena(ptr);
+    if (!owner) return heap_realloc(HEAP_TAG_CJSON, ptr, size);
+
+    size_t offset = (size_t)((char *)ptr - owner->base);
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (owner == current && offset == owner->last && aligned <= REQUEST_ARENA_SIZE - offset) {
+        owner->used = offset + aligned;
+        return ptr;
+    }
+    void *moved = arena_malloc(size);
+    if (!moved) return NULL;
+    // 不记录块大小：旧块不会超出已用区域的末尾
+    size_t old_max = (owner == current ? owner->used : REQUEST_ARENA_SIZE) - offset;
+    memcpy(moved, ptr, size < old_max ? size : old_max);
+    return moved;
+}
+
+void request_arena_init() {
+    cJSON_Hooks hooks = { .malloc_fn = arena_malloc, .free_fn = arena_free };
+    cJSON_InitHooksWithRealloc(&hooks, arena_realloc);
+}
+
+void request_arena_begin() {
+    RequestArena *arena = NULL;
+    mutexLock(&arena_mutex);
+    for (int i = 0; i < REQUEST_ARENA_COUNT; ++i) {
+        if (arenas[i].in_use) continue;
+        if (!arenas[i].base) {
+            char *base = heap_alloc(HEAP_TAG_CJSON, REQUEST_ARENA_SIZE);
+            if (!base) break;
+            __atomic_store_n(&arenas[i].base, base, __ATOMIC_RELEASE);
+        }
+        arena = &arenas[i];
+        arena->in_use = true;
+        break;
+    }
+    if (!arena) stats.unavailable++;
+    mutexUnlock(&arena_mutex);
+    if (!arena) return;
+    arena->used = 0;
+    arena->last = 0;
+    arena->fallbacks = 0;
+    current = arena;
+}
+
+void request_arena_end() {
+    RequestArena *arena = current;
+    if (!arena) return;
+    current = NULL;
+    mutexLock(&arena_mutex);
+    stats.requests++;
+    stats.fallback_allocs += arena->fallbacks;
+    if (arena->used > stats.peak_bytes) stats.peak_bytes = arena->used;
+    arena->used = 0;
+    arena->in_use = false;
+    mutexUnlock(&arena_mutex);
+}
+
+RequestArena *request_arena_suspend() {
+    RequestArena *arena = current;
+    current = NULL;
+    return arena;
+}
+
+void request_arena_resume(RequestArena *arena) {
+    current = arena;
+}
+
+void request_arena_stats(RequestArenaStats *out) {
+    mutexLock(&arena_mutex);
+    *out = stats;
+    mutexUnlock(&arena_mutex);
+}
@@ -0,0 +1,29 @@
+// 请求级 bump arena：通过 cJSON_InitHooks 接管 cJSON 的分配，请求结束时 O(1) 整体回收，减少 fake heap 中的碎片
+#pragma once
+#include <switch.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define REQUEST_ARENA_COUNT 4                // 可同时使用 arena 的线程数（worker 与 WebSocket 线程），不够时退回 malloc
+#define REQUEST_ARENA_SIZE (16 * 1024)       // 首次使用时分配，之后常驻
+#define REQUEST_ARENA_MAX_BLOCK (4 * 1024)   // 更大的块（截图 base64、recorder dump 等）直接 malloc
+
+typedef struct RequestArena RequestArena;
+
+typedef struct {
+    size_t peak_bytes;    // 单个请求占用 arena 的峰值
+    u64 requests;         // 使用过 arena 的请求数
+    u64 fallback_allocs;  // 超大或 arena 已满而退回 malloc 的分配次数
+    u64 unavailable;      // 没有空闲 arena 而整体退回 malloc 的请求数
+} RequestArenaStats;
+
+// 安装 cJSON hooks，在启动 worker 等线程之前调用
+void request_arena_init();
+// 为当前线程绑定一个 arena，之后该线程的 cJSON 分配都来自它；不支持嵌套
+void request_arena_begin();
+// 整体回收当前线程的 arena。期间 cJSON 分配的内存（含 cJSON_Print 的结果）此后不能再使用
+void request_arena_end();
+// 构建需要跨请求保存的 cJSON 数据（如响应缓存）时暂时解绑，返回值交给 resume
+RequestArena *request_arena_suspend();
+void request_arena_resume(RequestArena *arena);
+void request_arena_stats(RequestArenaStats *out);
@@ -0,0 +1,125 @@
+#include "heap.h"
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "log.h"
+
+extern void *fake_heap_start;
+extern void *fake_heap_end;
+
+typedef struct {
+    size_t size;
+    HeapTag tag;
+} __attribute__((aligned(16))) HeapHeader; // 保持 malloc 返回值的 16 字节对齐
+
+static const char *const tag_names[HEAP_TAG_COUNT] = {
+    [HEAP_TAG_CJSON]     = "cjson",
+    [HEAP_TAG_CUR_FRAME] = "cur_frame",
+    [HEAP_TAG_RECORDER]  = "recorder",
+    [HEAP_TAG_SSE]       = "sse",
+    [HEAP_TAG_HTTP]      = "http",
+};
+
+// tag_stats 由 heap_mutex 保护
+static HeapTagStats tag_stats[HEAP_TAG_COUNT];
+static Mutex heap_mutex = 0;
+
+size_t heap_available() {
+    struct mallinfo mi = mallinfo();
+    char *brk = (char *)sbrk(0);
+    size_t untouched = 0;
+    if (brk != (char *)-1 && (char *)fake_heap_end > brk) untouched = (size_t)((char *)fake_heap_end - brk);
+    return untouched + (size_t)mi.fordblks;
+}
+
+size_t heap_largest_free() {
+    struct mallinfo mi = mallinfo();
+    char *brk = (char *)sbrk(0);
+    size_t untouched = 0;
+    if (brk != (char *)-1 && (char *)fake_heap_end > brk) untouched = (size_t)((char *)fake_heap_end - brk);
+    return untouched + (size_t)mi.keepcost;
+}
+
+size_t heap_size() {
+    return (size_t)((char *)fake_heap_end - (char *)fake_heap_start);
+}
+
+// 记录一次成功的分配：fresh 为新块，否则是把 old_size 字节的块 realloc 为 size
+static void account_alloc(HeapTag tag, bool fresh, size_t old_size, size_t size) {
+    mutexLock(&heap_mutex);
+    HeapTagStats *s = &tag_stats[tag];
+    s->live_bytes = s->live_bytes - old_size + size;
+    if (s->live_bytes > s->peak_bytes) s->peak_bytes = s->live_bytes;
+    if (size > s->largest) s->largest = size;
+    if (fresh) s->live_blocks++;
+    s->allocs++;
+    mutexUnlock(&heap_mutex);
+}
+
+static void account_failure(HeapTag tag, size_t size) {
+    mutexLock(&heap_mutex);
+    tag_stats[tag].failures++;
+    size_t live = tag_stats[tag].live_bytes;
+    mutexUnlock(&heap_mutex);
+    log_error("[heap] %s: failed to allocate %zu bytes (%zu live, %zu available, %zu contiguous)",
+              tag_names[tag], size, live, heap_available(), heap_largest_free());
+}
+
+void *heap_alloc(HeapTag tag, size_t size) {
+    HeapHeader *h = size <= SIZE_MAX - sizeof(HeapHeader) ? (HeapHeader *)malloc(sizeof(HeapHeader) + size) : NULL;
+    if (!h) {
+        account_failure(tag, size);
+        return NULL;
+    }
+    h->size = size;
+    h->tag = tag;
+    account_alloc(tag, true, 0, size);
+    return h + 1;
+}
+
+void *heap_realloc(HeapTag tag, void *ptr, size_t size) {
+    if (!ptr) return heap_alloc(tag, size);
+    HeapHeader *h = (HeapHeader *)ptr - 1;
+    HeapTag owner = h->tag;
+    size_t old_size = h->size;
+    HeapHeader *n = size <= SIZE_MAX - sizeof(HeapHeader) ? (HeapHeader *)realloc(h, sizeof(HeapHeader) + size) : NULL;
+    if (!n) {
+        account_failure(owner, size);
+        return NULL;
+    }
+    n->size = size;
+    account_alloc(owner, false, old_size, size);
+    return n + 1;
+}
+
+void heap_free(void *ptr) {
+    if (!ptr) return;
+    HeapHeader *h = (HeapHeader *)ptr - 1;
+    mutexLock(&heap_mutex);
+    tag_stats[h->tag].live_bytes -= h->size;
+    tag_stats[h->tag].live_blocks--;
+    mutexUnlock(&heap_mutex);
+    free(h);
+}
+
+const char *heap_tag_name(HeapTag tag) {
+    return tag >= 0 && tag < HEAP_TAG_COUNT ? tag_names[tag] : "unknown";
+}
+
+void heap_tag_stats(HeapTag tag, HeapTagStats *out) {
+    mutexLock(&heap_mutex);
+    *out = tag_stats[tag];
+    mutexUnlock(&heap_mutex);
+}
+
+void heap_log_summary(const char *reason) {
+    log_info("[heap] %s: size %zu, available %zu, contiguous %zu", reason, heap_size(), heap_available(), heap_largest_free());
+    for (int i = 0; i < HEAP_TAG_COUNT; ++i) {
+        HeapTagStats s;
+        heap_tag_stats((HeapTag)i, &s);
+        log_info("[heap]   %-9s live %zu (%llu blocks), peak %zu, largest %zu, allocs %llu, failures %llu",
+                 tag_names[i], s.live_bytes, (unsigned long long)s.live_blocks, s.peak_bytes, s.largest,
+                 (unsigned long long)s.allocs, (unsigned long long)s.failures);
+    }
+}
@@ -0,0 +1,39 @@
+// 堆用量估算：newlib 堆位于 main.c 的 fake heap 中，svcGetInfo 看不到
+#pragma once
+#include <switch.h>
+#include <stddef.h>
+
+// 按子系统记账的分配：每块前有 16 字节的头记录大小与 tag，释放时不需要再给出 tag
+typedef enum {
+    HEAP_TAG_CJSON = 0, // cJSON hooks：arena 本身与退回 malloc 的分配
+    HEAP_TAG_CUR_FRAME, // 截图的 base64 字符串（挂在 cJSON 树上，由 cJSON_Delete 释放）
+    HEAP_TAG_RECORDER,  // 手柄录制的事件数组
+    HEAP_TAG_SSE,       // SSE 消息与会话 id
+    HEAP_TAG_HTTP,      // 压缩缓冲、WebSocket 消息、/metrics 文本、响应缓存
+    HEAP_TAG_COUNT,
+} HeapTag;
+
+typedef struct {
+    size_t live_bytes;  // 当前占用，不含分配头
+    size_t peak_bytes;  // live_bytes 的历史最大值
+    size_t largest;     // 单次分配的最大字节数
+    u64 live_blocks;
+    u64 allocs;         // 累计分配次数（含 realloc）
+    u64 failures;
+} HeapTagStats;
+
+// 估算仍可分配的字节数：未向 sbrk 申请的部分加上 malloc 空闲块（可能有碎片）
+size_t heap_available();
+// 堆顶连续空闲（未 sbrk 的部分加上顶部空闲块），是最大空闲块的下界：不超过它的分配一定能成功
+size_t heap_largest_free();
+size_t heap_size();
+
+// 与 malloc/realloc/free 语义相同；realloc 的 ptr 非 NULL 时沿用原来的 tag
+void *heap_alloc(HeapTag tag, size_t size);
+void *heap_realloc(HeapTag tag, void *ptr, size_t size);
+void heap_free(void *ptr);
+
+const char *heap_tag_name(HeapTag tag);
+void heap_tag_stats(HeapTag tag, HeapTagStats *out);
+// 每个 tag 输出一行用量到日志
+void heap_log_summary(const char *reason);
@@ -0,0 +1,379 @@
+#include "json_doc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_DOC_NONE 0xFFFF
+#define JSON_DOC_NUMBER_MAX 64 // 更长的数字文本按非法处理
+
+typedef struct {
+    JsonDoc *doc;
+    const char *p;
+    const char *end;
+    int depth;
+} Scanner;
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 读取 \u 之后的 4 位十六进制数，p 指向第一位；调用方保证有 4 个字节
+static int read_hex4(const char *p) {
+    int value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int digit = hex_value(p[i]);
+        if (digit < 0) return -1;
+        value = (value << 4) | digit;
+    }
+    return value;
+}
+
+// 解码一个字符（转义序列或原样字节）到 out，返回写入的字节数；字符串已在扫描时校验过
+static int decode_char(const char **pp, char out[4]) {
+    const char *p = *pp;
+    if (*p != '\\') {
+        out[0] = *p;
+        *pp = p + 1;
+        return 1;
+    }
+    char c = p[1];
+    *pp = p + 2;
+    switch (c) {
+    case 'b': out[0] = '\b'; return 1;
+    case 'f': out[0] = '\f'; return 1;
+    case 'n': out[0] = '\n'; return 1;
+    case 'r': out[0] = '\r'; return 1;
+    case 't': out[0] = '\t'; return 1;
+    case 'u': break;
+    default:  out[0] = c; return 1; // " \ /
+    }
+    unsigned code = (unsigned)read_hex4(p + 2);
+    *pp = p + 6;
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        // UTF-16 代理对，低位部分紧跟其后
+        unsigned low = (unsigned)read_hex4(p + 8);
+        code = 0x10000 + (((code & 0x3FF) << 10) | (low & 0x3FF));
+        *pp = p + 12;
+    }
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+// FNV-1a，按解码后的字节计算，使转义写法的 key 也能查到
+static uint32_t hash_bytes(uint32_t h, const char *data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t slot_of(uint32_t key_hash, int object) {
+    return (key_hash ^ ((uint32_t)object * 0x9E3779B1u)) & (JSON_DOC_INDEX_SIZE - 1);
+}
+
+static uint32_t hash_token(const JsonDoc *doc, const JsonDocToken *tok) {
+    const char *p = doc->src + tok->start;
+    if (!tok->escaped) return hash_bytes(2166136261u, p, tok->len);
+    const char *end = p + tok->len;
+    uint32_t h = 2166136261u;
+    char ch[4];
+    while (p < end) {
+        int n = decode_char(&p, ch);
+        h = hash_bytes(h, ch, (size_t)n);
+    }
+    return h;
+}
+
+static bool token_equals(const JsonDoc *doc, const JsonDocToken *tok, const char *s, size_t len) {
+    const char *p = doc->src + tok->start;
+    if (!tok->escaped) return tok->len == len && memcmp(p, s, len) == 0;
+    const char *end = p + tok->len;
+    size_t matched = 0;
+    char ch[4];
+    while (p < end) {
+        int n = decode_char(&p, ch);
+        if (matched + (size_t)n > len || memcmp(s + matched, ch, (size_t)n) != 0) return false;
+        matched += (size_t)n;
+    }
+    return matched == len;
+}
+
+static const JsonDocToken *string_token(const JsonDoc *doc, int token) {
+    if (token < 0 || token >= doc->count || doc->tokens[token].type != JSON_DOC_STRING) return NULL;
+    return &doc->tokens[token];
+}
+
+// 登记对象的一个 key；已有同名 key 时保留第一个，与 cJSON_GetObjectItem 一致
+static void index_key(JsonDoc *doc, int object, int key) {
+    const JsonDocToken *tok = &doc->tokens[key];
+    uint32_t h = hash_token(doc, tok);
+    for (uint32_t slot = slot_of(h, object);; slot = (slot + 1) & (JSON_DOC_INDEX_SIZE - 1)) {
+        int existing = (int)doc->index[slot] - 1;
+        if (existing < 0) {
+            doc->index[slot] = (uint16_t)(key + 1);
+            return;
+        }
+        const JsonDocToken *other = &doc->tokens[existing];
+        if (other->parent != object) continue;
+        if (!tok->escaped && token_equals(doc, other, doc->src + tok->start, tok->len)) return;
+        if (tok->escaped && hash_token(doc, other) == h) {
+            // 两边都可能含转义，逐字符解码比较
+            char a[4], b[4];
+            const char *pa = doc->src + tok->start, *ea = pa + tok->len;
+            const char *pb = doc->src + other->start, *eb = pb + other->len;
+            bool same = true;
+            while (same && pa < ea && pb < eb) {
+                int na = decode_char(&pa, a), nb = decode_char(&pb, b);
+                same = na == nb && memcmp(a, b, (size_t)na) == 0;
+            }
+            if (same && pa == ea && pb == eb) return;
+        }
+    }
+}
+
+static int new_token(Scanner *s, JsonDocType type, int parent, const char *start) {
+    JsonDoc *doc = s->doc;
+    if (doc->count >= JSON_DOC_MAX_TOKENS) return JSON_DOC_TOO_LARGE;
+    int index = doc->count++;
+    JsonDocToken *tok = &doc->tokens[index];
+    tok->type = (uint8_t)type;
+    tok->escaped = 0;
+    tok->parent = parent < 0 ? JSON_DOC_NONE : (uint16_t)parent;
+    tok->end = (uint16_t)(index + 1);
+    tok->start = (uint32_t)(start - doc->src);
+    tok->len = 0;
+    return index;
+}
+
+static void skip_ws(Scanner *s) {
+    while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' || *s->p == '\r')) ++s->p;
+}
+
+static int scan_value(Scanner *s, int parent);
+
+static int scan_string(Scanner *s, int parent) {
+    int index = new_token(s, JSON_DOC_STRING, parent, s->p + 1);
+    if (index < 0) return index;
+    JsonDocToken *tok = &s->doc->tokens[index];
+    for (const char *p = s->p + 1; p < s->end; ++p) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') {
+            tok->len = (uint32_t)(p - s->doc->src) - tok->start;
+            s->p = p + 1;
+            return index;
+        }
+        if (c < 0x20) return JSON_DOC_INVALID;
+        if (c != '\\') continue;
+        tok->escaped = 1;
+        if (++p >= s->end) return JSON_DOC_INVALID;
+        if (*p && strchr("\"\\/bfnrt", *p)) continue;
+        if (*p != 'u' || s->end - p < 5) return JSON_DOC_INVALID;
+        int code = read_hex4(p + 1);
+        p += 4;
+        if (code < 0 || (code >= 0xDC00 && code <= 0xDFFF)) return JSON_DOC_INVALID;
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            // 高位代理后必须紧跟低位代理
+            if (s->end - p < 7 || p[1] != '\\' || p[2] != 'u') return JSON_DOC_INVALID;
+            int low = read_hex4(p + 3);
+            if (low < 0xDC00 || low > 0xDFFF) return JSON_DOC_INVALID;
+            p += 6;
+        }
+    }
+    return JSON_DOC_INVALID;
+}
+
+static bool skip_digits(Scanner *s) {
+    const char *start = s->p;
+    while (s->p < s->end && *s->p >= '0' && *s->p <= '9') ++s->p;
+    return s->p > start;
+}
+
+static int scan_number(Scanner *s, int parent) {
+    const char *start = s->p;
+    if (*s->p == '-') ++s->p;
+    if (!skip_digits(s)) return JSON_DOC_INVALID;
+    if (s->p < s->end && *s->p == '.') {
+        ++s->p;
+        if (!skip_digits(s)) return JSON_DOC_INVALID;
+    }
+    if (s->p < s->end && (*s->p == 'e' || *s->p == 'E')) {
+        ++s->p;
+        if (s->p < s->end && (*s->p == '+' || *s->p == '-')) ++s->p;
+        if (!skip_digits(s)) return JSON_DOC_INVALID;
+    }
+    if (s->p - start >= JSON_DOC_NUMBER_MAX) return JSON_DOC_INVALID;
+    int index = new_token(s, JSON_DOC_NUMBER, parent, start);
+    if (index >= 0) s->doc->tokens[index].len = (uint32_t)(s->p - start);
+    return index;
+}
+
+static int scan_literal(Scanner *s, int parent, const char *text, JsonDocType type) {
+    size_t len = strlen(text);
+    if ((size_t)(s->end - s->p) < len || memcmp(s->p, text, len) != 0) return JSON_DOC_INVALID;
+    int index = new_token(s, type, parent, s->p);
+    if (index < 0) return index;
+    s->doc->tokens[index].len = (uint32_t)len;
+    s->p += len;
+    return index;
+}
+
+// 解析数组或对象的元素，s->p 指向 '[' 或 '{'
+static int scan_container(Scanner *s, int parent, bool object) {
+    if (++s->depth > JSON_DOC_MAX_DEPTH) return JSON_DOC_TOO_LARGE;
+    int index = new_token(s, object ? JSON_DOC_OBJECT : JSON_DOC_ARRAY, parent, s->p);
+    if (index < 0) return index;
+    char close = object ? '}' : ']';
+    ++s->p;
+    skip_ws(s);
+    if (s->p < s->end && *s->p == close) {
+        ++s->p;
+    } else {
+        for (;;) {
+            skip_ws(s);
+            if (object) {
+                if (s->p >= s->end || *s->p != '"') return JSON_DOC_INVALID;
+                int key = scan_string(s, index);
+                if (key < 0) return key;
+                index_key(s->doc, index, key);
+                skip_ws(s);
+                if (s->p >= s->end || *s->p != ':') return JSON_DOC_INVALID;
+                ++s->p;
+                skip_ws(s);
+            }
+            int value = scan_value(s, index);
+            if (value < 0) return value;
+            skip_ws(s);
+            if (s->p >= s->end) return JSON_DOC_INVALID;
+            if (*s->p == ',') {
+                ++s->p;
+                continue;
+            }
+            if (*s->p != close) return JSON_DOC_INVALID;
+            ++s->p;
+            break;
+        }
+    }
+    JsonDocToken *tok = &s->doc->tokens[index];
+    tok->end = (uint16_t)s->doc->count;
+    tok->len = (uint32_t)(s->p - s->doc->src) - tok->start;
+    --s->depth;
+    return index;
+}
+
+static int scan_value(Scanner *s, int parent) {
+    if (s->p >= s->end) return JSON_DOC_INVALID;
+    switch (*s->p) {
+    case '{': return scan_container(s, parent, true);
+    case '[': return scan_container(s, parent, false);
+    case '"': return scan_string(s, parent);
+    case 't': return scan_literal(s, parent, "true", JSON_DOC_TRUE);
+    case 'f': return scan_literal(s, parent, "false", JSON_DOC_FALSE);
+    case 'n': return scan_literal(s, parent, "null", JSON_DOC_NULL);
+    default:  return scan_number(s, parent);
+    }
+}
+
+JsonDocStatus json_doc_parse(JsonDoc *doc, const char *src, size_t len) {
+    doc->src = src;
+    doc->count = 0;
+    memset(doc->index, 0, sizeof(doc->index));
+    Scanner s = { doc, src, src + len, 0 };
+    skip_ws(&s);
+    int root = scan_value(&s, -1);
+    if (root < 0) return (JsonDocStatus)root;
+    skip_ws(&s);
+    return s.p == s.end ? JSON_DOC_OK : JSON_DOC_INVALID;
+}
+
+JsonDocType json_doc_type(const JsonDoc *doc, int token) {
+    if (token < 0 || token >= doc->count) return JSON_DOC_NULL;
+    return (JsonDocType)doc->tokens[token].type;
+}
+
+int json_doc_get(const JsonDoc *doc, int object, const char *key) {
+    if (json_doc_type(doc, object) != JSON_DOC_OBJECT) return -1;
+    size_t len = strlen(key);
+    uint32_t h = hash_bytes(2166136261u, key, len);
+    for (uint32_t slot = slot_of(h, object);; slot = (slot + 1) & (JSON_DOC_INDEX_SIZE - 1)) {
+        int candidate = (int)doc->index[slot] - 1;
+        if (candidate < 0) return -1;
+        const JsonDocToken *tok = &doc->tokens[candidate];
+        if (tok->parent == object && token_equals(doc, tok, key, len)) return candidate + 1;
+    }
+}
+
+int json_doc_first(const JsonDoc *doc, int array) {
+    if (json_doc_type(doc, array) != JSON_DOC_ARRAY) return -1;
+    return doc->tokens[array].end > array + 1 ? array + 1 : -1;
+}
+
+int json_doc_next(const JsonDoc *doc, int element) {
+    if (element < 0 || element >= doc->count) return -1;
+    int parent = doc->tokens[element].parent;
+    int next = doc->tokens[element].end;
+    return parent != JSON_DOC_NONE && next < doc->tokens[parent].end ? next : -1;
+}
+
+bool json_doc_string_equals(const JsonDoc *doc, int token, const char *s) {
+    const JsonDocToken *tok = string_token(doc, token);
+    return tok && token_equals(doc, tok, s, strlen(s));
+}
+
+int json_doc_string(const JsonDoc *doc, int token, char *out, size_t cap) {
+    const JsonDocToken *tok = string_token(doc, token);
+    if (!tok || cap == 0) return -1;
+    const char *p = doc->src + tok->start;
+    const char *end = p + tok->len;
+    size_t len = 0;
+    char ch[4];
+    while (p < end) {
+        int n = decode_char(&p, ch);
+        if (len + (size_t)n >= cap) return -1;
+        memcpy(out + len, ch, (size_t)n);
+        len += (size_t)n;
+    }
+    out[len] = '\0';
+    return (int)len;
+}
+
+double json_doc_number(const JsonDoc *doc, int token) {
+    if (json_doc_type(doc, token) != JSON_DOC_NUMBER) return 0;
+    // 源缓冲区不一定以 NUL 结尾，复制后再转换
+    char text[JSON_DOC_NUMBER_MAX];
+    const JsonDocToken *tok = &doc->tokens[token];
+    memcpy(text, doc->src + tok->start, tok->len);
+    text[tok->len] = '\0';
+    return strtod(text, NULL);
+}
+
+const char *json_doc_raw(const JsonDoc *doc, int token, size_t *len) {
+    if (token < 0 || token >= doc->count) {
+        *len = 0;
+        return NULL;
+    }
+    const JsonDocToken *tok = &doc->tokens[token];
+    bool quoted = tok->type == JSON_DOC_STRING;
+    *len = tok->len + (quoted ? 2 : 0);
+    return doc->src + tok->start - (quoted ? 1 : 0);
+}
@@ -0,0 +1,62 @@
+// 只读的原地 JSON 解析：token 只记录在源缓冲区中的偏移，字符串在读取时才解码；
+// 对象成员建哈希索引，按 key 查找为常数时间（区分大小写）。整个过程不分配内存
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define JSON_DOC_MAX_TOKENS 128 // 足够容纳一次手柄 tools/call，超出时调用方退回 cJSON
+#define JSON_DOC_MAX_DEPTH 16
+#define JSON_DOC_INDEX_SIZE 128 // 2 的幂；key 最多占 token 的一半，负载不超过 0.5
+
+typedef enum {
+    JSON_DOC_OK = 0,
+    JSON_DOC_INVALID = -1,   // 不是合法 JSON
+    JSON_DOC_TOO_LARGE = -2, // token 数或嵌套深度超出上限
+} JsonDocStatus;
+
+typedef enum {
+    JSON_DOC_NULL,
+    JSON_DOC_FALSE,
+    JSON_DOC_TRUE,
+    JSON_DOC_NUMBER,
+    JSON_DOC_STRING,
+    JSON_DOC_ARRAY,
+    JSON_DOC_OBJECT,
+} JsonDocType;
+
+typedef struct {
+    uint8_t type;
+    uint8_t escaped; // 字符串含转义序列，读取时需要解码
+    uint16_t parent; // 所在容器的 token 下标；对象成员的 key 与值都以对象为 parent
+    uint16_t end;    // 该值之后第一个 token 的下标，用于跳过整个子树
+    uint32_t start;  // 在源缓冲区中的偏移；字符串不含引号
+    uint32_t len;
+} JsonDocToken;
+
+// 约 2.3 KB，栈较小的线程应使用静态实例
+typedef struct {
+    const char *src;
+    int count;
+    JsonDocToken tokens[JSON_DOC_MAX_TOKENS];
+    uint16_t index[JSON_DOC_INDEX_SIZE]; // key token 下标 + 1，0 表示空槽
+} JsonDoc;
+
+// 解析 src 的前 len 字节，根值为 token 0。doc 引用 src，使用期间 src 不能改变
+JsonDocStatus json_doc_parse(JsonDoc *doc, const char *src, size_t len);
+
+// 以下函数的 token 参数可以为 -1（不存在），此时按缺失处理
+JsonDocType json_doc_type(const JsonDoc *doc, int token);
+// 返回对象中 key 对应值的 token，不存在或 object 不是对象时返回 -1；重复的 key 取第一个
+int json_doc_get(const JsonDoc *doc, int object, const char *key);
+// 数组的第一个元素 / 下一个元素，没有时返回 -1
+int json_doc_first(const JsonDoc *doc, int array);
+int json_doc_next(const JsonDoc *doc, int element);
+// 解码后的字符串是否等于 s，不是字符串时返回 false
+bool json_doc_string_equals(const JsonDoc *doc, int token, const char *s);
+// 解码字符串到 out（NUL 结尾），返回长度；不是字符串或放不下时返回 -1
+int json_doc_string(const JsonDoc *doc, int token, char *out, size_t cap);
+// 不是数字时返回 0
+double json_doc_number(const JsonDoc *doc, int token);
+// 值在源缓冲区中的原始文本（字符串含引号）
+const char *json_doc_raw(const JsonDoc *doc, int token, size_t *len);
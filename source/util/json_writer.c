@@ -0,0 +1,162 @@
+#include "json_writer.h"
+#include <stdio.h>
+#include <string.h>
+
+void json_writer_init(JsonWriter *w, char *buf, size_t cap, JsonFlushFn flush, void *flush_ctx) {
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = cap;
+    w->flush = flush;
+    w->flush_ctx = flush_ctx;
+}
+
+static void flush_buffer(JsonWriter *w) {
+    if (w->failed || w->len == 0) return;
+    if (w->flush(w->flush_ctx, w->buf, w->len) != 0) w->failed = true;
+    w->len = 0;
+}
+
+static void put(JsonWriter *w, const char *data, size_t len) {
+    while (len > 0 && !w->failed) {
+        if (w->len == w->cap) flush_buffer(w);
+        size_t n = w->cap - w->len;
+        if (n > len) n = len;
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void put_char(JsonWriter *w, char c) {
+    if (w->len == w->cap) flush_buffer(w);
+    if (!w->failed) w->buf[w->len++] = c;
+}
+
+// 值之前的逗号：key 之后的值不需要
+static void begin_value(JsonWriter *w) {
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    if (w->depth == 0) return;
+    if (w->items & (1u << w->depth)) put_char(w, ',');
+    w->items |= 1u << w->depth;
+}
+
+static void begin_container(JsonWriter *w, char open) {
+    begin_value(w);
+    if (w->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        w->failed = true;
+        return;
+    }
+    put_char(w, open);
+    ++w->depth;
+    w->items &= ~(1u << w->depth);
+}
+
+static void end_container(JsonWriter *w, char close) {
+    if (w->depth > 0) --w->depth;
+    put_char(w, close);
+}
+
+void json_begin_object(JsonWriter *w) { begin_container(w, '{'); }
+void json_end_object(JsonWriter *w) { end_container(w, '}'); }
+void json_begin_array(JsonWriter *w) { begin_container(w, '['); }
+void json_end_array(JsonWriter *w) { end_container(w, ']'); }
+
+static void put_escaped(JsonWriter *w, const char *s) {
+    put_char(w, '"');
+    const char *run = s; // 连续无需转义的字节整段复制
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        put(w, run, (size_t)(s - run));
+        char esc[7] = { '\\', 0 };
+        switch (c) {
+        case '"':  esc[1] = '"'; break;
+        case '\\': esc[1] = '\\'; break;
+        case '\b': esc[1] = 'b'; break;
+        case '\f': esc[1] = 'f'; break;
+        case '\n': esc[1] = 'n'; break;
+        case '\r': esc[1] = 'r'; break;
+        case '\t': esc[1] = 't'; break;
+        default:   snprintf(esc, sizeof(esc), "\\u%04x", c); break;
+        }
+        put(w, esc, strlen(esc));
+        run = s + 1;
+    }
+    put(w, run, (size_t)(s - run));
+    put_char(w, '"');
+}
+
+void json_key(JsonWriter *w, const char *key) {
+    begin_value(w);
+    put_escaped(w, key);
+    put_char(w, ':');
+    w->after_key = true;
+}
+
+void json_string(JsonWriter *w, const char *s) {
+    begin_value(w);
+    put_escaped(w, s ? s : "");
+}
+
+void json_string_produced(JsonWriter *w, JsonStringProducer producer, void *ctx) {
+    begin_value(w);
+    put_char(w, '"');
+    while (!w->failed) {
+        // producer 直接写入缓冲区空闲部分，省去一次复制
+        if (w->cap - w->len < JSON_WRITER_MIN_PRODUCE) flush_buffer(w);
+        if (w->failed) break;
+        size_t n = producer(ctx, w->buf + w->len, w->cap - w->len);
+        if (n == 0) break;
+        w->len += n;
+    }
+    put_char(w, '"');
+}
+
+void json_number(JsonWriter *w, double d) {
+    begin_value(w);
+    // 借用 cJSON 的数字格式化，输出与 cJSON_Print 逐字节一致；栈上的临时节点不分配内存
+    cJSON item = { .type = cJSON_Number };
+    cJSON_SetNumberHelper(&item, d);
+    char num[32];
+    if (cJSON_PrintPreallocated(&item, num, sizeof(num), false)) put(w, num, strlen(num));
+}
+
+void json_bool(JsonWriter *w, bool b) {
+    begin_value(w);
+    put(w, b ? "true" : "false", b ? 4 : 5);
+}
+
+void json_null(JsonWriter *w) {
+    begin_value(w);
+    put(w, "null", 4);
+}
+
+void json_value(JsonWriter *w, const cJSON *item) {
+    if (!item) {
+        json_null(w);
+        return;
+    }
+    begin_value(w);
+    char small[128];
+    if (cJSON_PrintPreallocated((cJSON *)item, small, sizeof(small), false)) {
+        put(w, small, strlen(small));
+        return;
+    }
+    size_t len = 0;
+    char *printed = cJSON_PrintUnformattedWithLength(item, &len);
+    if (!printed) {
+        w->failed = true;
+        return;
+    }
+    put(w, printed, len);
+    cJSON_free(printed);
+}
+
+int json_writer_finish(JsonWriter *w) {
+    flush_buffer(w);
+    return w->failed ? -1 : 0;
+}
@@ -0,0 +1,43 @@
+// 流式 JSON 输出：直接写入固定大小的缓冲区，写满即通过 flush 回调发出，不构建 cJSON 树
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include "../third_party/cJSON.h"
+
+#define JSON_WRITER_MAX_DEPTH 16
+#define JSON_WRITER_MIN_PRODUCE 64 // 调用 producer 前保证的最小可写空间
+
+// 发出缓冲区中的数据，失败返回非 0
+typedef int (*JsonFlushFn)(void *ctx, const char *data, size_t len);
+// 分段提供字符串内容：向 out 写入至多 cap 字节并返回写入数，返回 0 表示结束。
+// 内容原样写出，调用方保证其中没有需要转义的字符（如 base64）
+typedef size_t (*JsonStringProducer)(void *ctx, char *out, size_t cap);
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    JsonFlushFn flush;
+    void *flush_ctx;
+    bool failed;     // flush 失败或嵌套过深后不再写出任何内容
+    int depth;
+    unsigned items;  // 第 d 位：第 d 层容器已有元素，下一个元素前需要逗号
+    bool after_key;
+} JsonWriter;
+
+void json_writer_init(JsonWriter *w, char *buf, size_t cap, JsonFlushFn flush, void *flush_ctx);
+void json_begin_object(JsonWriter *w);
+void json_end_object(JsonWriter *w);
+void json_begin_array(JsonWriter *w);
+void json_end_array(JsonWriter *w);
+void json_key(JsonWriter *w, const char *key);
+void json_string(JsonWriter *w, const char *s);
+void json_string_produced(JsonWriter *w, JsonStringProducer producer, void *ctx);
+// 与 cJSON 打印数字的格式一致
+void json_number(JsonWriter *w, double d);
+void json_bool(JsonWriter *w, bool b);
+void json_null(JsonWriter *w);
+// 写出一个已有的 cJSON 值（如请求 id）
+void json_value(JsonWriter *w, const cJSON *item);
+// 发出剩余数据，返回 0 表示全部成功
+int json_writer_finish(JsonWriter *w);
@@ -0,0 +1,284 @@
+#include "metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "arena.h"
+#include "heap.h"
+
+// 直方图桶上界（微秒），最后隐含 +Inf
+static const u32 bucket_bounds_us[] = { 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000 };
+#define BUCKET_COUNT (sizeof(bucket_bounds_us) / sizeof(bucket_bounds_us[0]) + 1)
+
+static const char *const stage_names[METRIC_STAGE_COUNT] = { "first_byte", "parse", "queue", "handler", "send" };
+static const char *const reject_names[METRIC_REJECT_COUNT] = { "bad_request", "session_busy", "sse_full", "ws_full", "overloaded" };
+
+typedef struct {
+    u32 buckets[BUCKET_COUNT]; // 非累计，导出时再累加
+    u32 count;
+    u64 sum_ticks;
+} Histogram;
+
+typedef struct {
+    const char *method; // NULL 表示空槽
+    const char *tool;
+    Histogram stages[METRIC_STAGE_COUNT];
+} Series;
+
+// 以下由 metrics_mutex 保护
+static Series series[METRICS_MAX_SERIES];
+static u64 accepted_total = 0;
+static u64 rejected_total[METRIC_REJECT_COUNT];
+static s64 gauges[METRIC_GAUGE_COUNT];
+static Mutex metrics_mutex = 0;
+
+// 当前线程进行中的请求
+typedef struct {
+    bool active;
+    u64 start;
+    u64 send_ticks;
+    u64 pre_ticks[METRIC_STAGE_HANDLER]; // first_byte / parse / queue
+    const char *method;
+    const char *tool;
+} RequestTiming;
+
+static __thread RequestTiming current;
+
+static void observe(Histogram *h, u64 ticks) {
+    u64 us = armTicksToNs(ticks) / 1000;
+    size_t i = 0;
+    while (i < BUCKET_COUNT - 1 && us > bucket_bounds_us[i]) ++i;
+    h->buckets[i]++;
+    h->count++;
+    h->sum_ticks += ticks;
+}
+
+static bool same_label(const char *a, const char *b) {
+    if (a == b) return true;
+    return a && b && strcmp(a, b) == 0;
+}
+
+// 查找或创建 (method, tool) 对应的序列，最后一个槽固定留给 other
+static Series *find_series(const char *method, const char *tool) {
+    for (int i = 0; i < METRICS_MAX_SERIES - 1; ++i) {
+        Series *s = &series[i];
+        if (!s->method) {
+            s->method = method;
+            s->tool = tool;
+            return s;
+        }
+        if (same_label(s->method, method) && same_label(s->tool, tool)) return s;
+    }
+    Series *other = &series[METRICS_MAX_SERIES - 1];
+    other->method = "other";
+    other->tool = NULL;
+    return other;
+}
+
+void metrics_request_begin(u64 first_byte_ticks, u64 parse_ticks, u64 queue_ticks) {
+    current.active = true;
+    current.start = svcGetSystemTick();
+    current.send_ticks = 0;
+    current.pre_ticks[METRIC_STAGE_FIRST_BYTE] = first_byte_ticks;
+    current.pre_ticks[METRIC_STAGE_PARSE] = parse_ticks;
+    current.pre_ticks[METRIC_STAGE_QUEUE] = queue_ticks;
+    current.method = "http"; // 非 JSON-RPC 路由
+    current.tool = NULL;
+}
+
+void metrics_request_label(const char *method, const char *tool) {
+    if (!current.active) return;
+    current.method = method;
+    current.tool = tool;
+}
+
+void metrics_add_send_ticks(u64 ticks) {
+    if (current.active) current.send_ticks += ticks;
+}
+
+void metrics_request_end() {
+    if (!current.active) return;
+    current.active = false;
+    u64 total = svcGetSystemTick() - current.start;
+    u64 handler = total > current.send_ticks ? total - current.send_ticks : 0;
+
+    mutexLock(&metrics_mutex);
+    Series *s = find_series(current.method, current.tool);
+    for (int i = 0; i < METRIC_STAGE_HANDLER; ++i) {
+        if (current.pre_ticks[i] != METRICS_NO_SAMPLE) observe(&s->stages[i], current.pre_ticks[i]);
+    }
+    observe(&s->stages[METRIC_STAGE_HANDLER], handler);
+    observe(&s->stages[METRIC_STAGE_SEND], current.send_ticks);
+    mutexUnlock(&metrics_mutex);
+}
+
+void metrics_count_accepted() {
+    mutexLock(&metrics_mutex);
+    ++accepted_total;
+    mutexUnlock(&metrics_mutex);
+}
+
+void metrics_count_rejected(MetricReject reason) {
+    if (reason < 0 || reason >= METRIC_REJECT_COUNT) return;
+    mutexLock(&metrics_mutex);
+    ++rejected_total[reason];
+    mutexUnlock(&metrics_mutex);
+}
+
+void metrics_gauge_set(MetricGauge gauge, s64 value) {
+    if (gauge < 0 || gauge >= METRIC_GAUGE_COUNT) return;
+    mutexLock(&metrics_mutex);
+    gauges[gauge] = value;
+    mutexUnlock(&metrics_mutex);
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    bool failed;
+} TextBuf;
+
+static void appendf(TextBuf *buf, const char *fmt, ...) {
+    if (buf->failed) return;
+    while (1) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            buf->failed = true;
+            return;
+        }
+        if ((size_t)n < buf->cap - buf->len) {
+            buf->len += n;
+            return;
+        }
+        size_t cap = buf->cap * 2;
+        while (cap - buf->len <= (size_t)n) cap *= 2;
+        char *data = heap_realloc(HEAP_TAG_HTTP, buf->data, cap);
+        if (!data) {
+            buf->failed = true;
+            return;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+}
+
+static void append_labels(TextBuf *buf, const Series *s, int stage) {
+    appendf(buf, "stage=\"%s\",method=\"%s\"", stage_names[stage], s->method);
+    if (s->tool) appendf(buf, ",tool=\"%s\"", s->tool);
+}
+
+static void append_stage_histograms(TextBuf *buf) {
+    appendf(buf, "# HELP mcp_request_stage_seconds Request latency by stage, JSON-RPC method and tool.\n"
+                 "# TYPE mcp_request_stage_seconds histogram\n");
+    for (int i = 0; i < METRICS_MAX_SERIES; ++i) {
+        const Series *s = &series[i];
+        if (!s->method) continue;
+        for (int stage = 0; stage < METRIC_STAGE_COUNT; ++stage) {
+            const Histogram *h = &s->stages[stage];
+            if (h->count == 0) continue;
+            u32 cumulative = 0;
+            for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+                cumulative += h->buckets[b];
+                appendf(buf, "mcp_request_stage_seconds_bucket{");
+                append_labels(buf, s, stage);
+                if (b < BUCKET_COUNT - 1) {
+                    appendf(buf, ",le=\"%g\"} %lu\n", bucket_bounds_us[b] / 1e6, (unsigned long)cumulative);
+                } else {
+                    appendf(buf, ",le=\"+Inf\"} %lu\n", (unsigned long)cumulative);
+                }
+            }
+            appendf(buf, "mcp_request_stage_seconds_sum{");
+            append_labels(buf, s, stage);
+            appendf(buf, "} %.6f\n", armTicksToNs(h->sum_ticks) / 1e9);
+            appendf(buf, "mcp_request_stage_seconds_count{");
+            append_labels(buf, s, stage);
+            appendf(buf, "} %lu\n", (unsigned long)h->count);
+        }
+    }
+}
+
+char *metrics_render(size_t *out_len) {
+    TextBuf buf = { heap_alloc(HEAP_TAG_HTTP, 4096), 0, 4096, false };
+    if (!buf.data) return NULL;
+
+    // 堆为 main.c 中的 fake heap，用 newlib 的 mallinfo 统计；进程内存来自内核
+    struct mallinfo mi = mallinfo();
+    u64 process_used = 0, process_total = 0;
+    svcGetInfo(&process_used, InfoType_UsedMemorySize, CUR_PROCESS_HANDLE, 0);
+    svcGetInfo(&process_total, InfoType_TotalMemorySize, CUR_PROCESS_HANDLE, 0);
+
+    RequestArenaStats arena;
+    request_arena_stats(&arena);
+
+    mutexLock(&metrics_mutex);
+    append_stage_histograms(&buf);
+    appendf(&buf, "# HELP mcp_connections_accepted_total Accepted TCP connections.\n"
+                  "# TYPE mcp_connections_accepted_total counter\n"
+                  "mcp_connections_accepted_total %llu\n", (unsigned long long)accepted_total);
+    appendf(&buf, "# HELP mcp_connections_rejected_total Rejected requests and connections by reason.\n"
+                  "# TYPE mcp_connections_rejected_total counter\n");
+    for (int i = 0; i < METRIC_REJECT_COUNT; ++i) {
+        appendf(&buf, "mcp_connections_rejected_total{reason=\"%s\"} %llu\n", reject_names[i], (unsigned long long)rejected_total[i]);
+    }
+    appendf(&buf, "# HELP mcp_sse_connections Attached SSE streams.\n"
+                  "# TYPE mcp_sse_connections gauge\n"
+                  "mcp_sse_connections %lld\n", (long long)gauges[METRIC_GAUGE_SSE_CONNECTIONS]);
+    mutexUnlock(&metrics_mutex);
+
+    appendf(&buf, "# HELP mcp_heap_used_bytes Bytes allocated from the malloc heap.\n"
+                  "# TYPE mcp_heap_used_bytes gauge\n"
+                  "mcp_heap_used_bytes %lu\n", (unsigned long)mi.uordblks);
+    appendf(&buf, "# HELP mcp_heap_arena_bytes Bytes obtained from the heap by malloc.\n"
+                  "# TYPE mcp_heap_arena_bytes gauge\n"
+                  "mcp_heap_arena_bytes %lu\n", (unsigned long)mi.arena);
+    appendf(&buf, "# HELP mcp_heap_tag_live_bytes Heap bytes currently held by each subsystem.\n"
+                  "# TYPE mcp_heap_tag_live_bytes gauge\n");
+    for (int i = 0; i < HEAP_TAG_COUNT; ++i) {
+        HeapTagStats s;
+        heap_tag_stats((HeapTag)i, &s);
+        appendf(&buf, "mcp_heap_tag_live_bytes{tag=\"%s\"} %lu\n", heap_tag_name((HeapTag)i), (unsigned long)s.live_bytes);
+    }
+    appendf(&buf, "# HELP mcp_heap_tag_peak_bytes High-water mark of heap bytes held by each subsystem.\n"
+                  "# TYPE mcp_heap_tag_peak_bytes gauge\n");
+    for (int i = 0; i < HEAP_TAG_COUNT; ++i) {
+        HeapTagStats s;
+        heap_tag_stats((HeapTag)i, &s);
+        appendf(&buf, "mcp_heap_tag_peak_bytes{tag=\"%s\"} %lu\n", heap_tag_name((HeapTag)i), (unsigned long)s.peak_bytes);
+    }
+    appendf(&buf, "# HELP mcp_heap_tag_alloc_failures_total Failed heap allocations by subsystem.\n"
+                  "# TYPE mcp_heap_tag_alloc_failures_total counter\n");
+    for (int i = 0; i < HEAP_TAG_COUNT; ++i) {
+        HeapTagStats s;
+        heap_tag_stats((HeapTag)i, &s);
+        appendf(&buf, "mcp_heap_tag_alloc_failures_total{tag=\"%s\"} %llu\n", heap_tag_name((HeapTag)i), (unsigned long long)s.failures);
+    }
+    appendf(&buf, "# HELP mcp_heap_largest_free_bytes Contiguous free space at the top of the heap.\n"
+                  "# TYPE mcp_heap_largest_free_bytes gauge\n"
+                  "mcp_heap_largest_free_bytes %lu\n", (unsigned long)heap_largest_free());
+    appendf(&buf, "# HELP mcp_request_arena_peak_bytes Largest per-request cJSON arena usage.\n"
+                  "# TYPE mcp_request_arena_peak_bytes gauge\n"
+                  "mcp_request_arena_peak_bytes %lu\n", (unsigned long)arena.peak_bytes);
+    appendf(&buf, "# HELP mcp_request_arena_fallback_total cJSON allocations served by malloc instead of the request arena.\n"
+                  "# TYPE mcp_request_arena_fallback_total counter\n"
+                  "mcp_request_arena_fallback_total{reason=\"block\"} %llu\n"
+                  "mcp_request_arena_fallback_total{reason=\"no_arena\"} %llu\n",
+            (unsigned long long)arena.fallback_allocs, (unsigned long long)arena.unavailable);
+    appendf(&buf, "# HELP mcp_process_memory_used_bytes Process memory in use as reported by the kernel.\n"
+                  "# TYPE mcp_process_memory_used_bytes gauge\n"
+                  "mcp_process_memory_used_bytes %llu\n", (unsigned long long)process_used);
+    appendf(&buf, "# HELP mcp_process_memory_total_bytes Process memory available as reported by the kernel.\n"
+                  "# TYPE mcp_process_memory_total_bytes gauge\n"
+                  "mcp_process_memory_total_bytes %llu\n", (unsigned long long)process_total);
+
+    if (buf.failed) {
+        heap_free(buf.data);
+        return NULL;
+    }
+    *out_len = buf.len;
+    return buf.data;
+}
@@ -0,0 +1,47 @@
+// 进程内指标：计数器、固定桶直方图与 gauge，以 Prometheus 文本格式从 GET /metrics 导出
+#pragma once
+#include <switch.h>
+#include <stddef.h>
+
+#define METRICS_MAX_SERIES 24          // (method, tool) 组合上限，超出的归入 other
+#define METRICS_NO_SAMPLE ((u64)-1)    // 本次请求没有该阶段的样本
+
+// 请求各阶段，用于区分网络延迟与设备端延迟
+typedef enum {
+    METRIC_STAGE_FIRST_BYTE = 0, // accept 到收到请求首字节，仅统计连接上的首个请求
+    METRIC_STAGE_PARSE,          // 首字节到请求收齐并解析完成（含上传耗时）
+    METRIC_STAGE_QUEUE,          // 等待 worker
+    METRIC_STAGE_HANDLER,        // worker 处理，不含写 socket
+    METRIC_STAGE_SEND,           // 写 socket，含等待对端可写
+    METRIC_STAGE_COUNT,
+} MetricStage;
+
+typedef enum {
+    METRIC_REJECT_BAD_REQUEST = 0, // 请求过大或格式错误
+    METRIC_REJECT_SESSION_BUSY,    // 会话处理中请求过多（429）
+    METRIC_REJECT_SSE_FULL,
+    METRIC_REJECT_WS_FULL,
+    METRIC_REJECT_OVERLOADED,      // 调度队列已满或堆预算不足（503）
+    METRIC_REJECT_COUNT,
+} MetricReject;
+
+typedef enum {
+    METRIC_GAUGE_SSE_CONNECTIONS = 0,
+    METRIC_GAUGE_COUNT,
+} MetricGauge;
+
+// 以下 request 接口作用于当前线程正在处理的请求
+// 开始计时，各参数为 reactor 侧已测得的 tick 数，可为 METRICS_NO_SAMPLE
+void metrics_request_begin(u64 first_byte_ticks, u64 parse_ticks, u64 queue_ticks);
+// method/tool 须为静态字符串（方法表、工具表中的名字），tool 可为 NULL
+void metrics_request_label(const char *method, const char *tool);
+// 由 http_send_iov 调用，累计写 socket 的耗时；当前线程没有进行中的请求时忽略
+void metrics_add_send_ticks(u64 ticks);
+void metrics_request_end();
+
+void metrics_count_accepted();
+void metrics_count_rejected(MetricReject reason);
+void metrics_gauge_set(MetricGauge gauge, s64 value);
+
+// 生成文本格式的全部指标（heap_alloc 分配，调用者 heap_free），失败返回 NULL
+char *metrics_render(size_t *out_len);
@@ -0,0 +1,80 @@
+#include "pool.h"
+
+void slab_pool_init(SlabPool *pool, void *storage, size_t block_size, int count) {
+    pool->storage = (u8 *)storage;
+    pool->block_size = block_size;
+    pool->count = count;
+    pool->in_use = 0;
+    pool->peak = 0;
+    pool->exhausted = 0;
+    mutexInit(&pool->mutex);
+    // 按地址顺序串起空闲块，先分配的块位于存储区开头
+    pool->free_list = NULL;
+    for (int i = count - 1; i >= 0; --i) {
+        void *block = pool->storage + (size_t)i * block_size;
+        *(void **)block = pool->free_list;
+        pool->free_list = block;
+    }
+}
+
+void *slab_alloc(SlabPool *pool) {
+    mutexLock(&pool->mutex);
+    void *block = pool->free_list;
+    if (block) {
+        pool->free_list = *(void **)block;
+        if (++pool->in_use > pool->peak) pool->peak = pool->in_use;
+    } else {
+        pool->exhausted++;
+    }
+    mutexUnlock(&pool->mutex);
+    return block;
+}
+
+void slab_free(SlabPool *pool, void *ptr) {
+    if (!ptr) return;
+    mutexLock(&pool->mutex);
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+    pool->in_use--;
+    mutexUnlock(&pool->mutex);
+}
+
+bool slab_owns(const SlabPool *pool, const void *ptr) {
+    const u8 *p = (const u8 *)ptr;
+    return p >= pool->storage && p < pool->storage + pool->block_size * (size_t)pool->count;
+}
+
+void slab_pool_stats(SlabPool *pool, SlabPoolStats *out) {
+    mutexLock(&pool->mutex);
+    out->in_use = pool->in_use;
+    out->peak = pool->peak;
+    out->count = pool->count;
+    out->exhausted = pool->exhausted;
+    mutexUnlock(&pool->mutex);
+}
+
+void *buffer_lease_acquire(BufferLease *lease, u64 timeout_ns) {
+    mutexLock(&lease->mutex);
+    u64 deadline = svcGetSystemTick() + armNsToTicks(timeout_ns);
+    while (lease->leased) {
+        u64 now = svcGetSystemTick();
+        if (now >= deadline) break;
+        condvarWaitTimeout(&lease->cond, &lease->mutex, armTicksToNs(deadline - now));
+    }
+    void *data = NULL;
+    if (lease->leased) {
+        lease->busy++;
+    } else {
+        lease->leased = true;
+        data = lease->data;
+    }
+    mutexUnlock(&lease->mutex);
+    return data;
+}
+
+void buffer_lease_release(BufferLease *lease) {
+    mutexLock(&lease->mutex);
+    lease->leased = false;
+    condvarWakeOne(&lease->cond);
+    mutexUnlock(&lease->mutex);
+}
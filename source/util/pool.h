@@ -0,0 +1,50 @@
+// 静态分配的固定块池与独占缓冲区：存储在编译期确定，运行期不碰堆，用尽时立即失败而不是等 malloc 失败
+#pragma once
+#include <switch.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// 定义池的静态存储：count 个 block_size 字节的块，block_size 需为 16 的倍数
+#define SLAB_POOL_STORAGE(name, block_size, count) \
+    static u8 name[(size_t)(block_size) * (count)] __attribute__((aligned(16)))
+
+typedef struct {
+    u8 *storage;
+    size_t block_size;
+    int count;
+    void *free_list; // 空闲块的首字节存放下一个空闲块的地址
+    int in_use;
+    int peak;        // in_use 的历史最大值
+    u64 exhausted;   // 池已用尽而失败的分配次数
+    Mutex mutex;
+} SlabPool;
+
+typedef struct {
+    int in_use;
+    int peak;
+    int count;
+    u64 exhausted;
+} SlabPoolStats;
+
+// 单个可复用的大缓冲区，同一时刻只借给一个持有者
+typedef struct {
+    void *data;
+    size_t size;
+    bool leased;
+    u64 busy;        // 等待超时而失败的次数
+    Mutex mutex;
+    CondVar cond;
+} BufferLease;
+
+#define BUFFER_LEASE_INIT(buffer) { .data = (buffer), .size = sizeof(buffer) }
+
+void slab_pool_init(SlabPool *pool, void *storage, size_t block_size, int count);
+// 池已用尽时返回 NULL
+void *slab_alloc(SlabPool *pool);
+void slab_free(SlabPool *pool, void *ptr);
+bool slab_owns(const SlabPool *pool, const void *ptr);
+void slab_pool_stats(SlabPool *pool, SlabPoolStats *out);
+
+// 等待至多 timeout_ns 纳秒，0 表示不等待；超时返回 NULL
+void *buffer_lease_acquire(BufferLease *lease, u64 timeout_ns);
+void buffer_lease_release(BufferLease *lease);
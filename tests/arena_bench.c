@@ -0,0 +1,214 @@
+// 请求级 arena 与默认 malloc hooks 的对比：解析 + 构建 + 打印的吞吐、每请求的堆调用次数，以及堆碎片
+// 每个请求另外保留一小块长期存活的内存（类似会话、缓存条目），与请求内的短期分配交错，这是 fake heap 产生碎片的来源
+#include <switch.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../source/third_party/cJSON.h"
+#include "../source/util/arena.h"
+#include "../source/util/heap.h"
+
+#define REQUESTS 200000
+#define RETAINED_SLOTS 64
+#define RETAINED_SIZE 48
+
+static const char controller_request[] =
+    "{\"jsonrpc\":\"2.0\",\"id\":42,\"method\":\"tools/call\",\"params\":{\"name\":\"controller\",\"arguments\":{"
+    "\"A\":true,\"B\":false,\"X\":false,\"Y\":true,\"L\":false,\"R\":false,\"ZL\":false,\"ZR\":true,"
+    "\"lx\":12000,\"ly\":-32768,\"rx\":0,\"ry\":512,\"duration_ms\":100,\"long_press\":false}}}";
+
+static const char tools_list_request[] = "{\"jsonrpc\":\"2.0\",\"id\":43,\"method\":\"tools/list\"}";
+
+static u64 stock_calls = 0;
+
+// 默认 hooks 加上调用计数：与 cJSON_InitHooks(NULL) 行为相同
+static void *counting_malloc(size_t size) {
+    stock_calls++;
+    return malloc(size);
+}
+
+static void counting_free(void *ptr) {
+    if (ptr) stock_calls++;
+    free(ptr);
+}
+
+static void *counting_realloc(void *ptr, size_t size) {
+    stock_calls++;
+    return realloc(ptr, size);
+}
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static u64 fnv1a(u64 h, const char *s) {
+    for (; *s; ++s) h = (h ^ (u8)*s) * 1099511628211ULL;
+    return h;
+}
+
+static cJSON *controller_result(const cJSON *args) {
+    static const char *keys[] = { "A", "B", "X", "Y", "L", "R", "ZL", "ZR", "lx", "ly", "rx", "ry" };
+    int pressed = 0;
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+        const cJSON *v = cJSON_GetObjectItem(args, keys[i]);
+        if (cJSON_IsTrue(v) || (cJSON_IsNumber(v) && v->valueint != 0)) pressed++;
+    }
+    cJSON *result = cJSON_CreateObject();
+    cJSON *content = cJSON_AddArrayToObject(result, "content");
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "type", "text");
+    cJSON_AddStringToObject(item, "text", pressed ? "controller state applied" : "controller released");
+    cJSON_AddItemToArray(content, item);
+    cJSON_AddBoolToObject(result, "isError", false);
+    return result;
+}
+
+// 与 tools/list 结构相近的较大响应：多个工具，各带 inputSchema
+static cJSON *tools_list_result() {
+    static const char *names[] = { "controller", "cur_frame", "controller_recorder", "diagnostics", "sleep", "touch" };
+    cJSON *result = cJSON_CreateObject();
+    cJSON *tools = cJSON_AddArrayToObject(result, "tools");
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        cJSON *tool = cJSON_CreateObject();
+        cJSON_AddStringToObject(tool, "name", names[i]);
+        cJSON_AddStringToObject(tool, "description", "Drives the Switch over the virtual HDLS controller and reports what happened afterwards.");
+        cJSON *schema = cJSON_AddObjectToObject(tool, "inputSchema");
+        cJSON_AddStringToObject(schema, "type", "object");
+        cJSON *props = cJSON_AddObjectToObject(schema, "properties");
+        for (int p = 0; p < 8; ++p) {
+            char key[16];
+            snprintf(key, sizeof(key), "arg%d", p);
+            cJSON *prop = cJSON_AddObjectToObject(props, key);
+            cJSON_AddStringToObject(prop, "type", p % 2 ? "number" : "boolean");
+            cJSON_AddStringToObject(prop, "description", "Argument controlling one aspect of the call.");
+        }
+        cJSON_AddItemToArray(tools, tool);
+    }
+    return result;
+}
+
+// 一个请求：解析、按方法构建结果、打印响应，返回打印结果的哈希用于对比两种 hooks 的输出
+static u64 handle_request(const char *body, size_t len, u64 hash) {
+    cJSON *req = cJSON_ParseWithLength(body, len);
+    const cJSON *method = cJSON_GetObjectItem(req, "method");
+    cJSON *resp = cJSON_CreateObject();
+    cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
+    cJSON_AddItemToObject(resp, "id", cJSON_Duplicate(cJSON_GetObjectItem(req, "id"), true));
+    if (strcmp(method->valuestring, "tools/call") == 0) {
+        const cJSON *params = cJSON_GetObjectItem(req, "params");
+        cJSON_AddItemToObject(resp, "result", controller_result(cJSON_GetObjectItem(params, "arguments")));
+    } else {
+        cJSON_AddItemToObject(resp, "result", tools_list_result());
+    }
+    char *out = cJSON_PrintUnformatted(resp);
+    hash = fnv1a(hash, out);
+    cJSON_free(out);
+    cJSON_Delete(resp);
+    cJSON_Delete(req);
+    return hash;
+}
+
+typedef struct {
+    double ms;
+    u64 hash;
+    u64 heap_calls;
+    size_t heap_bytes;      // 从系统取得的堆大小
+    size_t max_free_bytes;  // 采样到的堆内空闲字节（碎片）最大值
+    size_t max_free_chunks;
+} RunResult;
+
+static void run(bool use_arena, RunResult *r) {
+    static void *retained[RETAINED_SLOTS];
+    HeapTagStats before;
+    heap_tag_stats(HEAP_TAG_CJSON, &before);
+    stock_calls = 0;
+    r->hash = 14695981039346656037ULL;
+    r->max_free_bytes = r->max_free_chunks = 0;
+    double start = now_ms();
+    for (int i = 0; i < REQUESTS; ++i) {
+        const char *body = i % 8 == 7 ? tools_list_request : controller_request;
+        size_t len = i % 8 == 7 ? sizeof(tools_list_request) - 1 : sizeof(controller_request) - 1;
+        if (use_arena) request_arena_begin();
+        r->hash = handle_request(body, len, r->hash);
+        if (use_arena) request_arena_end();
+        int slot = (i * 37) % RETAINED_SLOTS;
+        free(retained[slot]);
+        retained[slot] = malloc(RETAINED_SIZE + (size_t)(i % 5) * 16);
+        // 在两个请求之间采样：此时 cJSON 的短期分配都已释放，堆内剩余的空闲块即碎片
+        if (i % 1000 == 999) {
+            struct mallinfo2 mi = mallinfo2();
+            if (mi.fordblks > r->max_free_bytes) r->max_free_bytes = mi.fordblks;
+            if (mi.ordblks > r->max_free_chunks) r->max_free_chunks = mi.ordblks;
+        }
+    }
+    r->ms = now_ms() - start;
+    r->heap_bytes = mallinfo2().arena;
+    for (int i = 0; i < RETAINED_SLOTS; ++i) {
+        free(retained[i]);
+        retained[i] = NULL;
+    }
+    HeapTagStats after;
+    heap_tag_stats(HEAP_TAG_CJSON, &after);
+    // heap_free 不计入 allocs，arena 模式下按一次分配对应一次释放估算
+    r->heap_calls = use_arena ? (after.allocs - before.allocs) * 2 : stock_calls;
+}
+
+static void report(const char *name, const RunResult *r) {
+    printf("%-8s %8.1f ms  %9.0f req/s  heap calls/req %6.2f  heap %zu B, idle free up to %zu B in %zu chunks\n",
+           name, r->ms, REQUESTS / (r->ms / 1000.0), (double)r->heap_calls / REQUESTS,
+           r->heap_bytes, r->max_free_bytes, r->max_free_chunks);
+}
+
+int main(int argc, char **argv) {
+    // newlib 没有线程缓存，关掉 glibc 的 tcache 与 fastbin，让释放的块像设备上一样直接体现为堆内空闲
+    if (!getenv("GLIBC_TUNABLES")) {
+        setenv("GLIBC_TUNABLES", "glibc.malloc.tcache_count=0", 1);
+        execv("/proc/self/exe", argv);
+    }
+    mallopt(M_MXFAST, 0);
+    mallopt(M_TRIM_THRESHOLD, 0);
+
+    // 两种 hooks 各在独立的子进程中运行，避免前一次运行留下的堆形态影响后一次
+    RunResult stock, arena;
+    int pipefd[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        if (pipe(pipefd) < 0) return 1;
+        if (fork() == 0) {
+            RunResult r;
+            if (mode == 0) {
+                cJSON_Hooks hooks = { .malloc_fn = counting_malloc, .free_fn = counting_free };
+                cJSON_InitHooksWithRealloc(&hooks, counting_realloc);
+            } else {
+                request_arena_init();
+            }
+            run(mode == 1, &r);
+            if (write(pipefd[1], &r, sizeof(r)) != sizeof(r)) _exit(1);
+            if (mode == 1) {
+                RequestArenaStats s;
+                request_arena_stats(&s);
+                printf("arena: %d x %d KB, peak %zu B per request, %llu fallback allocs, %llu requests without an arena\n",
+                       REQUEST_ARENA_COUNT, REQUEST_ARENA_SIZE / 1024, s.peak_bytes,
+                       (unsigned long long)s.fallback_allocs, (unsigned long long)s.unavailable);
+                fflush(stdout);
+            }
+            _exit(0);
+        }
+        RunResult *dst = mode == 0 ? &stock : &arena;
+        if (read(pipefd[0], dst, sizeof(*dst)) != sizeof(*dst)) return 1;
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+    report("malloc", &stock);
+    report("arena", &arena);
+    printf("speedup %.2fx\n", stock.ms / arena.ms);
+    if (stock.hash != arena.hash) {
+        printf("FAIL: printed output differs between hooks\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+// 压缩基准：对合成的 recorder dump 响应测量 gzip/deflate 压缩率与写端 CPU 耗时，并解压校验
+// 事件字段与 controller_recorder.c 的 events_to_json 相同，dump 结果以字符串形式嵌在 tools/call 响应中
+#include <switch.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <zlib.h>
+#include "../source/third_party/cJSON.h"
+#include "../source/transport/http_response.h"
+#include "../source/util/heap.h"
+
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+} Capture;
+
+static int failures = 0;
+
+void metrics_add_send_ticks(u64 ticks) {
+}
+
+static void *capture_thread(void *arg) {
+    Capture *cap = arg;
+    size_t cap_size = 65536;
+    cap->data = malloc(cap_size);
+    cap->len = 0;
+    while (1) {
+        if (cap->len == cap_size) {
+            cap_size *= 2;
+            cap->data = realloc(cap->data, cap_size);
+        }
+        ssize_t n = read(cap->fd, cap->data + cap->len, cap_size - cap->len);
+        if (n <= 0) break;
+        cap->len += (size_t)n;
+    }
+    return NULL;
+}
+
+static double thread_cpu_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// 按 60Hz 采样模拟一段游玩：摇杆平滑转动、按键偶尔变化、六轴带噪声
+static char *make_dump_response(int events) {
+    srand(12345);
+    cJSON *arr = cJSON_CreateArray();
+    u64 tick = 123456789012ULL;
+    u64 buttons = 0;
+    for (int i = 0; i < events; ++i) {
+        tick += 320000 + rand() % 1000; // 19.2MHz 时钟下约 16.7ms
+        if (rand() % 20 == 0) buttons ^= 1ULL << (rand() % 16);
+        double t = i / 60.0;
+        cJSON *obj = cJSON_CreateObject();
+        cJSON_AddNumberToObject(obj, "tick", (double)tick);
+        cJSON_AddNumberToObject(obj, "buttons", (double)buttons);
+        cJSON_AddNumberToObject(obj, "lx", (s32)(30000 * sin(t)));
+        cJSON_AddNumberToObject(obj, "ly", (s32)(30000 * cos(t)));
+        cJSON_AddNumberToObject(obj, "rx", (i / 90) % 2 ? 0 : (s32)(12000 * sin(t * 3)));
+        cJSON_AddNumberToObject(obj, "ry", 0);
+        cJSON_AddNumberToObject(obj, "accel_x", (float)(0.01 * (rand() % 200 - 100) / 100.0));
+        cJSON_AddNumberToObject(obj, "accel_y", (float)(-1.0 + 0.02 * (rand() % 100) / 100.0));
+        cJSON_AddNumberToObject(obj, "accel_z", (float)(0.005 * (rand() % 200 - 100) / 100.0));
+        cJSON_AddNumberToObject(obj, "angle_x", (float)(0.25 * sin(t / 4)));
+        cJSON_AddNumberToObject(obj, "angle_y", (float)(0.25 * cos(t / 4)));
+        cJSON_AddNumberToObject(obj, "angle_z", (float)(0.001 * i));
+        cJSON_AddBoolToObject(obj, "long_press", false);
+        cJSON_AddItemToArray(arr, obj);
+    }
+    char *arr_str = cJSON_PrintUnformatted(arr);
+    cJSON_Delete(arr);
+
+    cJSON *resp = cJSON_CreateObject();
+    cJSON_AddStringToObject(resp, "jsonrpc", "2.0");
+    cJSON_AddNumberToObject(resp, "id", 1);
+    cJSON *result = cJSON_AddObjectToObject(resp, "result");
+    cJSON *content = cJSON_AddArrayToObject(result, "content");
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "type", "text");
+    cJSON_AddStringToObject(item, "text", arr_str);
+    cJSON_AddItemToArray(content, item);
+    cJSON_AddBoolToObject(result, "isError", false);
+    char *out = cJSON_PrintUnformatted(resp);
+    cJSON_Delete(resp);
+    free(arr_str);
+    return out;
+}
+
+// 去掉 header 并拼接 chunk，返回 body 长度，格式错误返回 -1
+static long dechunk(const char *wire, size_t len, unsigned char *out) {
+    const char *p = strstr(wire, "\r\n\r\n");
+    if (!p) return -1;
+    p += 4;
+    const char *end = wire + len;
+    long total = 0;
+    while (p < end) {
+        char *line_end;
+        unsigned long size = strtoul(p, &line_end, 16);
+        if (line_end + 2 > end || line_end[0] != '\r' || line_end[1] != '\n') return -1;
+        p = line_end + 2;
+        if (size == 0) return p + 2 == end ? total : -1;
+        if (p + size + 2 > end) return -1;
+        memcpy(out + total, p, size);
+        total += (long)size;
+        p += size + 2;
+    }
+    return -1;
+}
+
+static bool inflate_equals(const unsigned char *data, long len, const char *expect, size_t expect_len) {
+    unsigned char *plain = malloc(expect_len + 1);
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    inflateInit2(&zs, 15 + 32); // 自动识别 gzip 与 zlib 头
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)len;
+    zs.next_out = plain;
+    zs.avail_out = (uInt)expect_len + 1;
+    int zr = inflate(&zs, Z_FINISH);
+    bool ok = zr == Z_STREAM_END && zs.total_out == expect_len && memcmp(plain, expect, expect_len) == 0;
+    inflateEnd(&zs);
+    free(plain);
+    return ok;
+}
+
+static void bench(const char *name, const char *body, HttpEncoding encoding) {
+    size_t body_len = strlen(body);
+    int sv[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    Capture cap = { .fd = sv[1] };
+    pthread_t reader;
+    pthread_create(&reader, NULL, capture_thread, &cap);
+
+    struct iovec iov = { (void *)body, body_len };
+    HeapTagStats before;
+    heap_tag_stats(HEAP_TAG_HTTP, &before);
+    double start = thread_cpu_ms();
+    int rc = http_write_response_encoded(sv[0], "200 OK", "application/json", NULL, &iov, 1, true, encoding);
+    double cpu = thread_cpu_ms() - start;
+    shutdown(sv[0], SHUT_WR);
+    pthread_join(reader, NULL);
+    close(sv[0]);
+    close(sv[1]);
+
+    HeapTagStats after;
+    heap_tag_stats(HEAP_TAG_HTTP, &after);
+
+    unsigned char *payload = malloc(cap.len);
+    long payload_len = dechunk(cap.data, cap.len, payload);
+    bool ok = rc == 0 && payload_len > 0 && inflate_equals(payload, payload_len, body, body_len);
+    // 压缩器状态经 zalloc 记在 http tag 下，发送结束后全部归还
+    if (after.live_bytes != before.live_bytes || after.peak_bytes < HTTP_COMPRESS_CHUNK + 16 * 1024) {
+        printf("FAIL %s: http tag live %zu -> %zu B, peak %zu B\n", name, before.live_bytes, after.live_bytes, after.peak_bytes);
+        failures++;
+    }
+    if (!ok) {
+        printf("FAIL %s %s: rc=%d, payload=%ld\n", name, encoding == HTTP_ENCODING_GZIP ? "gzip" : "deflate", rc, payload_len);
+        failures++;
+    } else {
+        printf("%-14s %-8s %9zu -> %8ld bytes  ratio %5.2f  cpu %7.2f ms  %6.1f MB/s\n",
+               name, encoding == HTTP_ENCODING_GZIP ? "gzip" : "deflate", body_len, payload_len,
+               (double)body_len / payload_len, cpu, body_len / 1048576.0 / (cpu / 1000.0));
+    }
+    free(payload);
+    free(cap.data);
+}
+
+int main() {
+    static const int sizes[] = { 100, 1000, 5000, 20000 };
+    printf("window %d bits, memLevel %d, level %d, chunk %d\n",
+           HTTP_COMPRESS_WINDOW_BITS, HTTP_COMPRESS_MEM_LEVEL, HTTP_COMPRESS_LEVEL, HTTP_COMPRESS_CHUNK);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "dump %d ev", sizes[i]);
+        char *body = make_dump_response(sizes[i]);
+        bench(name, body, HTTP_ENCODING_GZIP);
+        bench(name, body, HTTP_ENCODING_DEFLATE);
+        free(body);
+    }
+    HeapTagStats http;
+    heap_tag_stats(HEAP_TAG_HTTP, &http);
+    printf("http tag peak %zu B (output chunk + deflate state)\n", http.peak_bytes);
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
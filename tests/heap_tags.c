@@ -0,0 +1,125 @@
+// 按 tag 记账的堆分配：live/peak/largest/blocks 随 alloc、realloc、free 变化，realloc 沿用原 tag，
+// 挂在 cJSON 树上的块经 hooks（arena 内外）释放时记回分配时的 tag
+#include <switch.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../source/third_party/cJSON.h"
+#include "../source/util/arena.h"
+#include "../source/util/heap.h"
+
+static int failures = 0;
+
+static void expect_stats(const char *name, HeapTag tag, size_t live, u64 blocks, size_t peak, size_t largest) {
+    HeapTagStats s;
+    heap_tag_stats(tag, &s);
+    if (s.live_bytes != live || s.live_blocks != blocks || s.peak_bytes != peak || s.largest != largest) {
+        printf("FAIL %s: %s live %zu (%llu blocks) peak %zu largest %zu, want live %zu (%llu blocks) peak %zu largest %zu\n",
+               name, heap_tag_name(tag), s.live_bytes, (unsigned long long)s.live_blocks, s.peak_bytes, s.largest,
+               live, (unsigned long long)blocks, peak, largest);
+        failures++;
+    } else {
+        printf("%-28s ok\n", name);
+    }
+}
+
+static void expect_u64(const char *name, u64 got, u64 want) {
+    if (got != want) {
+        printf("FAIL %s: got %llu, want %llu\n", name, (unsigned long long)got, (unsigned long long)want);
+        failures++;
+    }
+}
+
+static void test_alloc_realloc_free() {
+    char *a = heap_alloc(HEAP_TAG_RECORDER, 100);
+    char *b = heap_alloc(HEAP_TAG_RECORDER, 300);
+    if (((uintptr_t)a | (uintptr_t)b) & 15) {
+        printf("FAIL alignment: %p %p\n", (void *)a, (void *)b);
+        failures++;
+    }
+    memset(a, 0xAB, 100);
+    expect_stats("alloc", HEAP_TAG_RECORDER, 400, 2, 400, 300);
+
+    // 传入的 tag 只在 ptr 为 NULL 时使用，已有块沿用分配时的 tag
+    a = heap_realloc(HEAP_TAG_HTTP, a, 1000);
+    if (a[0] != (char)0xAB || a[99] != (char)0xAB) {
+        printf("FAIL realloc: contents not preserved\n");
+        failures++;
+    }
+    expect_stats("realloc grow", HEAP_TAG_RECORDER, 1300, 2, 1300, 1000);
+    expect_stats("realloc keeps tag", HEAP_TAG_HTTP, 0, 0, 0, 0);
+    a = heap_realloc(HEAP_TAG_RECORDER, a, 10);
+    expect_stats("realloc shrink", HEAP_TAG_RECORDER, 310, 2, 1300, 1000);
+
+    heap_free(a);
+    heap_free(b);
+    heap_free(NULL);
+    expect_stats("free", HEAP_TAG_RECORDER, 0, 0, 1300, 1000);
+
+    char *c = heap_realloc(HEAP_TAG_SSE, NULL, 64);
+    expect_stats("realloc from NULL", HEAP_TAG_SSE, 64, 1, 64, 64);
+    heap_free(c);
+
+    HeapTagStats s;
+    heap_tag_stats(HEAP_TAG_RECORDER, &s);
+    expect_u64("allocs", s.allocs, 4);
+    if (heap_alloc(HEAP_TAG_RECORDER, SIZE_MAX)) {
+        printf("FAIL oversized alloc succeeded\n");
+        failures++;
+    }
+    heap_tag_stats(HEAP_TAG_RECORDER, &s);
+    expect_u64("failures", s.failures, 1);
+    expect_stats("failure not counted live", HEAP_TAG_RECORDER, 0, 0, 1300, 1000);
+}
+
+// 与 capture_jpeg_screenshot 相同：cur_frame tag 的字符串挂到 cJSON 节点上，由 cJSON_Delete 经 hooks 释放
+static void delete_tagged_string(bool in_arena) {
+    if (in_arena) request_arena_begin();
+    char *b64 = heap_alloc(HEAP_TAG_CUR_FRAME, 8192);
+    memset(b64, 'A', 8191);
+    b64[8191] = '\0';
+    cJSON *item = cJSON_CreateString("");
+    cJSON_free(item->valuestring);
+    item->valuestring = b64;
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddItemToObject(obj, "data", item);
+    // 超过 arena 单块上限的打印缓冲退回堆，记在 cjson 下
+    char *printed = cJSON_PrintUnformatted(obj);
+    if (!printed || strlen(printed) != 8191 + 11) {
+        printf("FAIL print %s arena\n", in_arena ? "inside" : "outside");
+        failures++;
+    }
+    cJSON_free(printed);
+    cJSON_Delete(obj);
+    if (in_arena) request_arena_end();
+}
+
+static void test_cjson_hooks() {
+    request_arena_init();
+    HeapTagStats cjson_before;
+    heap_tag_stats(HEAP_TAG_CJSON, &cjson_before);
+
+    delete_tagged_string(false);
+    expect_stats("hooks outside arena", HEAP_TAG_CUR_FRAME, 0, 0, 8192, 8192);
+    HeapTagStats cjson;
+    heap_tag_stats(HEAP_TAG_CJSON, &cjson);
+    expect_u64("cjson live outside arena", cjson.live_bytes, cjson_before.live_bytes);
+
+    delete_tagged_string(true);
+    expect_stats("hooks inside arena", HEAP_TAG_CUR_FRAME, 0, 0, 8192, 8192);
+    // arena 首次使用时分配，之后常驻
+    heap_tag_stats(HEAP_TAG_CJSON, &cjson);
+    expect_u64("cjson live inside arena", cjson.live_bytes, cjson_before.live_bytes + REQUEST_ARENA_SIZE);
+    expect_u64("cjson blocks inside arena", cjson.live_blocks, cjson_before.live_blocks + 1);
+}
+
+int main() {
+    test_alloc_realloc_free();
+    test_cjson_hooks();
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+// 主机端测试用的 libnx 替身：只声明被测源码引用到的类型与函数，实现见 switch_host.c（未实现的函数在被测代码路径中不会被调用）
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+#define R_FAILED(r) ((r) != 0)
+#define R_SUCCEEDED(r) ((r) == 0)
+#define MAKEHOSVERSION(a, b, c) ((a) << 16 | (b) << 8 | (c))
+
+// 线程
+typedef struct { u32 handle; void *stack_mem; } Thread;
+typedef void (*ThreadFunc)(void *);
+Result threadCreate(Thread *t, ThreadFunc entry, void *arg, void *stack_mem, size_t stack_sz, int prio, int cpuid);
+Result threadStart(Thread *t);
+Result threadWaitForExit(Thread *t);
+Result threadClose(Thread *t);
+void threadExit(void);
+
+// 同步原语，与 libnx 一样是可零初始化的 u32
+typedef u32 Mutex;
+void mutexInit(Mutex *m);
+void mutexLock(Mutex *m);
+void mutexUnlock(Mutex *m);
+bool mutexTryLock(Mutex *m);
+typedef u32 CondVar;
+void condvarInit(CondVar *c);
+Result condvarWait(CondVar *c, Mutex *m);
+Result condvarWaitTimeout(CondVar *c, Mutex *m, u64 timeout_ns);
+Result condvarWakeOne(CondVar *c);
+Result condvarWakeAll(CondVar *c);
+
+// 时间：主机上 1 tick = 1ns
+void svcSleepThread(s64 ns);
+u64 svcGetSystemTick(void);
+u64 armGetSystemTickFreq(void);
+u64 armTicksToNs(u64 ticks);
+u64 armNsToTicks(u64 ns);
+Result svcGetInfo(u64 *out, u32 id0, u32 handle, u64 id1);
+enum { InfoType_TotalMemorySize = 6, InfoType_UsedMemorySize = 7 };
+#define CUR_PROCESS_HANDLE 0xFFFF8001
+
+// 服务
+typedef struct { u32 session; } Service;
+Result smGetService(Service *s, const char *name);
+bool serviceIsActive(Service *s);
+void serviceClose(Service *s);
+enum { SfBufferAttr_HipcMapTransferAllowsNonSecure = 1, SfBufferAttr_HipcMapAlias = 2, SfBufferAttr_Out = 4 };
+typedef struct { u32 buffer_attrs[8]; struct { void *p; size_t s; } buffers[8]; } SfDispatchParams;
+Result serviceDispatchImpl(Service *s, u32 id, const void *in, size_t in_size, void *out, size_t out_size, SfDispatchParams params);
+#define serviceDispatchInOut(s, id, in, out, ...) \
+    serviceDispatchImpl((s), (id), &(in), sizeof(in), &(out), sizeof(out), (SfDispatchParams){ __VA_ARGS__ })
+typedef u64 ViLayerStack;
+
+// HID
+typedef struct { s32 x, y; } HidAnalogStickState;
+typedef struct { float x, y, z; } HidVector;
+typedef struct {
+    u32 battery_level;
+    u32 flags;
+    u64 buttons;
+    HidAnalogStickState analog_stick_l, analog_stick_r;
+    HidVector six_axis_sensor_acceleration, six_axis_sensor_angle;
+    u32 attribute;
+    u32 pad;
+} HiddbgHdlsState;
+typedef struct { u64 id; } HiddbgHdlsSessionId;
+typedef struct { u64 handle; } HiddbgHdlsHandle;
+typedef struct { u32 deviceType, npadInterfaceType, singleColorBody, singleColorButtons, colorLeftGrip, colorRightGrip; } HiddbgHdlsDeviceInfo;
+enum {
+    HidNpadButton_A = 1, HidNpadButton_B = 2, HidNpadButton_X = 4, HidNpadButton_Y = 8,
+    HidNpadButton_StickL = 16, HidNpadButton_StickR = 32, HidNpadButton_L = 64, HidNpadButton_R = 128,
+    HidNpadButton_ZL = 256, HidNpadButton_ZR = 512, HidNpadButton_Plus = 1024, HidNpadButton_Minus = 2048,
+    HidNpadButton_Left = 4096, HidNpadButton_Up = 8192, HidNpadButton_Right = 16384, HidNpadButton_Down = 32768,
+};
+#define HiddbgNpadButton_Home (1ULL << 18)
+#define HiddbgNpadButton_Capture (1ULL << 19)
+enum {
+    HidDeviceType_FullKey3 = 3, HidNpadInterfaceType_Bluetooth = 1,
+    HidNpadStyleTag_NpadFullKey = 1, HidNpadStyleTag_NpadHandheld = 2, HidNpadStyleTag_NpadJoyDual = 4,
+    HidNpadStyleTag_NpadJoyLeft = 8, HidNpadStyleTag_NpadJoyRight = 16,
+};
+Result hiddbgIsHdlsVirtualDeviceAttached(HiddbgHdlsSessionId session, HiddbgHdlsHandle handle, bool *out);
+Result hiddbgAttachHdlsVirtualDevice(HiddbgHdlsHandle *handle, const HiddbgHdlsDeviceInfo *info);
+Result hiddbgSetHdlsState(HiddbgHdlsHandle handle, const HiddbgHdlsState *state);
+Result hiddbgAttachHdlsWorkBuffer(HiddbgHdlsSessionId *session, void *buffer, size_t size);
+Result hiddbgDetachHdlsVirtualDevice(HiddbgHdlsHandle handle);
+Result hiddbgReleaseHdlsWorkBuffer(HiddbgHdlsSessionId session);
+typedef struct { int x; } PadState;
+void padConfigureInput(u32 max_players, u32 style_set);
+void padInitializeDefault(PadState *pad);
+void padUpdate(PadState *pad);
+bool padIsConnected(PadState *pad);
+u64 padGetButtons(PadState *pad);
+HidAnalogStickState padGetStickPos(PadState *pad, int i);
+
+// 其他
+enum { TimeType_LocalSystemClock = 1 };
+Result timeGetCurrentTime(int type, u64 *timestamp);
+void fatalThrow(Result r);
+#define SHA1_HASH_SIZE 20
+void sha1CalculateHash(void *dst, const void *src, size_t size);
@@ -0,0 +1 @@
+#include <switch.h>
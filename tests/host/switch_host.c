@@ -0,0 +1,113 @@
+// libnx 替身的 POSIX 实现：只实现被测源码运行时真正调用到的函数
+#include <switch.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+
+void mutexInit(Mutex *m) {
+    *m = 0;
+}
+
+void mutexLock(Mutex *m) {
+    while (__atomic_exchange_n(m, 1, __ATOMIC_ACQUIRE)) sched_yield();
+}
+
+void mutexUnlock(Mutex *m) {
+    __atomic_store_n(m, 0, __ATOMIC_RELEASE);
+}
+
+bool mutexTryLock(Mutex *m) {
+    return __atomic_exchange_n(m, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+void condvarInit(CondVar *c) {
+    *c = 0;
+}
+
+// 条件变量允许虚假唤醒，这里以短暂休眠后返回实现，调用方总会重新检查条件
+Result condvarWaitTimeout(CondVar *c, Mutex *m, u64 timeout_ns) {
+    mutexUnlock(m);
+    svcSleepThread(timeout_ns < 1000000ULL ? (s64)timeout_ns : 1000000LL);
+    mutexLock(m);
+    return 0;
+}
+
+Result condvarWait(CondVar *c, Mutex *m) {
+    return condvarWaitTimeout(c, m, 1000000ULL);
+}
+
+Result condvarWakeOne(CondVar *c) {
+    return 0;
+}
+
+Result condvarWakeAll(CondVar *c) {
+    return 0;
+}
+
+void svcSleepThread(s64 ns) {
+    struct timespec ts = { ns / 1000000000LL, ns % 1000000000LL };
+    nanosleep(&ts, NULL);
+}
+
+u64 svcGetSystemTick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+u64 armGetSystemTickFreq(void) {
+    return 1000000000ULL;
+}
+
+u64 armTicksToNs(u64 ticks) {
+    return ticks;
+}
+
+u64 armNsToTicks(u64 ns) {
+    return ns;
+}
+
+Result svcGetInfo(u64 *out, u32 id0, u32 handle, u64 id1) {
+    *out = 0;
+    return 0;
+}
+
+// newlib 的堆边界，由 main.c 的 __libnx_initheap 设置；主机上堆不在这段区间内，只用于堆统计
+void *fake_heap_start = NULL;
+void *fake_heap_end = NULL;
+
+// 日志直接写到 stderr
+static void log_host(const char *level, const char *file, int line, const char *fmt, va_list args) {
+    fprintf(stderr, "[%s] %s:%d: ", level, file, line);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+}
+
+void log_info_impl(const char *file, int line, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_host("INFO", file, line, fmt, args);
+    va_end(args);
+}
+
+void log_warning_impl(const char *file, int line, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_host("WARN", file, line, fmt, args);
+    va_end(args);
+}
+
+void log_error_impl(const char *file, int line, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_host("ERROR", file, line, fmt, args);
+    va_end(args);
+}
+
+void log_debug_impl(const char *file, int line, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_host("DEBUG", file, line, fmt, args);
+    va_end(args);
+}
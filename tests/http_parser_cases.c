@@ -0,0 +1,87 @@
+// 增量请求解析器：正常请求与流水线、逐字节到达，以及必须拒绝的请求体长度声明
+#include <switch.h>
+#include <stdio.h>
+#include <string.h>
+#include "../source/transport/http_parser.h"
+
+SLAB_POOL_STORAGE(small_storage, 256, 2);
+SLAB_POOL_STORAGE(large_storage, 4096, 1);
+static SlabPool small_pool;
+static SlabPool large_pool;
+
+static int failures = 0;
+
+// 把 raw 按 step 字节分批喂给解析器，返回最终状态
+static HttpParseState feed(HttpRequest *req, const char *raw, size_t step) {
+    size_t len = strlen(raw), off = 0;
+    HttpParseState st = http_request_parse(req);
+    while (st < HTTP_PARSE_DONE && off < len) {
+        size_t avail = 0;
+        char *dst = http_request_reserve(req, &avail);
+        if (!dst) break;
+        size_t n = len - off < step ? len - off : step;
+        if (n > avail) n = avail;
+        memcpy(dst, raw + off, n);
+        http_request_commit(req, n);
+        off += n;
+        st = http_request_parse(req);
+    }
+    return st;
+}
+
+static void expect_status(const char *name, const char *raw, HttpParseState want_state, int want_status) {
+    for (size_t step = 1; step <= 64; step *= 4) {
+        HttpRequest req;
+        http_request_init(&req, &small_pool, &large_pool);
+        HttpParseState st = feed(&req, raw, step);
+        int status = st == HTTP_PARSE_ERROR ? req.error_status : 0;
+        if (st != want_state || status != want_status) {
+            printf("FAIL %s (step %zu): state %d status %d, want state %d status %d\n", name, step, st, status, want_state, want_status);
+            failures++;
+        }
+        http_request_free(&req);
+    }
+    printf("%-28s ok\n", name);
+}
+
+static void test_pipelined() {
+    HttpRequest req;
+    http_request_init(&req, &small_pool, &large_pool);
+    HttpParseState st = feed(&req,
+        "POST /mcp HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+        "GET /metrics?x=1 HTTP/1.1\r\nHost: a\r\n\r\n", 4096);
+    if (st != HTTP_PARSE_DONE || strcmp(req.body, "hello") != 0 || strcmp(req.path, "/mcp") != 0) {
+        printf("FAIL pipelined: first request\n");
+        failures++;
+    }
+    http_request_consume(&req);
+    st = http_request_parse(&req);
+    if (st != HTTP_PARSE_DONE || strcmp(req.method, "GET") != 0 || strcmp(req.path, "/metrics") != 0 ||
+        !req.query || strcmp(req.query, "x=1") != 0 || strcmp(http_request_header(&req, "host"), "a") != 0) {
+        printf("FAIL pipelined: second request\n");
+        failures++;
+    }
+    http_request_free(&req);
+    printf("%-28s ok\n", "pipelined");
+}
+
+int main() {
+    slab_pool_init(&small_pool, small_storage, 256, 2);
+    slab_pool_init(&large_pool, large_storage, 4096, 1);
+
+    expect_status("body", "POST /mcp HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}", HTTP_PARSE_DONE, 0);
+    expect_status("duplicate equal length", "POST /mcp HTTP/1.1\r\nContent-Length: 2\r\ncontent-length: 2\r\n\r\n{}", HTTP_PARSE_DONE, 0);
+    // 前后两个长度不一致：无论哪个生效，都有一端会把剩余字节当成下一个请求
+    expect_status("conflicting length", "POST /mcp HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 40\r\n\r\n{}", HTTP_PARSE_ERROR, 400);
+    expect_status("conflicting zero length", "POST /mcp HTTP/1.1\r\nContent-Length: 0\r\nContent-Length: 2\r\n\r\n{}", HTTP_PARSE_ERROR, 400);
+    expect_status("invalid length", "POST /mcp HTTP/1.1\r\nContent-Length: 2x\r\n\r\n{}", HTTP_PARSE_ERROR, 400);
+    expect_status("chunked body", "POST /mcp HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n", HTTP_PARSE_ERROR, 501);
+    test_pipelined();
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
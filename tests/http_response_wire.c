@@ -0,0 +1,231 @@
+// 检查 http_response 写出的字节与预期完全一致，包括非阻塞套接字上的短写
+#include <switch.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../source/transport/http_response.h"
+
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+} Capture;
+
+static int failures = 0;
+
+// metrics.c 依赖整个请求路径，这里只需要 http_send_iov 调用的计时钩子
+void metrics_add_send_ticks(u64 ticks) {
+}
+
+// 对端读线程：读到 EOF 为止，避免大响应填满套接字缓冲区后写端卡住
+static void *capture_thread(void *arg) {
+    Capture *cap = arg;
+    size_t cap_size = 4096;
+    cap->data = malloc(cap_size);
+    cap->len = 0;
+    while (1) {
+        if (cap->len == cap_size) {
+            cap_size *= 2;
+            cap->data = realloc(cap->data, cap_size);
+        }
+        ssize_t n = read(cap->fd, cap->data + cap->len, cap_size - cap->len);
+        if (n <= 0) break;
+        cap->len += (size_t)n;
+    }
+    return NULL;
+}
+
+typedef struct {
+    int fd;
+    Capture cap;
+    pthread_t reader;
+} Wire;
+
+// sndbuf 非 0 时把写端设为非阻塞并缩小发送缓冲区，迫使 sendmsg 短写与 EAGAIN
+static void wire_open(Wire *w, int sndbuf) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+    if (sndbuf) {
+        setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+    }
+    w->fd = sv[0];
+    w->cap.fd = sv[1];
+    pthread_create(&w->reader, NULL, capture_thread, &w->cap);
+}
+
+static void wire_close(Wire *w) {
+    shutdown(w->fd, SHUT_WR);
+    pthread_join(w->reader, NULL);
+    close(w->fd);
+    close(w->cap.fd);
+}
+
+static void expect_bytes(const char *name, Wire *w, const char *want, size_t want_len) {
+    if (w->cap.len != want_len || memcmp(w->cap.data, want, want_len) != 0) {
+        printf("FAIL %s: got %zu bytes, want %zu\n", name, w->cap.len, want_len);
+        if (w->cap.len < 512) printf("---- got\n%.*s\n---- want\n%.*s\n", (int)w->cap.len, w->cap.data, (int)want_len, want);
+        failures++;
+    } else {
+        printf("%-24s %zu bytes\n", name, want_len);
+    }
+    free(w->cap.data);
+}
+
+static void expect_rc(const char *name, int got, int want) {
+    if (got != want) {
+        printf("FAIL %s: rc=%d, want %d\n", name, got, want);
+        failures++;
+    }
+}
+
+static void test_response() {
+    Wire w;
+    wire_open(&w, 0);
+    struct iovec body[3] = {
+        { (void *)"{\"jsonrpc\":\"2.0\",", 17 },
+        { (void *)"\"id\":1,", 7 },
+        { (void *)"\"result\":{}}", 12 },
+    };
+    expect_rc("response", http_write_response(w.fd, "200 OK", "application/json", "Mcp-Session-Id: abc\r\n", body, 3, true), 0);
+    wire_close(&w);
+    static const char want[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "Mcp-Session-Id: abc\r\n"
+        "Content-Length: 36\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":{}}";
+    expect_bytes("response", &w, want, sizeof(want) - 1);
+}
+
+static void test_empty_response() {
+    Wire w;
+    wire_open(&w, 0);
+    expect_rc("empty", http_write_response(w.fd, "202 Accepted", NULL, NULL, NULL, 0, false), 0);
+    wire_close(&w);
+    static const char want[] =
+        "HTTP/1.1 202 Accepted\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n"
+        "\r\n";
+    expect_bytes("empty", &w, want, sizeof(want) - 1);
+}
+
+static void test_too_many_parts() {
+    Wire w;
+    wire_open(&w, 0);
+    struct iovec body[HTTP_MAX_BODY_IOV + 1];
+    for (int i = 0; i < HTTP_MAX_BODY_IOV + 1; ++i) body[i] = (struct iovec){ (void *)"x", 1 };
+    expect_rc("too-many-parts", http_write_response(w.fd, "200 OK", "text/plain", NULL, body, HTTP_MAX_BODY_IOV + 1, true), -1);
+    wire_close(&w);
+    expect_bytes("too-many-parts", &w, "", 0);
+}
+
+// 8 段共约 1MB 的 body 经过 16KB 发送缓冲区，每次 sendmsg 都只能写出一部分
+static void test_short_writes() {
+    enum { PART_SIZE = 131071 }; // 奇数长度，让短写落在段内任意位置
+    static char parts[HTTP_MAX_BODY_IOV][PART_SIZE];
+    struct iovec body[HTTP_MAX_BODY_IOV];
+    for (int i = 0; i < HTTP_MAX_BODY_IOV; ++i) {
+        for (int j = 0; j < PART_SIZE; ++j) parts[i][j] = (char)('a' + (i * 7 + j) % 26);
+        body[i] = (struct iovec){ parts[i], PART_SIZE };
+    }
+    Wire w;
+    wire_open(&w, 16384);
+    expect_rc("short-writes", http_write_response(w.fd, "200 OK", "text/plain", NULL, body, HTTP_MAX_BODY_IOV, true), 0);
+    wire_close(&w);
+
+    static const char header[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 1048568\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+    size_t want_len = sizeof(header) - 1 + (size_t)PART_SIZE * HTTP_MAX_BODY_IOV;
+    char *want = malloc(want_len);
+    memcpy(want, header, sizeof(header) - 1);
+    for (int i = 0; i < HTTP_MAX_BODY_IOV; ++i) memcpy(want + sizeof(header) - 1 + (size_t)PART_SIZE * i, parts[i], PART_SIZE);
+    expect_bytes("short-writes", &w, want, want_len);
+    free(want);
+}
+
+static void test_chunked() {
+    Wire w;
+    wire_open(&w, 0);
+    struct iovec event[3] = {
+        { (void *)"event: message\ndata: ", 21 },
+        { (void *)"{\"id\":7}", 8 },
+        { (void *)"\n\n", 2 },
+    };
+    struct iovec empty = { (void *)"", 0 };
+    int rc = http_write_stream_header(w.fd, "200 OK", "text/event-stream", "Cache-Control: no-cache\r\n", true);
+    if (rc == 0) rc = http_write_chunk(w.fd, event, 3);
+    if (rc == 0) rc = http_write_chunk(w.fd, &empty, 1); // 空 chunk 不写出，否则会被当作结束块
+    if (rc == 0) rc = http_write_chunk_end(w.fd);
+    expect_rc("chunked", rc, 0);
+    wire_close(&w);
+    static const char want[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "1f\r\n"
+        "event: message\ndata: {\"id\":7}\n\n"
+        "\r\n"
+        "0\r\n\r\n";
+    expect_bytes("chunked", &w, want, sizeof(want) - 1);
+}
+
+// 对端不再读取：发送缓冲区填满后 http_send_iov 必须在 HTTP_SEND_TIMEOUT_MS 左右放弃，而不是一直阻塞
+static void test_stalled_reader() {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+    int sndbuf = 4096;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+    enum { BODY_SIZE = 1 << 20 };
+    char *body = calloc(1, BODY_SIZE);
+    struct iovec iov = { body, BODY_SIZE };
+    u64 start = svcGetSystemTick();
+    int rc = http_send_iov(sv[0], &iov, 1);
+    u64 elapsed_ms = armTicksToNs(svcGetSystemTick() - start) / 1000000ULL;
+    expect_rc("stalled-reader", rc, -1);
+    if (elapsed_ms < HTTP_SEND_TIMEOUT_MS || elapsed_ms > HTTP_SEND_TIMEOUT_MS * 4) {
+        printf("FAIL stalled-reader: gave up after %llu ms, timeout %d ms\n", (unsigned long long)elapsed_ms, HTTP_SEND_TIMEOUT_MS);
+        failures++;
+    } else {
+        printf("%-24s gave up after %llu ms\n", "stalled-reader", (unsigned long long)elapsed_ms);
+    }
+    free(body);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+int main() {
+    test_response();
+    test_empty_response();
+    test_too_many_parts();
+    test_short_writes();
+    test_chunked();
+    test_stalled_reader();
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
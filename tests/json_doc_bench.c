@@ -0,0 +1,146 @@
+// json_doc 与 cJSON 在 tools/call controller 请求体上的对比：解析 + call_controller 的全部属性查找
+// 两条路径取出的按键、轴与 long_press 必须一致；cJSON 一侧统计每个请求的分配次数
+#include <switch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../source/third_party/cJSON.h"
+#include "../source/util/json_doc.h"
+
+#define ITERATIONS 200000
+
+// 与 controller.c 中 controller_axes 的 key 相同
+static const char *axis_keys[] = {
+    "analog_stick_lx", "analog_stick_ly", "analog_stick_rx", "analog_stick_ry",
+    "six_axis_sensor_accelerationx", "six_axis_sensor_accelerationy", "six_axis_sensor_accelerationz",
+    "six_axis_sensor_anglex", "six_axis_sensor_angley", "six_axis_sensor_anglez",
+};
+#define AXIS_COUNT (sizeof(axis_keys) / sizeof(axis_keys[0]))
+
+// 按客户端实际发出的形式整理的请求体
+static const char *bodies[] = {
+    "{\"jsonrpc\":\"2.0\",\"id\":17,\"method\":\"tools/call\",\"params\":{\"name\":\"controller\",\"arguments\":"
+    "{\"buttons\":[\"A\"]}}}",
+    "{\"jsonrpc\":\"2.0\",\"id\":18,\"method\":\"tools/call\",\"params\":{\"name\":\"controller\",\"arguments\":"
+    "{\"buttons\":[\"ZL\",\"R\",\"DPAD_UP\"],\"analog_stick_lx\":-32768,\"analog_stick_ly\":12000,\"long_press\":true}}}",
+    "{\"jsonrpc\": \"2.0\", \"id\": \"c5a1f0e2-7d3b-4f7e-9a61-3b2c1d0e9f88\", \"method\": \"tools/call\",\n"
+    " \"params\": {\"name\": \"controller\", \"_meta\": {\"progressToken\": \"p-19\"}, \"arguments\": {\n"
+    "  \"analog_stick_lx\": 0, \"analog_stick_ly\": 0, \"analog_stick_rx\": 24576, \"analog_stick_ry\": -8192,\n"
+    "  \"six_axis_sensor_accelerationx\": 0.0125, \"six_axis_sensor_accelerationy\": -0.998, \"six_axis_sensor_accelerationz\": 0.031,\n"
+    "  \"six_axis_sensor_anglex\": 0.25, \"six_axis_sensor_angley\": -1.5e-3, \"six_axis_sensor_anglez\": 1e-2,\n"
+    "  \"long_press\": false}}}",
+    // 转义的按键名需要解码后才能匹配
+    "{\"jsonrpc\":\"2.0\",\"id\":20,\"method\":\"tools/call\",\"params\":{\"name\":\"controller\",\"arguments\":"
+    "{\"buttons\":[\"\\u0041\",\"PLUS\",\"B\\u0000\"],\"note\":\"\\u6309\\u952e \\\"test\\\"\",\"analog_stick_rx\":1}}}",
+};
+#define BODY_COUNT (sizeof(bodies) / sizeof(bodies[0]))
+
+typedef struct {
+    char buttons[64]; // 解码后的按键名，以 ',' 连接
+    double axes[AXIS_COUNT];
+    bool has_axis[AXIS_COUNT];
+    bool long_press;
+} ControllerArgs;
+
+static u64 cjson_allocs = 0;
+
+static void *counting_malloc(size_t size) {
+    cjson_allocs++;
+    return malloc(size);
+}
+
+static void append_button(ControllerArgs *out, const char *name) {
+    size_t used = strlen(out->buttons);
+    snprintf(out->buttons + used, sizeof(out->buttons) - used, "%s,", name);
+}
+
+static bool extract_cjson(const char *body, ControllerArgs *out) {
+    memset(out, 0, sizeof(*out));
+    cJSON *root = cJSON_Parse(body);
+    if (!root) return false;
+    const cJSON *args = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "params"), "arguments");
+    const cJSON *buttons = cJSON_GetObjectItem(args, "buttons");
+    const cJSON *button = NULL;
+    cJSON_ArrayForEach(button, buttons) {
+        if (cJSON_IsString(button)) append_button(out, button->valuestring);
+    }
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        const cJSON *value = cJSON_GetObjectItem(args, axis_keys[i]);
+        if (cJSON_IsNumber(value)) {
+            out->axes[i] = value->valuedouble;
+            out->has_axis[i] = true;
+        }
+    }
+    out->long_press = cJSON_IsTrue(cJSON_GetObjectItem(args, "long_press"));
+    cJSON_Delete(root);
+    return true;
+}
+
+static bool extract_doc(JsonDoc *doc, const char *body, ControllerArgs *out) {
+    memset(out, 0, sizeof(*out));
+    if (json_doc_parse(doc, body, strlen(body)) != JSON_DOC_OK) return false;
+    int args = json_doc_get(doc, json_doc_get(doc, 0, "params"), "arguments");
+    int buttons = json_doc_get(doc, args, "buttons");
+    for (int button = json_doc_first(doc, buttons); button >= 0; button = json_doc_next(doc, button)) {
+        char name[16];
+        if (json_doc_string(doc, button, name, sizeof(name)) >= 0) append_button(out, name);
+    }
+    for (size_t i = 0; i < AXIS_COUNT; ++i) {
+        int value = json_doc_get(doc, args, axis_keys[i]);
+        if (json_doc_type(doc, value) == JSON_DOC_NUMBER) {
+            out->axes[i] = json_doc_number(doc, value);
+            out->has_axis[i] = true;
+        }
+    }
+    out->long_press = json_doc_type(doc, json_doc_get(doc, args, "long_press")) == JSON_DOC_TRUE;
+    return true;
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main() {
+    cJSON_Hooks hooks = { .malloc_fn = counting_malloc, .free_fn = free };
+    cJSON_InitHooks(&hooks);
+    static JsonDoc doc;
+    int failures = 0;
+
+    for (size_t b = 0; b < BODY_COUNT; ++b) {
+        ControllerArgs expect, got;
+        if (!extract_cjson(bodies[b], &expect) || !extract_doc(&doc, bodies[b], &got)) {
+            printf("FAIL body %zu: parse failed\n", b);
+            failures++;
+            continue;
+        }
+        // cJSON 在 \u0000 处截断字符串，json_doc 的 16 字节缓冲同样只比较到 NUL
+        if (strcmp(expect.buttons, got.buttons) != 0 || expect.long_press != got.long_press ||
+            memcmp(expect.has_axis, got.has_axis, sizeof(got.has_axis)) != 0 ||
+            memcmp(expect.axes, got.axes, sizeof(got.axes)) != 0) {
+            printf("FAIL body %zu: json_doc buttons=\"%s\" long_press=%d, cJSON buttons=\"%s\" long_press=%d\n",
+                   b, got.buttons, got.long_press, expect.buttons, expect.long_press);
+            failures++;
+            continue;
+        }
+
+        ControllerArgs sink;
+        cjson_allocs = 0;
+        double start = now_ns();
+        for (int i = 0; i < ITERATIONS; ++i) extract_cjson(bodies[b], &sink);
+        double cjson_ns = (now_ns() - start) / ITERATIONS;
+        double allocs = (double)cjson_allocs / ITERATIONS;
+        start = now_ns();
+        for (int i = 0; i < ITERATIONS; ++i) extract_doc(&doc, bodies[b], &sink);
+        double doc_ns = (now_ns() - start) / ITERATIONS;
+        printf("body %zu (%3zu B, %3d tokens): cJSON %7.0f ns %5.1f allocs  json_doc %6.0f ns 0 allocs  %.2fx\n",
+               b, strlen(bodies[b]), doc.count, cjson_ns, allocs, doc_ns, cjson_ns / doc_ns);
+    }
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+// cJSON 数字打印：与原版 print_number（sprintf "%1.15g" + sscanf 回读，必要时 "%1.17g"）逐字节对比，
+// 检查打印结果读回后与原值一致，并在合成的 10k 事件 recorder dump 上比较两者耗时
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../source/third_party/cJSON.h"
+
+#define DUMP_EVENTS 10000
+#define RANDOM_VALUES 1000000
+
+// cJSON 的 compare_double
+static bool compare_double(double a, double b) {
+    double max_val = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+    return fabs(a - b) <= max_val * DBL_EPSILON;
+}
+
+// 原版 cJSON 1.7.18 的 print_number，区域设置为 "C"
+static int reference_print(const cJSON *item, char *out) {
+    double d = item->valuedouble;
+    double test = 0.0;
+    if (isnan(d) || isinf(d)) return sprintf(out, "null");
+    if (d == (double)item->valueint) return sprintf(out, "%d", item->valueint);
+    int length = sprintf(out, "%1.15g", d);
+    if (sscanf(out, "%lg", &test) != 1 || !compare_double(test, d)) length = sprintf(out, "%1.17g", d);
+    return length;
+}
+
+static int failures = 0;
+
+// 逐字节对比并检查读回值；返回 false 时已输出原因
+static bool check_value(cJSON *item) {
+    char got[64], want[64];
+    if (!cJSON_PrintPreallocated(item, got, sizeof(got), false)) {
+        printf("FAIL %.17g: print failed\n", item->valuedouble);
+        return false;
+    }
+    reference_print(item, want);
+    if (strcmp(got, want) != 0) {
+        printf("FAIL %.17g: got \"%s\", want \"%s\"\n", item->valuedouble, got, want);
+        return false;
+    }
+    double d = item->valuedouble;
+    if (isfinite(d)) {
+        double back = strtod(got, NULL);
+        if (!compare_double(back, d)) {
+            printf("FAIL %.17g: \"%s\" reads back as %.17g\n", d, got, back);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check(double d) {
+    cJSON *item = cJSON_CreateNumber(d);
+    if (!check_value(item)) failures++;
+    cJSON_Delete(item);
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// 与 controller_recorder.c 的 events_to_json 字段相同，按 60Hz 采样
+static cJSON *make_dump(int events) {
+    cJSON *arr = cJSON_CreateArray();
+    uint64_t tick = 123456789012ULL, buttons = 0;
+    for (int i = 0; i < events; ++i) {
+        tick += 320000 + next_random() % 1000;
+        if (next_random() % 20 == 0) buttons ^= 1ULL << (next_random() % 20);
+        double t = i / 60.0;
+        cJSON *obj = cJSON_CreateObject();
+        cJSON_AddNumberToObject(obj, "tick", (double)tick);
+        cJSON_AddNumberToObject(obj, "buttons", (double)buttons);
+        cJSON_AddNumberToObject(obj, "lx", (int32_t)(30000 * sin(t)));
+        cJSON_AddNumberToObject(obj, "ly", (int32_t)(30000 * cos(t)));
+        cJSON_AddNumberToObject(obj, "rx", (int32_t)(12000 * sin(t * 3)));
+        cJSON_AddNumberToObject(obj, "ry", 0);
+        cJSON_AddNumberToObject(obj, "accel_x", (float)(0.01 * (double)(next_random() % 200) / 100.0 - 0.01));
+        cJSON_AddNumberToObject(obj, "accel_y", (float)(-1.0 + 0.02 * (double)(next_random() % 100) / 100.0));
+        cJSON_AddNumberToObject(obj, "accel_z", (float)(0.005 * (double)(next_random() % 200) / 100.0 - 0.005));
+        cJSON_AddNumberToObject(obj, "angle_x", (float)(0.25 * sin(t / 4)));
+        cJSON_AddNumberToObject(obj, "angle_y", (float)(0.25 * cos(t / 4)));
+        cJSON_AddNumberToObject(obj, "angle_z", (float)(0.001 * i));
+        cJSON_AddBoolToObject(obj, "long_press", false);
+        cJSON_AddItemToArray(arr, obj);
+    }
+    return arr;
+}
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main() {
+    // 边界值：整数路径的 int 范围、1e15 与 1e-5 附近的格式切换、次正规数与特殊值
+    static const double edges[] = {
+        0.0, -0.0, 1.0, -1.0, 0.1, 0.5, 1.5, 2147483647.0, 2147483648.0, -2147483648.0, -2147483649.0,
+        4294967296.0, 9007199254740992.0, 9007199254740993.0, 1e15, 1e15 - 1, 1e15 + 1, 999999999999999.9,
+        1e16, 1e17, 1e21, 1e22, 1e23, 1.7976931348623157e308, 1e-5, 9.999999999999999e-6, 1.0000000000000001e-5,
+        1e-4, 5e-324, 2.2250738585072014e-308, 0.1 + 0.2, 1.0 / 3.0, 2.0 / 3.0, 123456.789, -0.000123,
+        3.4028234663852886e38, 1.1754943508222875e-38, NAN, INFINITY, -INFINITY,
+    };
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); ++i) check(edges[i]);
+
+    // 随机位模式覆盖全部指数，另外一半落在常见量级内
+    for (int i = 0; i < RANDOM_VALUES && failures < 20; ++i) {
+        uint64_t bits = next_random();
+        double d;
+        if (i % 2) {
+            memcpy(&d, &bits, sizeof(d));
+        } else {
+            d = ldexp((double)(bits >> 11), -53) * pow(10.0, (double)(int)(next_random() % 24) - 8);
+            if (bits & 1) d = -d;
+            if (i % 6 == 0) d = (float)d;
+        }
+        check(d);
+    }
+
+    // 10k 事件的 dump：逐个数字对比，再比较整份打印与只替换数字格式化的参考耗时
+    cJSON *dump = make_dump(DUMP_EVENTS);
+    int numbers = 0;
+    const cJSON *event = NULL;
+    cJSON_ArrayForEach(event, dump) {
+        cJSON *field = NULL;
+        cJSON_ArrayForEach(field, event) {
+            if (!cJSON_IsNumber(field)) continue;
+            numbers++;
+            if (!check_value(field)) failures++;
+        }
+    }
+    printf("checked %zu edge values, %d random values, %d dump numbers\n",
+           sizeof(edges) / sizeof(edges[0]), RANDOM_VALUES, numbers);
+
+    enum { ROUNDS = 5 };
+    char buf[64];
+    double best_print = 1e30, best_ref = 1e30, best_new = 1e30;
+    size_t printed_len = 0;
+    for (int r = 0; r < ROUNDS; ++r) {
+        double start = now_ms();
+        char *text = cJSON_PrintUnformatted(dump);
+        double t = now_ms() - start;
+        if (t < best_print) best_print = t;
+        printed_len = strlen(text);
+        cJSON_free(text);
+
+        start = now_ms();
+        cJSON_ArrayForEach(event, dump) {
+            const cJSON *field = NULL;
+            cJSON_ArrayForEach(field, event) {
+                if (cJSON_IsNumber(field)) cJSON_PrintPreallocated((cJSON *)field, buf, sizeof(buf), false);
+            }
+        }
+        t = now_ms() - start;
+        if (t < best_new) best_new = t;
+
+        start = now_ms();
+        cJSON_ArrayForEach(event, dump) {
+            const cJSON *field = NULL;
+            cJSON_ArrayForEach(field, event) {
+                if (cJSON_IsNumber(field)) reference_print(field, buf);
+            }
+        }
+        t = now_ms() - start;
+        if (t < best_ref) best_ref = t;
+    }
+    cJSON_Delete(dump);
+    printf("dump %d events, %zu bytes: cJSON_PrintUnformatted %.2f ms\n", DUMP_EVENTS, printed_len, best_print);
+    printf("%d numbers: print_number %.2f ms, sprintf/sscanf reference %.2f ms, %.2fx\n",
+           numbers, best_new, best_ref, best_ref / best_new);
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+// cJSON 字符串扫描的差分测试：print_string_ptr 与原版逐字节转义的结果对比，parse_string 解码后与原串对比
+// 特殊字符放在干净区段的每个偏移上，覆盖 8/16 字节分块的边界；主机上走的是 64 位整数分块路径
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../source/third_party/cJSON.h"
+
+static int failures = 0;
+
+// 原版 print_string_ptr 的转义规则
+static size_t reference_escape(const unsigned char *in, char *out) {
+    char *p = out;
+    *p++ = '"';
+    for (; *in; ++in) {
+        switch (*in) {
+        case '"': *p++ = '\\'; *p++ = '"'; break;
+        case '\\': *p++ = '\\'; *p++ = '\\'; break;
+        case '\b': *p++ = '\\'; *p++ = 'b'; break;
+        case '\f': *p++ = '\\'; *p++ = 'f'; break;
+        case '\n': *p++ = '\\'; *p++ = 'n'; break;
+        case '\r': *p++ = '\\'; *p++ = 'r'; break;
+        case '\t': *p++ = '\\'; *p++ = 't'; break;
+        default:
+            if (*in < 32) p += sprintf(p, "\\u%04x", *in);
+            else *p++ = (char)*in;
+        }
+    }
+    *p++ = '"';
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+// 打印后与参考转义对比，再用恰好等长的缓冲区解析回来，确认分块读取不越界且解码结果与原串相同
+static void round_trip(const char *s, const char *what) {
+    size_t len = strlen(s);
+    char *want = malloc(len * 6 + 3);
+    size_t want_len = reference_escape((const unsigned char *)s, want);
+
+    cJSON *item = cJSON_CreateString(s);
+    char *got = cJSON_PrintUnformatted(item);
+    cJSON_Delete(item);
+    if (!got || strcmp(got, want) != 0) {
+        printf("FAIL print %s (len %zu)\n", what, len);
+        failures++;
+        cJSON_free(got);
+        free(want);
+        return;
+    }
+    cJSON_free(got);
+
+    char *exact = malloc(want_len);
+    memcpy(exact, want, want_len);
+    cJSON *parsed = cJSON_ParseWithLength(exact, want_len);
+    if (!cJSON_IsString(parsed) || strcmp(parsed->valuestring, s) != 0) {
+        printf("FAIL parse %s (len %zu)\n", what, len);
+        failures++;
+    }
+    cJSON_Delete(parsed);
+
+    // 去掉结尾引号后必须解析失败
+    parsed = cJSON_ParseWithLength(exact, want_len - 1);
+    if (parsed) {
+        printf("FAIL unterminated %s (len %zu) parsed\n", what, len);
+        failures++;
+        cJSON_Delete(parsed);
+    }
+    free(exact);
+    free(want);
+}
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// 手写的转义序列，检查解码结果（含代理对与 \/）
+static void parse_escapes() {
+    static const struct {
+        const char *escaped;
+        const char *decoded;
+    } cases[] = {
+        { "\\u00e9", "\xc3\xa9" },
+        { "\\u6309\\u952e", "\xe6\x8c\x89\xe9\x94\xae" },
+        { "\\ud83d\\ude00", "\xf0\x9f\x98\x80" },
+        { "\\/", "/" },
+        { "\\\"\\\\", "\"\\" },
+        { "\\b\\f\\n\\r\\t", "\b\f\n\r\t" },
+    };
+    char json[128], want[64];
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        for (int pad = 0; pad < 40; ++pad) {
+            int n = snprintf(json, sizeof(json), "\"%.*s%s%.*s\"", pad, "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGH",
+                             cases[c].escaped, pad % 7, "QRSTUVW");
+            snprintf(want, sizeof(want), "%.*s%s%.*s", pad, "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGH",
+                     cases[c].decoded, pad % 7, "QRSTUVW");
+            cJSON *parsed = cJSON_ParseWithLength(json, (size_t)n);
+            if (!cJSON_IsString(parsed) || strcmp(parsed->valuestring, want) != 0) {
+                printf("FAIL escape %s at offset %d\n", cases[c].escaped, pad);
+                failures++;
+            }
+            cJSON_Delete(parsed);
+        }
+    }
+}
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main() {
+    // 每个需要转义的字节（以及不需要转义的边界字节）放在干净区段的每个偏移上
+    static const unsigned char specials[] = { '"', '\\', '\b', '\f', '\n', '\r', '\t', 0x01, 0x1f, ' ', 0x7f, 0x80, 0xc3, 0xff };
+    char buf[128], what[64];
+    for (size_t k = 0; k < sizeof(specials); ++k) {
+        for (int len = 1; len <= 48; ++len) {
+            for (int pos = 0; pos < len; ++pos) {
+                for (int i = 0; i < len; ++i) buf[i] = (char)('A' + (i * 7) % 26);
+                buf[pos] = (char)specials[k];
+                buf[len] = '\0';
+                snprintf(what, sizeof(what), "0x%02x at %d", specials[k], pos);
+                round_trip(buf, what);
+            }
+        }
+    }
+
+    // 随机字符串：大部分为可打印 ASCII 与 UTF-8 高位字节，夹杂少量需要转义的字节
+    static char random_buf[4096];
+    for (int iter = 0; iter < 20000; ++iter) {
+        int len = (int)(next_random() % sizeof(random_buf));
+        for (int i = 0; i < len; ++i) {
+            uint64_t r = next_random();
+            unsigned char c = r % 64 == 0 ? (unsigned char)(1 + (r >> 8) % 31) : (unsigned char)(32 + (r >> 8) % 224);
+            random_buf[i] = (char)c;
+        }
+        random_buf[len] = '\0';
+        snprintf(what, sizeof(what), "random #%d", iter);
+        round_trip(random_buf, what);
+    }
+    parse_escapes();
+
+    // 截图一类的长 base64 文本：全程没有需要转义的字符
+    enum { BASE64_LEN = 400 * 1024 };
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *base64 = malloc(BASE64_LEN + 1);
+    for (int i = 0; i < BASE64_LEN; ++i) base64[i] = alphabet[next_random() % 64];
+    base64[BASE64_LEN] = '\0';
+    round_trip(base64, "base64");
+    cJSON *item = cJSON_CreateString(base64);
+    double start = now_ms();
+    char *printed = cJSON_PrintUnformatted(item);
+    double print_ms = now_ms() - start;
+    start = now_ms();
+    cJSON *parsed = cJSON_Parse(printed);
+    double parse_ms = now_ms() - start;
+    printf("%d KB base64: print %.3f ms, parse %.3f ms\n", BASE64_LEN / 1024, print_ms, parse_ms);
+    cJSON_Delete(parsed);
+    cJSON_free(printed);
+    cJSON_Delete(item);
+    free(base64);
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
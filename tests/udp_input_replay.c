@@ -0,0 +1,183 @@
+// 通过回环 UDP 回放数据报轨迹，检查 udp_input_check 的排序与过期规则
+// 接收端按设备端线程的方式解析数据报，到达时间取轨迹中的模拟时间，使结果与真实网络抖动无关
+#include <switch.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include "../source/tools/controller.h"
+#include "../source/transport/udp_input.h"
+
+#define DATAGRAM_SIZE (UDP_INPUT_HEADER_SIZE + CONTROLLER_PACKET_SIZE)
+#define DRIFT_PACKETS 64 // 与 udp_input.c 中 UDP_INPUT_DRIFT_PACKETS 一致
+
+typedef struct {
+    u32 seq;
+    u32 target_tick;
+    u32 arrive_ms;
+    bool stream_start;
+    UdpInputVerdict expect;
+} TraceEntry;
+
+static int tx_fd = -1, rx_fd = -1;
+static struct sockaddr_in rx_addr;
+static int failures = 0;
+
+static const char *verdict_name(UdpInputVerdict v) {
+    switch (v) {
+    case UDP_INPUT_ACCEPT: return "accept";
+    case UDP_INPUT_REORDERED: return "reordered";
+    case UDP_INPUT_STALE: return "stale";
+    }
+    return "?";
+}
+
+static int open_loopback() {
+    tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    rx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (tx_fd < 0 || rx_fd < 0) return -1;
+    memset(&rx_addr, 0, sizeof(rx_addr));
+    rx_addr.sin_family = AF_INET;
+    rx_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    rx_addr.sin_port = 0;
+    if (bind(rx_fd, (struct sockaddr *)&rx_addr, sizeof(rx_addr)) < 0) return -1;
+    socklen_t len = sizeof(rx_addr);
+    return getsockname(rx_fd, (struct sockaddr *)&rx_addr, &len);
+}
+
+static void send_datagram(const TraceEntry *e) {
+    u8 buf[DATAGRAM_SIZE] = {0};
+    memcpy(buf, &e->seq, 4);
+    memcpy(buf + 4, &e->target_tick, 4);
+    if (e->stream_start) buf[UDP_INPUT_HEADER_SIZE + 1] |= UDP_INPUT_FLAG_STREAM_START;
+    sendto(tx_fd, buf, sizeof(buf), 0, (struct sockaddr *)&rx_addr, sizeof(rx_addr));
+}
+
+// 收一个数据报并交给规则判定，解析方式与 udp_input_thread 相同
+static bool receive_and_check(UdpInputStream *stream, u32 arrive_ms, UdpInputVerdict *verdict) {
+    struct pollfd pfd = { .fd = rx_fd, .events = POLLIN };
+    if (poll(&pfd, 1, 1000) <= 0) return false;
+    u8 buf[DATAGRAM_SIZE + 1];
+    ssize_t n = recv(rx_fd, buf, sizeof(buf), 0);
+    if (n != DATAGRAM_SIZE) return false;
+    u32 seq, target_tick;
+    memcpy(&seq, buf, 4);
+    memcpy(&target_tick, buf + 4, 4);
+    bool stream_start = (buf[UDP_INPUT_HEADER_SIZE + 1] & UDP_INPUT_FLAG_STREAM_START) != 0;
+    *verdict = udp_input_check(stream, seq, target_tick, arrive_ms, stream_start);
+    return true;
+}
+
+static void replay(const char *name, UdpInputStream *stream, const TraceEntry *trace, int count) {
+    for (int i = 0; i < count; ++i) {
+        send_datagram(&trace[i]);
+        UdpInputVerdict verdict;
+        if (!receive_and_check(stream, trace[i].arrive_ms, &verdict)) {
+            printf("FAIL %s[%d]: datagram lost on loopback\n", name, i);
+            failures++;
+            continue;
+        }
+        if (verdict != trace[i].expect) {
+            printf("FAIL %s[%d]: seq=%u got %s, want %s\n", name, i, trace[i].seq,
+                   verdict_name(verdict), verdict_name(trace[i].expect));
+            failures++;
+        }
+    }
+    printf("%-20s %d datagrams\n", name, count);
+}
+
+static void expect_u32(const char *what, u32 got, u32 want) {
+    if (got != want) {
+        printf("FAIL %s: got %u, want %u\n", what, got, want);
+        failures++;
+    }
+}
+
+int main() {
+    if (open_loopback() < 0) {
+        perror("loopback socket");
+        return 1;
+    }
+
+    // 乱序与重复：序号不大于已应用的包一律丢弃
+    UdpInputStream stream = {0};
+    static const TraceEntry reorder[] = {
+        { 1, 1000, 1010, true,  UDP_INPUT_ACCEPT },
+        { 2, 1016, 1026, false, UDP_INPUT_ACCEPT },
+        { 4, 1048, 1058, false, UDP_INPUT_ACCEPT },
+        { 3, 1032, 1060, false, UDP_INPUT_REORDERED },
+        { 4, 1048, 1061, false, UDP_INPUT_REORDERED },
+        { 5, 1064, 1070, false, UDP_INPUT_ACCEPT }, // 更短的延迟降低基准
+    };
+    replay("reorder", &stream, reorder, sizeof(reorder) / sizeof(reorder[0]));
+    expect_u32("reorder best_delay", (u32)stream.best_delay, 6);
+
+    // 过期包被丢弃但推进 last_seq，比它更早发出的包随后到达也丢弃
+    static const TraceEntry stale[] = {
+        { 10, 2000, 2010, true,  UDP_INPUT_ACCEPT },
+        { 12, 2032, 2032 + 10 + UDP_INPUT_MAX_LATENESS_MS + 1, false, UDP_INPUT_STALE },
+        { 11, 2016, 2100, false, UDP_INPUT_REORDERED },
+        { 12, 2032, 2101, false, UDP_INPUT_REORDERED },
+        { 13, 2048, 2048 + 10 + UDP_INPUT_MAX_LATENESS_MS, false, UDP_INPUT_ACCEPT }, // 恰好在容忍边界上
+        { 14, 2064, 2074, false, UDP_INPUT_ACCEPT },
+    };
+    memset(&stream, 0, sizeof(stream));
+    replay("stale", &stream, stale, sizeof(stale) / sizeof(stale[0]));
+    expect_u32("stale last_seq", stream.last_seq, 14);
+
+    // 序号与发送端时间戳同时回绕
+    static const TraceEntry wrap[] = {
+        { 0xFFFFFFFEu, 0xFFFFFFF0u, 0x00000000u, true,  UDP_INPUT_ACCEPT },
+        { 0xFFFFFFFFu, 0xFFFFFFF8u, 0x00000008u, false, UDP_INPUT_ACCEPT },
+        { 0x00000000u, 0x00000000u, 0x00000010u, false, UDP_INPUT_ACCEPT },
+        { 0x00000001u, 0x00000008u, 0x00000018u, false, UDP_INPUT_ACCEPT },
+        { 0xFFFFFFFFu, 0xFFFFFFF8u, 0x00000019u, false, UDP_INPUT_REORDERED },
+        { 0x00000002u, 0x00000010u, 0x00000020u, false, UDP_INPUT_ACCEPT },
+    };
+    memset(&stream, 0, sizeof(stream));
+    replay("wraparound", &stream, wrap, sizeof(wrap) / sizeof(wrap[0]));
+    expect_u32("wraparound last_seq", stream.last_seq, 2);
+
+    // 客户端重启：序号从头开始、时钟基准也变了，只有带 stream start 标志才会被接受
+    static const TraceEntry restart[] = {
+        { 500, 9000, 9010, true,  UDP_INPUT_ACCEPT },
+        { 501, 9016, 9026, false, UDP_INPUT_ACCEPT },
+        { 1,   100,  9040, false, UDP_INPUT_REORDERED },
+        { 1,   100,  9041, true,  UDP_INPUT_ACCEPT },
+        { 2,   116,  9057, false, UDP_INPUT_ACCEPT }, // 延迟基准已按新流重置，不会判为过期
+        { 3,   132,  9073 + UDP_INPUT_MAX_LATENESS_MS + 1, false, UDP_INPUT_STALE },
+    };
+    memset(&stream, 0, sizeof(stream));
+    replay("stream-start", &stream, restart, sizeof(restart) / sizeof(restart[0]));
+
+    // 时钟漂移：接收端时钟每 DRIFT_PACKETS 个包比发送端多走 1ms，累计漂移超过容忍值后仍应全部接受
+    enum { DRIFT_COUNT = DRIFT_PACKETS * (UDP_INPUT_MAX_LATENESS_MS + 20) };
+    static TraceEntry drift[DRIFT_COUNT];
+    for (u32 i = 0; i < DRIFT_COUNT; ++i) {
+        drift[i].seq = 100 + i;
+        drift[i].target_tick = 5000 + i * 16;
+        drift[i].arrive_ms = drift[i].target_tick + 10 + i / DRIFT_PACKETS;
+        drift[i].stream_start = i == 0;
+        drift[i].expect = UDP_INPUT_ACCEPT;
+    }
+    memset(&stream, 0, sizeof(stream));
+    replay("drift", &stream, drift, DRIFT_COUNT);
+    expect_u32("drift best_delay", (u32)stream.best_delay, 10 + DRIFT_COUNT / DRIFT_PACKETS);
+    // 放宽只跟随缓慢漂移，突发的大延迟仍判为过期
+    static const TraceEntry spike[] = {
+        { 100 + DRIFT_COUNT, 5000 + DRIFT_COUNT * 16, 5000 + DRIFT_COUNT * 16 + 10 + DRIFT_COUNT / DRIFT_PACKETS + UDP_INPUT_MAX_LATENESS_MS + 1, false, UDP_INPUT_STALE },
+    };
+    replay("drift-spike", &stream, spike, 1);
+
+    close(tx_fd);
+    close(rx_fd);
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}